@@ -0,0 +1,254 @@
+#include "gbcore.h"
+
+#include <filesystem>
+#include <memory>
+
+#include "Emulator.h"
+#include "Sound.h"
+
+struct gbcore
+{
+    std::unique_ptr<Emulator> m_emulator;
+};
+
+static_assert(static_cast<int>(Framebuffer::PixelFormat::RGBA8888) == GBCORE_PIXEL_FORMAT_RGBA8888);
+static_assert(static_cast<int>(Framebuffer::PixelFormat::BGRA8888) == GBCORE_PIXEL_FORMAT_BGRA8888);
+static_assert(static_cast<int>(Framebuffer::PixelFormat::RGB565) == GBCORE_PIXEL_FORMAT_RGB565);
+static_assert(static_cast<int>(Framebuffer::PixelFormat::Grayscale8) == GBCORE_PIXEL_FORMAT_GRAYSCALE8);
+static_assert(GBCORE_BUTTON_RIGHT == (1u << static_cast<uint32_t>(Joypad::Button::Right)));
+static_assert(GBCORE_BUTTON_START == (1u << static_cast<uint32_t>(Joypad::Button::Start)));
+static_assert(GBCORE_SCREEN_WIDTH == Framebuffer::sc_width && GBCORE_SCREEN_HEIGHT == Framebuffer::sc_height);
+static_assert(GBCORE_AUDIO_SAMPLE_RATE == Sound::sc_SampleRate);
+
+static bool hasRom(gbcore const* core)
+{
+    return core && core->m_emulator->hasOpenedRomFile();
+}
+
+// No exception may cross the C boundary. Allocations are the only thing in the core that throws.
+template<typename Function>
+static gbcore_result callWithoutExceptions(Function&& function)
+{
+    try
+    {
+        return function();
+    }
+    catch (...)
+    {
+        return GBCORE_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+uint32_t gbcore_get_api_version(void)
+{
+    return GBCORE_API_VERSION;
+}
+
+const char* gbcore_result_string(gbcore_result result)
+{
+    switch (result)
+    {
+    case GBCORE_OK: return "ok";
+    case GBCORE_ERROR_INVALID_ARGUMENT: return "invalid argument";
+    case GBCORE_ERROR_NO_ROM: return "no ROM loaded";
+    case GBCORE_ERROR_ROM_LOAD_FAILED: return "ROM couldn't be loaded";
+    case GBCORE_ERROR_BUFFER_TOO_SMALL: return "buffer too small";
+    case GBCORE_ERROR_UNSUPPORTED: return "unsupported";
+    case GBCORE_ERROR_INVALID_STATE: return "invalid save state";
+    case GBCORE_ERROR_OUT_OF_MEMORY: return "out of memory";
+    default: return "unknown error";
+    }
+}
+
+gbcore* gbcore_create(uint32_t flags)
+{
+    Emulator::Config config;
+    config.m_enableAudioOutput = (flags & GBCORE_CREATE_AUDIO_OUTPUT) != 0;
+    config.m_enableControllerInput = (flags & GBCORE_CREATE_CONTROLLER_INPUT) != 0;
+    config.m_persistBatteryBackedRam = (flags & GBCORE_CREATE_PERSIST_SAVES) != 0;
+    config.m_captureAudioSamples = (flags & GBCORE_CREATE_CAPTURE_AUDIO) != 0;
+
+    try
+    {
+        gbcore* core = new gbcore;
+        core->m_emulator = std::make_unique<Emulator>(config);
+        return core;
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void gbcore_destroy(gbcore* core)
+{
+    delete core;
+}
+
+gbcore_result gbcore_load_rom_file(gbcore* core, const char* path)
+{
+    if (!core || !path) return GBCORE_ERROR_INVALID_ARGUMENT;
+
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error) || std::filesystem::file_size(path, error) < 0x150)
+    {
+        return GBCORE_ERROR_ROM_LOAD_FAILED;
+    }
+
+    return callWithoutExceptions([core, path]()
+        {
+            return core->m_emulator->openRomFile(path) ? GBCORE_OK : GBCORE_ERROR_ROM_LOAD_FAILED;
+        });
+}
+
+gbcore_result gbcore_load_rom_memory(gbcore* core, const void* rom, size_t rom_size)
+{
+    if (!core || !rom) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (rom_size < 0x150) return GBCORE_ERROR_ROM_LOAD_FAILED;
+
+    return callWithoutExceptions([core, rom, rom_size]()
+        {
+            return core->m_emulator->openRomFromMemory(static_cast<uint8_t const*>(rom), rom_size) ? GBCORE_OK : GBCORE_ERROR_ROM_LOAD_FAILED;
+        });
+}
+
+gbcore_result gbcore_run_frames(gbcore* core, uint32_t num_frames)
+{
+    if (!core) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(core)) return GBCORE_ERROR_NO_ROM;
+
+    // Captured audio samples and .sav writes allocate
+    return callWithoutExceptions([core, num_frames]()
+        {
+            core->m_emulator->clearCapturedAudioSamples();
+            for (uint32_t i = 0; i < num_frames; i++)
+            {
+                core->m_emulator->runFrame();
+            }
+            return GBCORE_OK;
+        });
+}
+
+gbcore_result gbcore_run_cycles(gbcore* core, uint64_t num_cycles)
+{
+    if (!core) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(core)) return GBCORE_ERROR_NO_ROM;
+
+    return callWithoutExceptions([core, num_cycles]()
+        {
+            core->m_emulator->clearCapturedAudioSamples();
+            core->m_emulator->runCycles(num_cycles);
+            return GBCORE_OK;
+        });
+}
+
+uint64_t gbcore_get_frame_count(const gbcore* core)
+{
+    return core ? core->m_emulator->getFrameCount() : 0;
+}
+
+uint64_t gbcore_get_cycle_count(const gbcore* core)
+{
+    return core ? core->m_emulator->getElapsedCycles() : 0;
+}
+
+gbcore_result gbcore_set_buttons(gbcore* core, uint8_t buttons)
+{
+    if (!core) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(core)) return GBCORE_ERROR_NO_ROM;
+
+    core->m_emulator->setPressedButtons(buttons);
+    return GBCORE_OK;
+}
+
+gbcore_result gbcore_get_frame(gbcore* core, gbcore_frame* frame)
+{
+    if (!core || !frame) return GBCORE_ERROR_INVALID_ARGUMENT;
+
+    FrameQueue* frameQueue = core->m_emulator->getFrameQueue();
+    Framebuffer const& framebuffer = frameQueue->acquireLatestFrame();
+    frame->shades = framebuffer.getShades();
+    frame->colors = framebuffer.getColors();
+    frame->width = Framebuffer::sc_width;
+    frame->height = Framebuffer::sc_height;
+    frame->is_cgb = framebuffer.isCGBFrame() ? 1 : 0;
+    frame->sequence_number = frameQueue->getFrontSequenceNumber();
+    return GBCORE_OK;
+}
+
+gbcore_result gbcore_convert_frame(gbcore* core, gbcore_pixel_format format, void* dst, size_t dst_size)
+{
+    if (!core || !dst || format < GBCORE_PIXEL_FORMAT_RGBA8888 || format > GBCORE_PIXEL_FORMAT_GRAYSCALE8) return GBCORE_ERROR_INVALID_ARGUMENT;
+
+    Framebuffer::PixelFormat pixelFormat = static_cast<Framebuffer::PixelFormat>(format);
+    if (dst_size < size_t(Framebuffer::sc_width) * Framebuffer::sc_height * Framebuffer::getBytesPerPixel(pixelFormat))
+    {
+        return GBCORE_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    core->m_emulator->getFrameQueue()->acquireLatestFrame().convertTo(pixelFormat, static_cast<uint8_t*>(dst));
+    return GBCORE_OK;
+}
+
+const float* gbcore_get_audio_samples(gbcore* core, size_t* num_samples)
+{
+    if (!num_samples) return nullptr;
+    *num_samples = 0;
+    if (!core) return nullptr;
+
+    return core->m_emulator->getCapturedAudioSamples(num_samples);
+}
+
+size_t gbcore_get_state_size(gbcore* core)
+{
+    return core ? core->m_emulator->getStateSize() : 0;
+}
+
+gbcore_result gbcore_save_state(gbcore* core, void* buffer, size_t buffer_size, size_t* state_size)
+{
+    if (!core || !buffer) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(core)) return GBCORE_ERROR_NO_ROM;
+
+    size_t size = 0;
+    bool isSaved = core->m_emulator->saveState(static_cast<uint8_t*>(buffer), buffer_size, &size);
+    if (state_size)
+    {
+        *state_size = size;
+    }
+    return isSaved ? GBCORE_OK : GBCORE_ERROR_BUFFER_TOO_SMALL;
+}
+
+gbcore_result gbcore_load_state(gbcore* core, const void* state, size_t state_size)
+{
+    if (!core || !state) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(core)) return GBCORE_ERROR_NO_ROM;
+
+    bool isLoaded = core->m_emulator->loadState(static_cast<uint8_t const*>(state), state_size);
+    return isLoaded ? GBCORE_OK : GBCORE_ERROR_INVALID_STATE;
+}
+
+gbcore_result gbcore_clone(gbcore* destination, const gbcore* source)
+{
+    if (!destination || !source) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(source)) return GBCORE_ERROR_NO_ROM;
+
+    return callWithoutExceptions([destination, source]()
+        {
+            bool isCloned = destination->m_emulator->cloneFrom(*source->m_emulator);
+            return isCloned ? GBCORE_OK : GBCORE_ERROR_INVALID_STATE;
+        });
+}
+
+uint8_t gbcore_read_memory(gbcore* core, uint16_t address)
+{
+    return core ? core->m_emulator->readMemory(address) : 0xFF;
+}
+
+gbcore_result gbcore_write_memory(gbcore* core, uint16_t address, uint8_t value)
+{
+    if (!core) return GBCORE_ERROR_INVALID_ARGUMENT;
+    if (!hasRom(core)) return GBCORE_ERROR_NO_ROM;
+
+    core->m_emulator->writeMemory(address, value);
+    return GBCORE_OK;
+}
@@ -0,0 +1,138 @@
+#ifndef GBCORE_H
+#define GBCORE_H
+
+/*
+ * Plain C interface to the emulator core, for embedding it in harnesses written in other languages.
+ *
+ * Every function takes the instance it works on; instances are independent and may be driven from different
+ * threads, but a single instance must only be used by one thread at a time. Pointers handed out by the
+ * library point into the instance and stay valid until the call noted next to each function.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+    #if defined(GBCORE_BUILD_DLL)
+        #define GBCORE_API __declspec(dllexport)
+    #else
+        #define GBCORE_API __declspec(dllimport)
+    #endif
+#else
+    #define GBCORE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever a function signature or struct layout changes */
+#define GBCORE_API_VERSION 1
+
+typedef struct gbcore gbcore;
+
+typedef enum gbcore_result
+{
+    GBCORE_OK = 0,
+    GBCORE_ERROR_INVALID_ARGUMENT = -1,
+    GBCORE_ERROR_NO_ROM = -2,
+    GBCORE_ERROR_ROM_LOAD_FAILED = -3,
+    GBCORE_ERROR_BUFFER_TOO_SMALL = -4,
+    GBCORE_ERROR_UNSUPPORTED = -5,
+    GBCORE_ERROR_INVALID_STATE = -6,
+    GBCORE_ERROR_OUT_OF_MEMORY = -7,
+} gbcore_result;
+
+/* gbcore_create flags, all off gives a silent instance that only talks to the caller */
+#define GBCORE_CREATE_AUDIO_OUTPUT      0x1u /* Play audio on the default device, also paces emulation to real time */
+#define GBCORE_CREATE_CONTROLLER_INPUT  0x2u /* Read the first XInput controller */
+#define GBCORE_CREATE_PERSIST_SAVES     0x4u /* Load and save .sav/.rtc files next to ROMs loaded from a path */
+#define GBCORE_CREATE_CAPTURE_AUDIO     0x8u /* Keep samples for gbcore_get_audio_samples */
+
+/* gbcore_set_buttons bits */
+#define GBCORE_BUTTON_RIGHT   0x01u
+#define GBCORE_BUTTON_LEFT    0x02u
+#define GBCORE_BUTTON_UP      0x04u
+#define GBCORE_BUTTON_DOWN    0x08u
+#define GBCORE_BUTTON_A       0x10u
+#define GBCORE_BUTTON_B       0x20u
+#define GBCORE_BUTTON_SELECT  0x40u
+#define GBCORE_BUTTON_START   0x80u
+
+#define GBCORE_SCREEN_WIDTH   160
+#define GBCORE_SCREEN_HEIGHT  144
+#define GBCORE_AUDIO_SAMPLE_RATE 48000
+
+/* The 32-bit formats are opaque, alpha is always 0xFF */
+typedef enum gbcore_pixel_format
+{
+    GBCORE_PIXEL_FORMAT_RGBA8888 = 0,
+    GBCORE_PIXEL_FORMAT_BGRA8888 = 1,
+    GBCORE_PIXEL_FORMAT_RGB565 = 2,
+    GBCORE_PIXEL_FORMAT_GRAYSCALE8 = 3,
+} gbcore_pixel_format;
+
+/* The most recent complete frame, as the core stores it. DMG frames are one shade (0-3, 4 for a blank screen)
+   per pixel in shades, CGB frames one 15-bit BGR color per pixel in colors. Rows are GBCORE_SCREEN_WIDTH
+   pixels, without padding. */
+typedef struct gbcore_frame
+{
+    const uint8_t* shades;
+    const uint16_t* colors;
+    uint32_t width;
+    uint32_t height;
+    int32_t is_cgb;
+    uint64_t sequence_number; /* 0 until the first frame has been completed */
+} gbcore_frame;
+
+GBCORE_API uint32_t gbcore_get_api_version(void);
+GBCORE_API const char* gbcore_result_string(gbcore_result result);
+
+/* Returns NULL if the instance couldn't be created */
+GBCORE_API gbcore* gbcore_create(uint32_t flags);
+GBCORE_API void gbcore_destroy(gbcore* core);
+
+GBCORE_API gbcore_result gbcore_load_rom_file(gbcore* core, const char* path);
+/* The ROM is copied, the caller's buffer can be freed right after */
+GBCORE_API gbcore_result gbcore_load_rom_memory(gbcore* core, const void* rom, size_t rom_size);
+
+/* Runs to the end of the next frames (VBlank), or a frame's worth of cycles while the LCD is off */
+GBCORE_API gbcore_result gbcore_run_frames(gbcore* core, uint32_t num_frames);
+/* Runs at least num_cycles cycles at 4.19 MHz, finishing the instruction in progress */
+GBCORE_API gbcore_result gbcore_run_cycles(gbcore* core, uint64_t num_cycles);
+GBCORE_API uint64_t gbcore_get_frame_count(const gbcore* core);
+GBCORE_API uint64_t gbcore_get_cycle_count(const gbcore* core);
+
+/* Combination of GBCORE_BUTTON_* bits currently held, applies until changed */
+GBCORE_API gbcore_result gbcore_set_buttons(gbcore* core, uint8_t buttons);
+
+/* Zero-copy access to the latest frame; the pointers stay valid until the next gbcore_get_frame,
+   gbcore_convert_frame or ROM load on this instance */
+GBCORE_API gbcore_result gbcore_get_frame(gbcore* core, gbcore_frame* frame);
+/* Converts the latest frame, dst needs GBCORE_SCREEN_WIDTH * GBCORE_SCREEN_HEIGHT * bytes per pixel */
+GBCORE_API gbcore_result gbcore_convert_frame(gbcore* core, gbcore_pixel_format format, void* dst, size_t dst_size);
+
+/* Interleaved stereo float samples generated by the last gbcore_run_* call, needs GBCORE_CREATE_CAPTURE_AUDIO.
+   num_samples counts floats, two per stereo frame. Valid until the next gbcore_run_* call or ROM load. */
+GBCORE_API const float* gbcore_get_audio_samples(gbcore* core, size_t* num_samples);
+
+/* Size a save state buffer needs, fixed for a loaded ROM. state_size (optional) receives the same size, also when
+   the buffer is too small. States saved between gbcore_run_frames calls reproduce every following frame exactly. */
+GBCORE_API size_t gbcore_get_state_size(gbcore* core);
+GBCORE_API gbcore_result gbcore_save_state(gbcore* core, void* buffer, size_t buffer_size, size_t* state_size);
+/* States of another ROM or library version are rejected with GBCORE_ERROR_INVALID_STATE and leave the instance as is */
+GBCORE_API gbcore_result gbcore_load_state(gbcore* core, const void* state, size_t state_size);
+/* Turns destination into a copy of source, sharing its ROM instead of copying it; destination keeps its own create
+   flags. Cloning into an instance already cloned from the same ROM only copies the state, the cheap way to reset
+   many instances to one snapshot. source must not be running on another thread meanwhile. */
+GBCORE_API gbcore_result gbcore_clone(gbcore* destination, const gbcore* source);
+
+/* Access through the memory map, as the CPU sees it, so writes to ROM addresses talk to the memory bank controller */
+GBCORE_API uint8_t gbcore_read_memory(gbcore* core, uint16_t address);
+GBCORE_API gbcore_result gbcore_write_memory(gbcore* core, uint16_t address, uint8_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
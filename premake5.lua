@@ -1,3 +1,15 @@
+newoption
+{
+	trigger = "instrumentation",
+	value = "LEVEL",
+	description = "Compile in the timeline instrumentation zones of src/Instrumentation.h",
+	allowed =
+	{
+		{ "zones", "Frame, scanline, interrupt, audio output and save I/O zones" },
+		{ "detail", "Also the zones entered once per instruction" },
+	},
+}
+
 workspace "gb_emulator"
 	configurations { "Debug", "Debugopt", "Release" }
 	system "Windows"
@@ -35,17 +47,36 @@ filter "Release"
 	debugdir "build/bin/release"
 	flags "LinkTimeOptimization"
 
+filter "options:instrumentation=zones"
+	defines { "EMULATOR_INSTRUMENTATION" }
+
+filter "options:instrumentation=detail"
+	defines { "EMULATOR_INSTRUMENTATION", "EMULATOR_INSTRUMENTATION_DETAIL" }
+
+filter {}
+
 include "external/dx12_renderer"
 
-project "gb_emulator"
-	kind "WindowedApp"
+-- Everything but the window, renderer and UI, shared by the app and the tools
+project "gb_core"
+	kind "StaticLib"
 	files
 	{
 		"src/**.h",
 		"src/**.cpp",
 	}
+	removefiles { "src/main.cpp" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"external/SDL2-2.30.3/include",
+	}
+
+project "gb_emulator"
+	kind "WindowedApp"
+	files { "src/main.cpp" }
 	libdirs {"external/SDL2-2.30.3/lib/x64/", "external/"}
-	links { "dx12_renderer", "SDL2", "Xinput" }
+	links { "gb_core", "dx12_renderer", "SDL2", "Xinput", "Winmm", "Dwmapi" }
 	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
 	includedirs { 
 		"src",
@@ -58,3 +89,118 @@ project "gb_emulator"
 		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
 	}
 
+project "gb_batch"
+	kind "ConsoleApp"
+	files { "tools/gb_batch/**.h", "tools/gb_batch/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
+project "gb_headless"
+	kind "ConsoleApp"
+	files { "tools/gb_headless/**.h", "tools/gb_headless/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
+-- SM83 assembler and synthetic workload ROMs, shared by gb_romgen and gb_bench
+project "romgen"
+	kind "StaticLib"
+	files { "tools/romgen/**.h", "tools/romgen/**.cpp" }
+	includedirs { "tools/romgen" }
+
+project "gb_romgen"
+	kind "ConsoleApp"
+	files { "tools/gb_romgen/**.h", "tools/gb_romgen/**.cpp" }
+	links { "romgen" }
+	includedirs { "tools/romgen" }
+
+project "gb_bench"
+	kind "ConsoleApp"
+	files { "tools/gb_bench/**.h", "tools/gb_bench/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "romgen", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"tools/romgen",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
+project "gb_tests"
+	kind "ConsoleApp"
+	files { "tools/gb_tests/**.h", "tools/gb_tests/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "romgen", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"tools/romgen",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
+project "gb_tracedump"
+	kind "ConsoleApp"
+	files { "tools/gb_tracedump/**.h", "tools/gb_tracedump/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
+-- C API for embedding the core from other languages
+project "gbcore"
+	kind "SharedLib"
+	removeflags { "NoImportLib" }
+	files { "capi/**.h", "capi/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN", "GBCORE_BUILD_DLL" }
+	includedirs { 
+		"src",
+		"capi",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
+project "gb_vecenv_bench"
+	kind "ConsoleApp"
+	files { "tools/gb_vecenv_bench/**.h", "tools/gb_vecenv_bench/**.cpp" }
+	libdirs {"external/SDL2-2.30.3/lib/x64/"}
+	links { "gb_core", "SDL2", "Xinput" }
+	defines { "NOMINMAX", "WIN32_LEAN_AND_MEAN" }
+	includedirs { 
+		"src",
+		"external/SDL2-2.30.3/include",
+	}
+	prebuildcommands {
+		"{COPYFILE} " .. _WORKING_DIR .. "/external/SDL2-2.30.3/lib/x64/SDL2.dll %{cfg.buildtarget.directory}",
+	}
+
@@ -0,0 +1,119 @@
+#include "BatchRunner.h"
+
+#include <chrono>
+
+#include "Emulator.h"
+#include "ThreadPool.h"
+#include "Movie.h"
+
+BatchRunner::BatchRunner(ThreadPool* threadPool)
+    : m_threadPool(threadPool)
+{
+}
+
+std::vector<BatchRunner::Result> BatchRunner::run(std::vector<Job> const& jobs, Summary* summary)
+{
+    std::vector<Result> results(jobs.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        // Every job only writes its own result slot
+        m_threadPool->submit([&jobs, &results, i](uint32_t workerIndex)
+            {
+                results[i] = runJob(jobs[i]);
+                results[i].m_workerIndex = workerIndex;
+            });
+    }
+    m_threadPool->waitForIdle();
+    auto end = std::chrono::steady_clock::now();
+
+    if (summary)
+    {
+        summary->m_numFramesRun = 0;
+        for (Result const& result : results)
+        {
+            summary->m_numFramesRun += result.m_numFramesRun;
+        }
+        summary->m_wallSeconds = std::chrono::duration<double>(end - start).count();
+    }
+
+    return results;
+}
+
+BatchRunner::Result BatchRunner::runJob(Job const& job)
+{
+    Result result;
+
+    Emulator::Config config;
+    config.m_enableAudioOutput = false;
+    config.m_enableControllerInput = false;
+    config.m_persistBatteryBackedRam = false;
+
+    // Created here so its memory is first touched by, and local to, the worker running the job
+    auto emulator = std::make_unique<Emulator>(config);
+    emulator->setFrameSkip(Emulator::FrameSkipMode::OnRequest);
+    result.m_hasOpenedRomFile = emulator->openRomFile(job.m_romFilename.c_str());
+    if (!result.m_hasOpenedRomFile)
+    {
+        return result;
+    }
+
+    MoviePlayer moviePlayer;
+    if (job.m_movie && !moviePlayer.start(*emulator, job.m_movie.get()))
+    {
+        result.m_isDesynced = true;
+        return result;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    size_t nextInput = 0;
+    uint32_t numFrames = job.m_movie ? UINT32_MAX : job.m_numFrames;
+    uint32_t frame = 0;
+    for (; frame < numFrames; frame++)
+    {
+        while (nextInput < job.m_inputs.size() && job.m_inputs[nextInput].m_frame <= frame)
+        {
+            InputEvent const& input = job.m_inputs[nextInput++];
+            emulator->setButtonPressed(input.m_button, input.m_isPressed);
+        }
+
+        bool isLastFrame = frame + 1 == numFrames;
+        bool hashFrame = isLastFrame || (job.m_hashInterval != 0 && (frame + 1) % job.m_hashInterval == 0);
+        // A movie's last frame is only known once it has run, so movie replays render every frame
+        if (hashFrame || job.m_movie)
+        {
+            emulator->requestNextFrame();
+        }
+
+        if (job.m_movie)
+        {
+            MoviePlayer::Status status = moviePlayer.runFrame(*emulator);
+            if (status != MoviePlayer::Status::Playing)
+            {
+                result.m_isDesynced = status == MoviePlayer::Status::Desynced;
+                result.m_desyncCycle = moviePlayer.getDesyncCycle();
+                hashFrame = true;
+                numFrames = frame + 1;
+            }
+        }
+        else
+        {
+            emulator->runFrame();
+        }
+
+        if (hashFrame)
+        {
+            // While the LCD is off nothing new gets published, so this hashes what the screen still shows
+            uint64_t hash = emulator->getFrameQueue()->acquireLatestFrame().computeHash();
+            result.m_frameHashes.push_back(hash);
+            result.m_finalFrameHash = hash;
+        }
+    }
+
+    result.m_numFramesRun = frame;
+    result.m_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    return result;
+}
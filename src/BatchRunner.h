@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Joypad.h"
+
+class ThreadPool;
+struct Movie;
+
+// Runs many independent emulator instances on a ThreadPool, one job per instance, for regression runs and
+// training farms. Instances run headless and as fast as possible: no audio device, no controller polling,
+// no .sav files, and frames are only rendered when they're about to be hashed.
+class BatchRunner
+{
+public:
+    struct InputEvent
+    {
+        uint32_t m_frame = 0; // Applied right before this frame is emulated
+        Joypad::Button m_button = Joypad::Button::A;
+        bool m_isPressed = true;
+    };
+
+    struct Job
+    {
+        std::string m_romFilename;
+        uint32_t m_numFrames = 60;
+        std::vector<InputEvent> m_inputs; // Sorted by frame
+        uint32_t m_hashInterval = 1;      // Hash every Nth frame, 0 to only hash the last one
+        // Replayed from its start state instead of m_inputs, until it ends or desyncs, m_numFrames is ignored
+        std::shared_ptr<Movie const> m_movie;
+    };
+
+    struct Result
+    {
+        bool m_hasOpenedRomFile = false;
+        uint32_t m_numFramesRun = 0;
+        std::vector<uint64_t> m_frameHashes;
+        uint64_t m_finalFrameHash = 0;
+        double m_seconds = 0.0;
+        uint32_t m_workerIndex = 0;
+        bool m_isDesynced = false;        // The movie didn't replay like it was recorded, or didn't fit the ROM
+        uint64_t m_desyncCycle = 0;
+
+        double getFramesPerSecond() const { return m_seconds > 0.0 ? m_numFramesRun / m_seconds : 0.0; }
+    };
+
+    struct Summary
+    {
+        uint64_t m_numFramesRun = 0;
+        double m_wallSeconds = 0.0;
+
+        double getFramesPerSecond() const { return m_wallSeconds > 0.0 ? m_numFramesRun / m_wallSeconds : 0.0; }
+    };
+
+    BatchRunner(ThreadPool* threadPool);
+
+    std::vector<Result> run(std::vector<Job> const& jobs, Summary* summary = nullptr);
+    static Result runJob(Job const& job);
+
+private:
+    ThreadPool* m_threadPool;
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <Windows.h>
 #include <cmath>
+#include <algorithm>
 
 #ifdef EMULATOR_DEBUG
 #include <string>
@@ -13,14 +14,14 @@
 #include "Emulator.h"
 #include "Memory.h"
 #include "Joypad.h"
-
-uint64_t CPU::s_frequencyHz = s_normalSpeedFrequencyHz;
-
-#ifdef EMULATOR_DEBUG
-std::ofstream logFile;
-#endif
-CPU::CPU(Memory* memory, Joypad* joypad)
-    : m_memory(memory)
+#include "SaveState.h"
+#include "GuestProfiler.h"
+#include "InstructionTrace.h"
+#include "Instrumentation.h"
+
+CPU::CPU(Emulator* emulator, Memory* memory, Joypad* joypad)
+    : m_emulator(emulator)
+    , m_memory(memory)
     , m_joypad(joypad)
     , m_interruptMasterEnableFlag(true)
     , m_isHalted(false)
@@ -67,32 +68,89 @@ CPU::CPU(Memory* memory, Joypad* joypad)
     memory->write(0xFF4B, 0x00); // WX
     memory->write(0xFFFF, 0x00); // IE
 
-    if (Emulator::isCGBMode())
+    if (m_emulator->isCGBMode())
     {
         m_registers.A = 0x11;
     }
-
-#ifdef EMULATOR_DEBUG
-    //logFile.open("log.txt", std::ofstream::out | std::ofstream::trunc);
-#endif
 }
 
 CPU::~CPU()
 {
 }
 
+inline uint8_t CPU::readMemory(uint16_t address)
+{
+    m_memoryReadCounts[EmulatorStats::getMemoryRegion(address)]++;
+    return m_memory->read(address);
+}
+
+inline void CPU::writeMemory(uint16_t address, uint8_t value)
+{
+    m_memoryWriteCounts[EmulatorStats::getMemoryRegion(address)]++;
+    m_memory->write(address, value);
+}
+
+void CPU::collectStats(EmulatorStats& stats) const
+{
+    stats.m_instructions = m_instructionCount;
+    std::copy(std::begin(m_interruptCounts), std::end(m_interruptCounts), stats.m_interrupts);
+    std::copy(std::begin(m_memoryReadCounts), std::end(m_memoryReadCounts), stats.m_memoryReads);
+    std::copy(std::begin(m_memoryWriteCounts), std::end(m_memoryWriteCounts), stats.m_memoryWrites);
+}
+
+void CPU::restoreStats(EmulatorStats const& stats)
+{
+    m_instructionCount = stats.m_instructions;
+    std::copy(std::begin(stats.m_interrupts), std::end(stats.m_interrupts), m_interruptCounts);
+    std::copy(std::begin(stats.m_memoryReads), std::end(stats.m_memoryReads), m_memoryReadCounts);
+    std::copy(std::begin(stats.m_memoryWrites), std::end(stats.m_memoryWrites), m_memoryWriteCounts);
+}
+
 void CPU::requestInterrupt(Interrupt interrupt)
 {
     m_memory->write(0xFF0F, m_memory->read(0xFF0F) | (1 << interrupt));
 }
 
+void CPU::saveState(SaveStateWriter& writer) const
+{
+    writer.write(m_registers.AF);
+    writer.write(m_registers.BC);
+    writer.write(m_registers.DE);
+    writer.write(m_registers.HL);
+    writer.write(m_registers.SP);
+    writer.write(m_registers.PC);
+    writer.write(m_interruptMasterEnableFlag);
+    writer.write(m_isHalted);
+    writer.write(m_hadPendingInterruptsWhenHalted);
+    writer.write(m_hasWrittenToDIVLastCycle);
+    writer.write(m_frequencyHz);
+}
+
+void CPU::loadState(SaveStateReader& reader)
+{
+    reader.read(m_registers.AF);
+    reader.read(m_registers.BC);
+    reader.read(m_registers.DE);
+    reader.read(m_registers.HL);
+    reader.read(m_registers.SP);
+    reader.read(m_registers.PC);
+    reader.read(m_interruptMasterEnableFlag);
+    reader.read(m_isHalted);
+    reader.read(m_hadPendingInterruptsWhenHalted);
+    reader.read(m_hasWrittenToDIVLastCycle);
+    reader.read(m_frequencyHz);
+}
+
 uint64_t CPU::executeInstruction()
 {
     m_hasWrittenToDIVLastCycle = false;
 
     if (areTherePendingInterrupts())
     {
+        INSTRUMENT_ZONE("Interrupt dispatch");
         jumpToPendingInterrupts();
+        if (m_guestProfiler) m_guestProfiler->recordInterruptDispatch();
+        if (m_instructionTrace) m_instructionTrace->recordInterruptDispatch();
         return 5;
     }
 
@@ -102,9 +160,10 @@ uint64_t CPU::executeInstruction()
     }
 
     uint8_t opcode = 0x00;
+    uint16_t opcodeAddress = m_registers.PC;
     if (m_isHalted && !m_interruptMasterEnableFlag && m_hadPendingInterruptsWhenHalted)
     {
-        opcode = m_memory->read(++m_registers.PC);
+        opcode = readMemory(opcodeAddress = ++m_registers.PC);
         m_isHalted = false;
     }
     else if (m_isHalted && !m_interruptMasterEnableFlag && !m_hadPendingInterruptsWhenHalted)
@@ -114,7 +173,7 @@ uint64_t CPU::executeInstruction()
         bool areThereAnyPendingInterrupts = (interruptFlag & interruptEnable) != 0;
         if (areThereAnyPendingInterrupts)
         {
-            opcode = m_memory->read(++m_registers.PC);
+            opcode = readMemory(opcodeAddress = ++m_registers.PC);
             m_isHalted = false;
         }
     }
@@ -124,10 +183,14 @@ uint64_t CPU::executeInstruction()
     }
     else
     {
-        opcode = m_memory->read(m_registers.PC++);
+        opcode = readMemory(m_registers.PC++);
+    }
+    m_instructionCount++;
+    if (m_guestProfiler) m_guestProfiler->recordOpcode(opcode);
+    if (m_instructionTrace)
+    {
+        m_instructionTrace->record(*m_memory, opcodeAddress, opcode, m_registers.AF, m_registers.BC, m_registers.DE, m_registers.HL, m_registers.SP);
     }
-    //if (opcode == 0xFA && m_registers.PC - 1 == 0X4003) DebugBreak();
-    //logFile << std::format("{:X} {:X}\n", m_registers.PC - 1, opcode).c_str();
 
     uint16_t address = 0;
     uint8_t offset = 0;
@@ -144,7 +207,8 @@ uint64_t CPU::executeInstruction()
 
         // Prefixed operations
     case 0xCB:
-        n = m_memory->read(m_registers.PC++);
+        n = readMemory(m_registers.PC++);
+        if (m_guestProfiler) m_guestProfiler->recordCBOpcode(n);
         switch (n)
         {
         case 0x37:
@@ -211,9 +275,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x36:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             n = ((n & 0xF0) >> 4) | ((n & 0x0F) << 4);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             m_registers.F = 0;
             if (n == 0)
             {
@@ -252,9 +316,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x06:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             rotateRegisterLeft(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x17:
@@ -286,9 +350,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x16:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             rotateRegisterLeftThroughCarry(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x0F:
@@ -320,9 +384,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x0E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             rotateRegisterRight(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x1F:
@@ -354,9 +418,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x1E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             rotateRegisterRightThroughCarry(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
 
@@ -390,9 +454,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x26:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             shiftRegisterLeftArithmetically(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x2F:
@@ -424,9 +488,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x2E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             shiftRegisterRightArithmetically(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x3F:
@@ -458,9 +522,9 @@ uint64_t CPU::executeInstruction()
             return 8;
             break;
         case 0x3E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             shiftRegisterRightLogically(n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
 
@@ -472,7 +536,7 @@ uint64_t CPU::executeInstruction()
         case 0x44: testBitInRegister(0, m_registers.H); return 8; break;
         case 0x45: testBitInRegister(0, m_registers.L); return 8; break;
         case 0x46:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(0, n);
             return 12;
             break;
@@ -485,7 +549,7 @@ uint64_t CPU::executeInstruction()
         case 0x4C: testBitInRegister(1, m_registers.H); return 8; break;
         case 0x4D: testBitInRegister(1, m_registers.L); return 8; break;
         case 0x4E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(1, n);
             return 12;
             break;
@@ -498,7 +562,7 @@ uint64_t CPU::executeInstruction()
         case 0x54: testBitInRegister(2, m_registers.H); return 8; break;
         case 0x55: testBitInRegister(2, m_registers.L); return 8; break;
         case 0x56:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(2, n);
             return 12;
             break;
@@ -511,7 +575,7 @@ uint64_t CPU::executeInstruction()
         case 0x5C: testBitInRegister(3, m_registers.H); return 8; break;
         case 0x5D: testBitInRegister(3, m_registers.L); return 8; break;
         case 0x5E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(3, n);
             return 12;
             break;
@@ -524,7 +588,7 @@ uint64_t CPU::executeInstruction()
         case 0x64: testBitInRegister(4, m_registers.H); return 8; break;
         case 0x65: testBitInRegister(4, m_registers.L); return 8; break;
         case 0x66:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(4, n);
             return 12;
             break;
@@ -537,7 +601,7 @@ uint64_t CPU::executeInstruction()
         case 0x6C: testBitInRegister(5, m_registers.H); return 8; break;
         case 0x6D: testBitInRegister(5, m_registers.L); return 8; break;
         case 0x6E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(5, n);
             return 12;
             break;
@@ -550,7 +614,7 @@ uint64_t CPU::executeInstruction()
         case 0x74: testBitInRegister(6, m_registers.H); return 8; break;
         case 0x75: testBitInRegister(6, m_registers.L); return 8; break;
         case 0x76:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(6, n);
             return 12;
             break;
@@ -563,7 +627,7 @@ uint64_t CPU::executeInstruction()
         case 0x7C: testBitInRegister(7, m_registers.H); return 8; break;
         case 0x7D: testBitInRegister(7, m_registers.L); return 8; break;
         case 0x7E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             testBitInRegister(7, n);
             return 12;
             break;
@@ -576,9 +640,9 @@ uint64_t CPU::executeInstruction()
         case 0x84: resetBitInRegister(0, m_registers.H); return 8; break;
         case 0x85: resetBitInRegister(0, m_registers.L); return 8; break;
         case 0x86:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(0, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x87: resetBitInRegister(0, m_registers.A); return 8; break;
@@ -590,9 +654,9 @@ uint64_t CPU::executeInstruction()
         case 0x8C: resetBitInRegister(1, m_registers.H); return 8; break;
         case 0x8D: resetBitInRegister(1, m_registers.L); return 8; break;
         case 0x8E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(1, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x8F: resetBitInRegister(1, m_registers.A); return 8; break;
@@ -604,9 +668,9 @@ uint64_t CPU::executeInstruction()
         case 0x94: resetBitInRegister(2, m_registers.H); return 8; break;
         case 0x95: resetBitInRegister(2, m_registers.L); return 8; break;
         case 0x96:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(2, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x97: resetBitInRegister(2, m_registers.A); return 8; break;
@@ -618,9 +682,9 @@ uint64_t CPU::executeInstruction()
         case 0x9C: resetBitInRegister(3, m_registers.H); return 8; break;
         case 0x9D: resetBitInRegister(3, m_registers.L); return 8; break;
         case 0x9E:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(3, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0x9F: resetBitInRegister(3, m_registers.A); return 8; break;
@@ -632,9 +696,9 @@ uint64_t CPU::executeInstruction()
         case 0xA4: resetBitInRegister(4, m_registers.H); return 8; break;
         case 0xA5: resetBitInRegister(4, m_registers.L); return 8; break;
         case 0xA6:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(4, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xA7: resetBitInRegister(4, m_registers.A); return 8; break;
@@ -646,9 +710,9 @@ uint64_t CPU::executeInstruction()
         case 0xAC: resetBitInRegister(5, m_registers.H); return 8; break;
         case 0xAD: resetBitInRegister(5, m_registers.L); return 8; break;
         case 0xAE:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(5, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xAF: resetBitInRegister(5, m_registers.A); return 8; break;
@@ -660,9 +724,9 @@ uint64_t CPU::executeInstruction()
         case 0xB4: resetBitInRegister(6, m_registers.H); return 8; break;
         case 0xB5: resetBitInRegister(6, m_registers.L); return 8; break;
         case 0xB6:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(6, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xB7: resetBitInRegister(6, m_registers.A); return 8; break;
@@ -674,9 +738,9 @@ uint64_t CPU::executeInstruction()
         case 0xBC: resetBitInRegister(7, m_registers.H); return 8; break;
         case 0xBD: resetBitInRegister(7, m_registers.L); return 8; break;
         case 0xBE:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             resetBitInRegister(7, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xBF: resetBitInRegister(7, m_registers.A); return 8; break;
@@ -688,9 +752,9 @@ uint64_t CPU::executeInstruction()
         case 0xC4: setBitInRegister(0, m_registers.H); return 8; break;
         case 0xC5: setBitInRegister(0, m_registers.L); return 8; break;
         case 0xC6:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(0, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xC7: setBitInRegister(0, m_registers.A); return 8; break;
@@ -702,9 +766,9 @@ uint64_t CPU::executeInstruction()
         case 0xCC: setBitInRegister(1, m_registers.H); return 8; break;
         case 0xCD: setBitInRegister(1, m_registers.L); return 8; break;
         case 0xCE:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(1, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xCF: setBitInRegister(1, m_registers.A); return 8; break;
@@ -716,9 +780,9 @@ uint64_t CPU::executeInstruction()
         case 0xD4: setBitInRegister(2, m_registers.H); return 8; break;
         case 0xD5: setBitInRegister(2, m_registers.L); return 8; break;
         case 0xD6:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(2, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xD7: setBitInRegister(2, m_registers.A); return 8; break;
@@ -730,9 +794,9 @@ uint64_t CPU::executeInstruction()
         case 0xDC: setBitInRegister(3, m_registers.H); return 8; break;
         case 0xDD: setBitInRegister(3, m_registers.L); return 8; break;
         case 0xDE:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(3, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xDF: setBitInRegister(3, m_registers.A); return 8; break;
@@ -744,9 +808,9 @@ uint64_t CPU::executeInstruction()
         case 0xE4: setBitInRegister(4, m_registers.H); return 8; break;
         case 0xE5: setBitInRegister(4, m_registers.L); return 8; break;
         case 0xE6:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(4, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xE7: setBitInRegister(4, m_registers.A); return 8; break;
@@ -758,9 +822,9 @@ uint64_t CPU::executeInstruction()
         case 0xEC: setBitInRegister(5, m_registers.H); return 8; break;
         case 0xED: setBitInRegister(5, m_registers.L); return 8; break;
         case 0xEE:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(5, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xEF: setBitInRegister(5, m_registers.A); return 8; break;
@@ -772,9 +836,9 @@ uint64_t CPU::executeInstruction()
         case 0xF4: setBitInRegister(6, m_registers.H); return 8; break;
         case 0xF5: setBitInRegister(6, m_registers.L); return 8; break;
         case 0xF6:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(6, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xF7: setBitInRegister(6, m_registers.A); return 8; break;
@@ -786,9 +850,9 @@ uint64_t CPU::executeInstruction()
         case 0xFC: setBitInRegister(7, m_registers.H); return 8; break;
         case 0xFD: setBitInRegister(7, m_registers.L); return 8; break;
         case 0xFE:
-            n = m_memory->read(m_registers.HL);
+            n = readMemory(m_registers.HL);
             setBitInRegister(7, n);
-            m_memory->write(m_registers.HL, n);
+            writeMemory(m_registers.HL, n);
             return 16;
             break;
         case 0xFF: setBitInRegister(7, m_registers.A); return 8; break;
@@ -872,7 +936,7 @@ uint64_t CPU::executeInstruction()
         // in DMG mode behaves like a HALT
         // Technically not correct, but eh, should be fine
         // TODO maybe fix this in the future
-        if (!Emulator::isCGBMode())
+        if (!m_emulator->isCGBMode())
         {
             m_registers.PC--;
         }
@@ -881,7 +945,7 @@ uint64_t CPU::executeInstruction()
             // Check if speed switch
             if (m_memory->read(0xFF4D) & 1)
             {
-                s_frequencyHz = isDoubleSpeedMode() ? CPU::s_normalSpeedFrequencyHz : CPU::s_doubleSpeedFrequencyHz;
+                m_frequencyHz = isDoubleSpeedMode() ? CPU::s_normalSpeedFrequencyHz : CPU::s_doubleSpeedFrequencyHz;
                 m_memory->write(0xFF4D, 0);
                 return 8200;
             }
@@ -900,27 +964,27 @@ uint64_t CPU::executeInstruction()
 
         // 8-bit load operations
     case 0x06:
-        m_registers.B = m_memory->read(m_registers.PC++);
+        m_registers.B = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x0E:
-        m_registers.C = m_memory->read(m_registers.PC++);
+        m_registers.C = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x16:
-        m_registers.D = m_memory->read(m_registers.PC++);
+        m_registers.D = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x1E:
-        m_registers.E = m_memory->read(m_registers.PC++);
+        m_registers.E = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x26:
-        m_registers.H = m_memory->read(m_registers.PC++);
+        m_registers.H = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x2E:
-        m_registers.L = m_memory->read(m_registers.PC++);
+        m_registers.L = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x7F:
@@ -952,7 +1016,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x7E:
-        m_registers.A = m_memory->read(m_registers.HL);
+        m_registers.A = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x40:
@@ -980,7 +1044,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x46:
-        m_registers.B = m_memory->read(m_registers.HL);
+        m_registers.B = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x48:
@@ -1008,7 +1072,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x4E:
-        m_registers.C = m_memory->read(m_registers.HL);
+        m_registers.C = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x50:
@@ -1036,7 +1100,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x56:
-        m_registers.D = m_memory->read(m_registers.HL);
+        m_registers.D = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x58:
@@ -1064,7 +1128,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x5E:
-        m_registers.E = m_memory->read(m_registers.HL);
+        m_registers.E = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x60:
@@ -1092,7 +1156,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x66:
-        m_registers.H = m_memory->read(m_registers.HL);
+        m_registers.H = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x68:
@@ -1120,51 +1184,51 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x6E:
-        m_registers.L = m_memory->read(m_registers.HL);
+        m_registers.L = readMemory(m_registers.HL);
         return 8;
         break;
     case 0x70:
-        m_memory->write(m_registers.HL, m_registers.B);
+        writeMemory(m_registers.HL, m_registers.B);
         return 8;
         break;
     case 0x71:
-        m_memory->write(m_registers.HL, m_registers.C);
+        writeMemory(m_registers.HL, m_registers.C);
         return 8;
         break;
     case 0x72:
-        m_memory->write(m_registers.HL, m_registers.D);
+        writeMemory(m_registers.HL, m_registers.D);
         return 8;
         break;
     case 0x73:
-        m_memory->write(m_registers.HL, m_registers.E);
+        writeMemory(m_registers.HL, m_registers.E);
         return 8;
         break;
     case 0x74:
-        m_memory->write(m_registers.HL, m_registers.H);
+        writeMemory(m_registers.HL, m_registers.H);
         return 8;
         break;
     case 0x75:
-        m_memory->write(m_registers.HL, m_registers.L);
+        writeMemory(m_registers.HL, m_registers.L);
         return 8;
         break;
     case 0x36:
-        m_memory->write(m_registers.HL, m_memory->read(m_registers.PC++));
+        writeMemory(m_registers.HL, readMemory(m_registers.PC++));
         return 12;
         break;
     case 0x0A:
-        m_registers.A = m_memory->read(m_registers.BC);
+        m_registers.A = readMemory(m_registers.BC);
         return 8;
         break;
     case 0x1A:
-        m_registers.A = m_memory->read(m_registers.DE);
+        m_registers.A = readMemory(m_registers.DE);
         return 8;
         break;
     case 0xFA:
-        m_registers.A = m_memory->read(((uint16_t)(m_memory->read(m_registers.PC++)) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8));
+        m_registers.A = readMemory(((uint16_t)(readMemory(m_registers.PC++)) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8));
         return 16;
         break;
     case 0x3E:
-        m_registers.A = m_memory->read(m_registers.PC++);
+        m_registers.A = readMemory(m_registers.PC++);
         return 8;
         break;
     case 0x47:
@@ -1192,76 +1256,76 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x02:
-        m_memory->write(m_registers.BC, m_registers.A);
+        writeMemory(m_registers.BC, m_registers.A);
         return 8;
         break;
     case 0x12:
-        m_memory->write(m_registers.DE, m_registers.A);
+        writeMemory(m_registers.DE, m_registers.A);
         return 8;
         break;
     case 0x77:
-        m_memory->write(m_registers.HL, m_registers.A);
+        writeMemory(m_registers.HL, m_registers.A);
         return 8;
         break;
     case 0xEA:
-        m_memory->write(((uint16_t)(m_memory->read(m_registers.PC++)) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8), m_registers.A);
+        writeMemory(((uint16_t)(readMemory(m_registers.PC++)) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8), m_registers.A);
         return 16;
         break;
     case 0xF2:
-        m_registers.A = m_memory->read(0xFF00 + m_registers.C);
+        m_registers.A = readMemory(0xFF00 + m_registers.C);
         return 8;
         break;
     case 0xE2:
         m_hasWrittenToDIVLastCycle = (m_registers.C == 0x04);
-        m_memory->write(0xFF00 + m_registers.C, m_registers.A);
+        writeMemory(0xFF00 + m_registers.C, m_registers.A);
         return 8;
         break;
     case 0x3A:
-        m_registers.A = m_memory->read(m_registers.HL);
+        m_registers.A = readMemory(m_registers.HL);
         m_registers.HL--;
         return 8;
         break;
     case 0x32:
-        m_memory->write(m_registers.HL, m_registers.A);
+        writeMemory(m_registers.HL, m_registers.A);
         m_registers.HL--;
         return 8;
         break;
     case 0x2A:
-        m_registers.A = m_memory->read(m_registers.HL);
+        m_registers.A = readMemory(m_registers.HL);
         m_registers.HL++;
         return 8;
         break;
     case 0x22:
-        m_memory->write(m_registers.HL, m_registers.A);
+        writeMemory(m_registers.HL, m_registers.A);
         m_registers.HL++;
         return 8;
         break;
     case 0xE0:
-        offset = m_memory->read(m_registers.PC++);
+        offset = readMemory(m_registers.PC++);
         m_hasWrittenToDIVLastCycle = (offset == 0x04);
-        m_memory->write(0xFF00 + offset, m_registers.A);
+        writeMemory(0xFF00 + offset, m_registers.A);
         return 12;
         break;
     case 0xF0:
-        m_registers.A = m_memory->read(0xFF00 + m_memory->read(m_registers.PC++));
+        m_registers.A = readMemory(0xFF00 + readMemory(m_registers.PC++));
         return 12;
         break;
 
         // 16-bit load operations
     case 0x01:
-        m_registers.BC = (m_memory->read(m_registers.PC++) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8);
+        m_registers.BC = (readMemory(m_registers.PC++) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8);
         return 12;
         break;
     case 0x11:
-        m_registers.DE = (m_memory->read(m_registers.PC++) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8);
+        m_registers.DE = (readMemory(m_registers.PC++) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8);
         return 12;
         break;
     case 0x21:
-        m_registers.HL = (m_memory->read(m_registers.PC++) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8);
+        m_registers.HL = (readMemory(m_registers.PC++) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8);
         return 12;
         break;
     case 0x31:
-        m_registers.SP = (m_memory->read(m_registers.PC++) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8);
+        m_registers.SP = (readMemory(m_registers.PC++) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8);
         return 12;
         break;
     case 0xF9:
@@ -1270,57 +1334,57 @@ uint64_t CPU::executeInstruction()
         break;
     case 0xF8:
     {
-        int8_t offset = int8_t(m_memory->read(m_registers.PC++));
+        int8_t offset = int8_t(readMemory(m_registers.PC++));
         m_registers.F = getCarryFlagsFor8BitAddition((m_registers.SP & 0xFF), offset) & 0b00111111;
         m_registers.HL = m_registers.SP + offset;
         return 12;
     }
     break;
     case 0x08:
-        address = (m_memory->read(m_registers.PC++) >> 0) | ((uint16_t)(m_memory->read(m_registers.PC++)) << 8);
-        m_memory->write(address, m_registers.SP & 0xFF);
-        m_memory->write(address + 1, m_registers.SP >> 8);
+        address = (readMemory(m_registers.PC++) >> 0) | ((uint16_t)(readMemory(m_registers.PC++)) << 8);
+        writeMemory(address, m_registers.SP & 0xFF);
+        writeMemory(address + 1, m_registers.SP >> 8);
         return 20;
         break;
     case 0xF5:
-        m_memory->write(--m_registers.SP, m_registers.A);
-        m_memory->write(--m_registers.SP, m_registers.F);
+        writeMemory(--m_registers.SP, m_registers.A);
+        writeMemory(--m_registers.SP, m_registers.F);
         return 16;
         break;
     case 0xC5:
-        m_memory->write(--m_registers.SP, m_registers.B);
-        m_memory->write(--m_registers.SP, m_registers.C);
+        writeMemory(--m_registers.SP, m_registers.B);
+        writeMemory(--m_registers.SP, m_registers.C);
         return 16;
         break;
     case 0xD5:
-        m_memory->write(--m_registers.SP, m_registers.D);
-        m_memory->write(--m_registers.SP, m_registers.E);
+        writeMemory(--m_registers.SP, m_registers.D);
+        writeMemory(--m_registers.SP, m_registers.E);
         return 16;
         break;
     case 0xE5:
-        m_memory->write(--m_registers.SP, m_registers.H);
-        m_memory->write(--m_registers.SP, m_registers.L);
+        writeMemory(--m_registers.SP, m_registers.H);
+        writeMemory(--m_registers.SP, m_registers.L);
         return 16;
         break;
     case 0xF1:
-        m_registers.F = m_memory->read(m_registers.SP++);
-        m_registers.A = m_memory->read(m_registers.SP++);
+        m_registers.F = readMemory(m_registers.SP++);
+        m_registers.A = readMemory(m_registers.SP++);
         m_registers.F &= 0xF0;
         return 12;
         break;
     case 0xC1:
-        m_registers.C = m_memory->read(m_registers.SP++);
-        m_registers.B = m_memory->read(m_registers.SP++);
+        m_registers.C = readMemory(m_registers.SP++);
+        m_registers.B = readMemory(m_registers.SP++);
         return 12;
         break;
     case 0xD1:
-        m_registers.E = m_memory->read(m_registers.SP++);
-        m_registers.D = m_memory->read(m_registers.SP++);
+        m_registers.E = readMemory(m_registers.SP++);
+        m_registers.D = readMemory(m_registers.SP++);
         return 12;
         break;
     case 0xE1:
-        m_registers.L = m_memory->read(m_registers.SP++);
-        m_registers.H = m_memory->read(m_registers.SP++);
+        m_registers.L = readMemory(m_registers.SP++);
+        m_registers.H = readMemory(m_registers.SP++);
         return 12;
         break;
 
@@ -1361,13 +1425,13 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x86:
-        n = m_memory->read(m_registers.HL);
+        n = readMemory(m_registers.HL);
         m_registers.F = getCarryFlagsFor8BitAddition(m_registers.A, n);
         m_registers.A += n;
         return 8;
         break;
     case 0xC6:
-        n = m_memory->read(m_registers.PC++);
+        n = readMemory(m_registers.PC++);
         m_registers.F = getCarryFlagsFor8BitAddition(m_registers.A, n);
         m_registers.A += n;
         return 8;
@@ -1486,7 +1550,7 @@ uint64_t CPU::executeInstruction()
         break;
     case 0x8E:
         carry = (m_registers.F & 0b00010000) >> 4;
-        n = m_memory->read(m_registers.HL);
+        n = readMemory(m_registers.HL);
         m_registers.F = getCarryFlagsFor8BitAddition(m_registers.A, n);
         m_registers.A += n;
         m_registers.F |= getCarryFlagsFor8BitAddition(m_registers.A, carry);
@@ -1503,7 +1567,7 @@ uint64_t CPU::executeInstruction()
         break;
     case 0xCE:
         carry = (m_registers.F & 0b00010000) >> 4;
-        n = m_memory->read(m_registers.PC++);
+        n = readMemory(m_registers.PC++);
         m_registers.F = getCarryFlagsFor8BitAddition(m_registers.A, n);
         m_registers.A += n;
         m_registers.F |= getCarryFlagsFor8BitAddition(m_registers.A, carry);
@@ -1554,13 +1618,13 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x96:
-        n = m_memory->read(m_registers.HL);
+        n = readMemory(m_registers.HL);
         m_registers.F = getCarryFlagsFor8BitSubtraction(m_registers.A, n);
         m_registers.A -= n;
         return 8;
         break;
     case 0xD6:
-        n = m_memory->read(m_registers.PC++);
+        n = readMemory(m_registers.PC++);
         m_registers.F = getCarryFlagsFor8BitSubtraction(m_registers.A, n);
         m_registers.A -= n;
         return 8;
@@ -1672,7 +1736,7 @@ uint64_t CPU::executeInstruction()
         break;
     case 0x9E:
         carry = (m_registers.F & 0b00010000) >> 4;
-        n = m_memory->read(m_registers.HL);
+        n = readMemory(m_registers.HL);
         m_registers.F = getCarryFlagsFor8BitAddition(n, carry);
         m_registers.F |= getCarryFlagsFor8BitSubtraction(m_registers.A, n + carry);
         m_registers.A -= n + carry;
@@ -1688,7 +1752,7 @@ uint64_t CPU::executeInstruction()
         break;
     case 0xDE:
         carry = (m_registers.F & 0b00010000) >> 4;
-        n = m_memory->read(m_registers.PC++);
+        n = readMemory(m_registers.PC++);
         m_registers.F = getCarryFlagsFor8BitAddition(n, carry);
         m_registers.F |= getCarryFlagsFor8BitSubtraction(m_registers.A, n + carry);
         m_registers.A -= n + carry;
@@ -1780,7 +1844,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0xA6:
-        n = m_registers.A & m_memory->read(m_registers.HL);
+        n = m_registers.A & readMemory(m_registers.HL);
         newFlag |= 0b00100000;
         if (n == 0)
         {
@@ -1791,7 +1855,7 @@ uint64_t CPU::executeInstruction()
         return 8;
         break;
     case 0xE6:
-        n = m_registers.A & m_memory->read(m_registers.PC++);
+        n = m_registers.A & readMemory(m_registers.PC++);
         newFlag |= 0b00100000;
         if (n == 0)
         {
@@ -1872,7 +1936,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0xB6:
-        n = m_registers.A | m_memory->read(m_registers.HL);
+        n = m_registers.A | readMemory(m_registers.HL);
         if (n == 0)
         {
             newFlag |= 0b10000000;
@@ -1882,7 +1946,7 @@ uint64_t CPU::executeInstruction()
         return 8;
         break;
     case 0xF6:
-        n = m_registers.A | m_memory->read(m_registers.PC++);
+        n = m_registers.A | readMemory(m_registers.PC++);
         if (n == 0)
         {
             newFlag |= 0b10000000;
@@ -1962,7 +2026,7 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0xAE:
-        n = m_registers.A ^ m_memory->read(m_registers.HL);
+        n = m_registers.A ^ readMemory(m_registers.HL);
         if (n == 0)
         {
             newFlag |= 0b10000000;
@@ -1972,7 +2036,7 @@ uint64_t CPU::executeInstruction()
         return 8;
         break;
     case 0xEE:
-        n = m_registers.A ^ m_memory->read(m_registers.PC++);
+        n = m_registers.A ^ readMemory(m_registers.PC++);
         if (n == 0)
         {
             newFlag |= 0b10000000;
@@ -2010,11 +2074,11 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0xBE:
-        m_registers.F = getCarryFlagsFor8BitSubtraction(m_registers.A, m_memory->read(m_registers.HL));
+        m_registers.F = getCarryFlagsFor8BitSubtraction(m_registers.A, readMemory(m_registers.HL));
         return 8;
         break;
     case 0xFE:
-        m_registers.F = getCarryFlagsFor8BitSubtraction(m_registers.A, m_memory->read(m_registers.PC++));
+        m_registers.F = getCarryFlagsFor8BitSubtraction(m_registers.A, readMemory(m_registers.PC++));
         return 8;
         break;
     case 0x3C:
@@ -2053,9 +2117,9 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x34:
-        n = m_memory->read(m_registers.HL);
+        n = readMemory(m_registers.HL);
         m_registers.F = getCarryFlagsFor8BitIncrement(n);
-        m_memory->write(m_registers.HL, n + 1);
+        writeMemory(m_registers.HL, n + 1);
         return 12;
         break;
     case 0x3D:
@@ -2094,9 +2158,9 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x35:
-        n = m_memory->read(m_registers.HL);
+        n = readMemory(m_registers.HL);
         m_registers.F = getCarryFlagsFor8BitDecrement(n);
-        m_memory->write(m_registers.HL, n - 1);
+        writeMemory(m_registers.HL, n - 1);
         return 12;
         break;
 
@@ -2123,7 +2187,7 @@ uint64_t CPU::executeInstruction()
         break;
     case 0xE8:
     {
-        int8_t offset = int8_t(m_memory->read(m_registers.PC++));
+        int8_t offset = int8_t(readMemory(m_registers.PC++));
         m_registers.F = getCarryFlagsFor8BitAddition((m_registers.SP & 0xFF), offset) & 0b00111111;
         m_registers.SP += offset;
         return 16;
@@ -2186,14 +2250,14 @@ uint64_t CPU::executeInstruction()
 
         // Jump operations
     case 0xC3:
-        m_registers.PC = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | (uint16_t(m_memory->read(m_registers.PC++)) << 8);
+        m_registers.PC = (uint16_t(readMemory(m_registers.PC++)) >> 0) | (uint16_t(readMemory(m_registers.PC++)) << 8);
         return 12;
         break;
     case 0xC2:
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 0)
         {
-            m_registers.PC = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | (uint16_t(m_memory->read(m_registers.PC++)) << 8);
+            m_registers.PC = (uint16_t(readMemory(m_registers.PC++)) >> 0) | (uint16_t(readMemory(m_registers.PC++)) << 8);
             return 16;
         }
         m_registers.PC += 2;
@@ -2203,7 +2267,7 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 1)
         {
-            m_registers.PC = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | (uint16_t(m_memory->read(m_registers.PC++)) << 8);
+            m_registers.PC = (uint16_t(readMemory(m_registers.PC++)) >> 0) | (uint16_t(readMemory(m_registers.PC++)) << 8);
             return 16;
         }
         m_registers.PC += 2;
@@ -2213,7 +2277,7 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 0)
         {
-            m_registers.PC = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
+            m_registers.PC = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
             return 16;
         }
         m_registers.PC += 2;
@@ -2223,7 +2287,7 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 1)
         {
-            m_registers.PC = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
+            m_registers.PC = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
             return 16;
         }
         m_registers.PC += 2;
@@ -2234,11 +2298,11 @@ uint64_t CPU::executeInstruction()
         return 4;
         break;
     case 0x18:
-        m_registers.PC += int8_t(m_memory->read(m_registers.PC++));
+        m_registers.PC += int8_t(readMemory(m_registers.PC++));
         return 8;
         break;
     case 0x20:
-        offset = m_memory->read(m_registers.PC++);
+        offset = readMemory(m_registers.PC++);
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 0)
         {
@@ -2248,7 +2312,7 @@ uint64_t CPU::executeInstruction()
         return 8;
         break;
     case 0x28:
-        offset = m_memory->read(m_registers.PC++);
+        offset = readMemory(m_registers.PC++);
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 1)
         {
@@ -2258,7 +2322,7 @@ uint64_t CPU::executeInstruction()
         return 8;
         break;
     case 0x30:
-        offset = m_memory->read(m_registers.PC++);
+        offset = readMemory(m_registers.PC++);
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 0)
         {
@@ -2268,7 +2332,7 @@ uint64_t CPU::executeInstruction()
         return 8;
         break;
     case 0x38:
-        offset = m_memory->read(m_registers.PC++);
+        offset = readMemory(m_registers.PC++);
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 1)
         {
@@ -2280,9 +2344,9 @@ uint64_t CPU::executeInstruction()
 
         // Call operations
     case 0xCD:
-        address = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        address = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = address;
         return 24;
         break;
@@ -2290,9 +2354,9 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 0)
         {
-            address = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
-            m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-            m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+            address = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
+            writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+            writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
             m_registers.PC = address;
             return 24;
         }
@@ -2303,9 +2367,9 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 1)
         {
-            address = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
-            m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-            m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+            address = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
+            writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+            writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
             m_registers.PC = address;
             return 24;
         }
@@ -2316,9 +2380,9 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 0)
         {
-            address = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
-            m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-            m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+            address = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
+            writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+            writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
             m_registers.PC = address;
             return 24;
         }
@@ -2329,9 +2393,9 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 1)
         {
-            address = (uint16_t(m_memory->read(m_registers.PC++)) >> 0) | uint16_t(m_memory->read(m_registers.PC++) << 8);
-            m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-            m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+            address = (uint16_t(readMemory(m_registers.PC++)) >> 0) | uint16_t(readMemory(m_registers.PC++) << 8);
+            writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+            writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
             m_registers.PC = address;
             return 24;
         }
@@ -2341,16 +2405,16 @@ uint64_t CPU::executeInstruction()
 
         // Return operations
     case 0xC9:
-        m_registers.PC = uint16_t(m_memory->read(m_registers.SP++));
-        m_registers.PC |= (uint16_t(m_memory->read(m_registers.SP++)) << 8) & 0xFF00;
+        m_registers.PC = uint16_t(readMemory(m_registers.SP++));
+        m_registers.PC |= (uint16_t(readMemory(m_registers.SP++)) << 8) & 0xFF00;
         return 16;
         break;
     case 0xC0:
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 0)
         {
-            m_registers.PC = uint16_t(m_memory->read(m_registers.SP++));
-            m_registers.PC |= (uint16_t(m_memory->read(m_registers.SP++)) << 8) & 0xFF00;
+            m_registers.PC = uint16_t(readMemory(m_registers.SP++));
+            m_registers.PC |= (uint16_t(readMemory(m_registers.SP++)) << 8) & 0xFF00;
             return 20;
         }
         return 8;
@@ -2359,8 +2423,8 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b10000000) >> 7;
         if (n == 1)
         {
-            m_registers.PC = uint16_t(m_memory->read(m_registers.SP++));
-            m_registers.PC |= (uint16_t(m_memory->read(m_registers.SP++)) << 8) & 0xFF00;
+            m_registers.PC = uint16_t(readMemory(m_registers.SP++));
+            m_registers.PC |= (uint16_t(readMemory(m_registers.SP++)) << 8) & 0xFF00;
             return 20;
         }
         return 8;
@@ -2369,8 +2433,8 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 0)
         {
-            m_registers.PC = uint16_t(m_memory->read(m_registers.SP++));
-            m_registers.PC |= (uint16_t(m_memory->read(m_registers.SP++)) << 8) & 0xFF00;
+            m_registers.PC = uint16_t(readMemory(m_registers.SP++));
+            m_registers.PC |= (uint16_t(readMemory(m_registers.SP++)) << 8) & 0xFF00;
             return 20;
         }
         return 8;
@@ -2379,65 +2443,65 @@ uint64_t CPU::executeInstruction()
         n = (m_registers.F & 0b00010000) >> 4;
         if (n == 1)
         {
-            m_registers.PC = uint16_t(m_memory->read(m_registers.SP++));
-            m_registers.PC |= (uint16_t(m_memory->read(m_registers.SP++)) << 8) & 0xFF00;
+            m_registers.PC = uint16_t(readMemory(m_registers.SP++));
+            m_registers.PC |= (uint16_t(readMemory(m_registers.SP++)) << 8) & 0xFF00;
             return 20;
         }
         return 8;
         break;
     case 0xD9:
-        m_registers.PC = uint16_t(m_memory->read(m_registers.SP++));
-        m_registers.PC |= (uint16_t(m_memory->read(m_registers.SP++)) << 8) & 0xFF00;
+        m_registers.PC = uint16_t(readMemory(m_registers.SP++));
+        m_registers.PC |= (uint16_t(readMemory(m_registers.SP++)) << 8) & 0xFF00;
         m_interruptMasterEnableFlag = true;
         return 16;
         break;
 
         //Reset operations (RST)
     case 0xC7:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0000;
         return 16;
         break;
     case 0xD7:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0010;
         return 16;
         break;
     case 0xE7:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0020;
         return 16;
         break;
     case 0xF7:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0030;
         return 16;
         break;
     case 0xCF:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0008;
         return 16;
         break;
     case 0xDF:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0018;
         return 16;
         break;
     case 0xEF:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0028;
         return 16;
         break;
     case 0xFF:
-        m_memory->write(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((m_registers.PC & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(m_registers.PC & 0x00FF));
         m_registers.PC = 0x0038;
         return 16;
         break;
@@ -2484,9 +2548,10 @@ void CPU::jumpToPendingInterrupts()
     {
         m_memory->write(0xFF0F, interruptFlag & ~1);
         m_interruptMasterEnableFlag = false;
+        m_interruptCounts[Interrupt::VBlank]++;
 
-        m_memory->write(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
         m_registers.PC = 0x0040;
         m_isHalted = false;
     }
@@ -2495,9 +2560,10 @@ void CPU::jumpToPendingInterrupts()
     {
         m_memory->write(0xFF0F, interruptFlag & ~2);
         m_interruptMasterEnableFlag = false;
+        m_interruptCounts[Interrupt::LCD_STAT]++;
 
-        m_memory->write(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
         m_registers.PC = 0x0048;
         m_isHalted = false;
     }
@@ -2506,9 +2572,10 @@ void CPU::jumpToPendingInterrupts()
     {
         m_memory->write(0xFF0F, interruptFlag & ~4);
         m_interruptMasterEnableFlag = false;
+        m_interruptCounts[Interrupt::Timer]++;
 
-        m_memory->write(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
         m_registers.PC = 0x0050;
         m_isHalted = false;
     }
@@ -2517,9 +2584,10 @@ void CPU::jumpToPendingInterrupts()
     {
         m_memory->write(0xFF0F, interruptFlag & ~8);
         m_interruptMasterEnableFlag = false;
+        m_interruptCounts[Interrupt::Serial]++;
 
-        m_memory->write(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
         m_registers.PC = 0x0058;
         m_isHalted = false;
     }
@@ -2528,9 +2596,10 @@ void CPU::jumpToPendingInterrupts()
     {
         m_memory->write(0xFF0F, interruptFlag & ~16);
         m_interruptMasterEnableFlag = false;
+        m_interruptCounts[Interrupt::JoyPad]++;
 
-        m_memory->write(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
-        m_memory->write(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
+        writeMemory(--m_registers.SP, uint8_t((PCAfterInterrupt & 0xFF00) >> 8));
+        writeMemory(--m_registers.SP, uint8_t(PCAfterInterrupt & 0x00FF));
         m_registers.PC = 0x0060;
         m_isHalted = false;
     }
@@ -2,13 +2,20 @@
 
 #include <cstdint>
 
+#include "EmulatorStats.h"
+
+class Emulator;
 class Memory;
 class Joypad;
+class GuestProfiler;
+class InstructionTrace;
+class SaveStateWriter;
+class SaveStateReader;
 
 class CPU
 {
 public:
-    CPU(Memory* memory, Joypad* joypad);
+    CPU(Emulator* emulator, Memory* memory, Joypad* joypad);
     ~CPU();
 
     enum Interrupt
@@ -22,16 +29,34 @@ public:
 
     static const uint64_t s_normalSpeedFrequencyHz = 4 * 1024 * 1024;
     static const uint64_t s_doubleSpeedFrequencyHz = 8 * 1024 * 1024;
-    static uint64_t s_frequencyHz;
-    static bool isDoubleSpeedMode() { return s_frequencyHz == s_doubleSpeedFrequencyHz; }
+    uint64_t getFrequencyHz() const { return m_frequencyHz; }
+    bool isDoubleSpeedMode() const { return m_frequencyHz == s_doubleSpeedFrequencyHz; }
 
     void requestInterrupt(Interrupt interrupt);
     uint64_t executeInstruction();
+    // Instructions fetched since the CPU was created, for throughput statistics. Not part of save states.
+    uint64_t getInstructionCount() const { return m_instructionCount; }
+    // Instructions, interrupts taken and memory accesses by instructions, see EmulatorStats
+    void collectStats(EmulatorStats& stats) const;
+    void restoreStats(EmulatorStats const& stats);
+
+    void saveState(SaveStateWriter& writer) const;
+    void loadState(SaveStateReader& reader);
 
     bool isHalted() const { return m_isHalted; }
+    uint16_t getPC() const { return m_registers.PC; }
+    uint16_t getSP() const { return m_registers.SP; }
+    // Told about every opcode and interrupt dispatch while set, see Emulator::setGuestProfiler()
+    void setGuestProfiler(GuestProfiler* profiler) { m_guestProfiler = profiler; }
+    // Records every instruction while set, see Emulator::setInstructionTrace()
+    void setInstructionTrace(InstructionTrace* trace) { m_instructionTrace = trace; }
     bool hasWrittenToDIVLastCycle() const { return m_hasWrittenToDIVLastCycle; }
 
 private:
+    // Every access an instruction or interrupt dispatch makes goes through these, so it's counted per region
+    uint8_t readMemory(uint16_t address);
+    void writeMemory(uint16_t address, uint8_t value);
+
     bool areTherePendingInterrupts();
     void jumpToPendingInterrupts();
 
@@ -102,8 +127,17 @@ private:
     bool m_hadPendingInterruptsWhenHalted;
 
     bool m_hasWrittenToDIVLastCycle = false;
+    uint64_t m_instructionCount = 0;
+    uint64_t m_interruptCounts[EmulatorStats::sc_numInterrupts] = {};
+    uint64_t m_memoryReadCounts[EmulatorStats::NumMemoryRegions] = {};
+    uint64_t m_memoryWriteCounts[EmulatorStats::NumMemoryRegions] = {};
+
+    uint64_t m_frequencyHz = s_normalSpeedFrequencyHz;
 
+    Emulator* m_emulator;
     Memory* m_memory;
 
     Joypad* m_joypad;
+    GuestProfiler* m_guestProfiler = nullptr;
+    InstructionTrace* m_instructionTrace = nullptr;
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <new>
+#include <memory>
+#include <utility>
+
+// One cache-line-aligned allocation that an emulator's components are placed in back to back, so they don't end up
+// scattered over the heap. Slots are reserved first and the objects constructed afterwards, so the layout can follow
+// how hot a component is rather than the order the components need each other in.
+class ComponentArena
+{
+public:
+    static const size_t sc_alignment = 64;
+
+    // Objects are destroyed in place, their memory goes away with the arena
+    struct Destroyer
+    {
+        template<typename T>
+        void operator()(T* object) const { object->~T(); }
+    };
+    template<typename T>
+    using Pointer = std::unique_ptr<T, Destroyer>;
+
+    ComponentArena() = default;
+    ComponentArena(ComponentArena const&) = delete;
+    ComponentArena& operator=(ComponentArena const&) = delete;
+    ~ComponentArena() { release(); }
+
+    // Returns the offset of a new slot, valid once allocate() has been called
+    size_t reserve(size_t size)
+    {
+        size_t offset = m_size;
+        m_size += (size + sc_alignment - 1) & ~(sc_alignment - 1);
+        return offset;
+    }
+
+    void allocate()
+    {
+        m_block = static_cast<uint8_t*>(::operator new(m_size, std::align_val_t(sc_alignment)));
+    }
+
+    template<typename T, typename... Args>
+    Pointer<T> construct(size_t offset, Args&&... args)
+    {
+        return Pointer<T>(new (m_block + offset) T(std::forward<Args>(args)...));
+    }
+
+    // Everything constructed in the arena has to be destroyed first
+    void release()
+    {
+        if (m_block)
+        {
+            ::operator delete(m_block, std::align_val_t(sc_alignment));
+            m_block = nullptr;
+        }
+        m_size = 0;
+    }
+
+    size_t getSize() const { return m_size; }
+
+private:
+    uint8_t* m_block = nullptr;
+    size_t m_size = 0;
+};
\ No newline at end of file
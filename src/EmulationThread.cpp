@@ -0,0 +1,275 @@
+#include "EmulationThread.h"
+#include "Instrumentation.h"
+
+EmulationThread::EmulationThread(Emulator* emulator)
+    : m_emulator(emulator)
+    , m_rewindBuffer(sc_rewindBudgetBytes)
+{
+    updateSnapshot();
+    m_thread = std::thread(&EmulationThread::run, this);
+}
+
+EmulationThread::~EmulationThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_continueRunning = false;
+    }
+    m_commandAvailable.notify_one();
+    m_thread.join();
+
+    finishMovieRecording();
+    m_emulator->setInstructionTrace(nullptr);
+}
+
+EmulationThread::Snapshot EmulationThread::getSnapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    return m_snapshot;
+}
+
+void EmulationThread::openRomFile(std::string const& romFilename)
+{
+    postCommand([this, romFilename](Emulator& emulator)
+        {
+            finishMovieRecording();
+            emulator.openRomFile(romFilename.c_str());
+            m_rewindBuffer.clear();
+        });
+}
+
+void EmulationThread::closeCurrentRom()
+{
+    postCommand([this](Emulator& emulator)
+        {
+            finishMovieRecording();
+            emulator.closeCurrentRom();
+            m_rewindBuffer.clear();
+        });
+}
+
+void EmulationThread::setPaused(bool isPaused)
+{
+    postCommand([this, isPaused](Emulator&) { m_isPaused = isPaused; });
+}
+
+void EmulationThread::saveBatteryBackedRamToFile()
+{
+    postCommand([](Emulator& emulator) { emulator.saveBatteryBackedRamToFile(); });
+}
+
+void EmulationThread::setTurboModeMultiplier(uint32_t val)
+{
+    postCommand([val](Emulator& emulator) { emulator.setTurboModeMultiplier(val); });
+}
+
+void EmulationThread::setRewinding(bool isRewinding)
+{
+    postCommand([this, isRewinding](Emulator&) { m_isRewinding = isRewinding; });
+}
+
+void EmulationThread::setRunAheadFrames(uint32_t frames)
+{
+    postCommand([this, frames](Emulator&) { m_runAheadFrames = frames; });
+}
+
+void EmulationThread::setFramePacingMode(FramePacer::Mode mode)
+{
+    postCommand([this, mode](Emulator&) { m_framePacer.setMode(mode); });
+}
+
+void EmulationThread::startMovieRecording(std::string const& movieFilename)
+{
+    postCommand([this, movieFilename](Emulator& emulator)
+        {
+            finishMovieRecording();
+            m_movieRecorder = std::make_unique<MovieRecorder>();
+            if (!m_movieRecorder->start(emulator))
+            {
+                m_movieRecorder.reset();
+                return;
+            }
+            m_movieFilename = movieFilename;
+            emulator.setHostInputDeferred(true);
+        });
+}
+
+void EmulationThread::stopMovieRecording()
+{
+    postCommand([this](Emulator&) { finishMovieRecording(); });
+}
+
+void EmulationThread::startInstructionTrace(std::string const& ringFilename)
+{
+    postCommand([this, ringFilename](Emulator& emulator)
+        {
+            emulator.setInstructionTrace(nullptr);
+            m_instructionTrace = std::make_unique<InstructionTrace>(InstructionTrace::sc_defaultSizeBytes, ringFilename.c_str());
+            if (!m_instructionTrace->isValid())
+            {
+                m_instructionTrace.reset();
+                return;
+            }
+            emulator.setInstructionTrace(m_instructionTrace.get());
+        });
+}
+
+void EmulationThread::stopInstructionTrace()
+{
+    postCommand([this](Emulator& emulator)
+        {
+            emulator.setInstructionTrace(nullptr);
+            m_instructionTrace.reset();
+        });
+}
+
+void EmulationThread::dumpInstructionTrace(std::string const& filename)
+{
+    postCommand([this, filename](Emulator&)
+        {
+            if (m_instructionTrace) m_instructionTrace->dumpToFile(filename.c_str());
+        });
+}
+
+void EmulationThread::processKeyboardInput(WPARAM wParam, LPARAM lParam)
+{
+    bool isPressed = (GetKeyState(static_cast<int>(wParam)) & 0x8000) != 0;
+    postCommand([wParam, isPressed](Emulator& emulator) { emulator.setKeyboardKeyState(wParam, isPressed); });
+}
+
+void EmulationThread::postCommand(std::function<void(Emulator&)> command)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        m_pendingCommands.push_back(std::move(command));
+        m_hasPendingCommands = true;
+    }
+    m_commandAvailable.notify_one();
+}
+
+bool EmulationThread::setAffinityMask(DWORD_PTR affinityMask)
+{
+    return SetThreadAffinityMask(m_thread.native_handle(), affinityMask) != 0;
+}
+
+void EmulationThread::run()
+{
+    INSTRUMENT_THREAD_NAME("Emulation");
+    while (m_continueRunning)
+    {
+        if (m_hasPendingCommands)
+        {
+            executePendingCommands();
+        }
+
+        if (m_isPaused || !m_emulator->hasOpenedRomFile())
+        {
+            // Nothing to emulate, sleep until the UI asks for something
+            std::unique_lock<std::mutex> lock(m_commandMutex);
+            m_commandAvailable.wait(lock, [this]() { return m_hasPendingCommands || !m_continueRunning; });
+            m_framePacer.reset();
+            continue;
+        }
+
+        // The frame pacer holds every frame to real time, audio output throttles emulate() on top of that
+        if (m_isRewinding && !m_movieRecorder)
+        {
+            // The restored state doesn't hold a picture, running the frame after it draws one
+            m_rewindBuffer.stepBack(*m_emulator);
+            m_emulator->runFrame();
+            paceFrame();
+            updateSnapshot();
+            continue;
+        }
+
+        if (m_runAheadFrames > 0)
+        {
+            // Whole frames at a time, input changes land between them
+            m_emulator->runFrameAhead(m_runAheadFrames);
+            onFrameCompleted();
+            continue;
+        }
+
+        INSTRUMENT_ZONE("CPU run");
+        uint64_t frameCount = m_emulator->getFrameCount();
+        for (uint32_t i = 0; i < sc_instructionsPerCommandCheck; i++)
+        {
+            m_emulator->emulate();
+            if (m_emulator->getFrameCount() != frameCount)
+            {
+                frameCount = m_emulator->getFrameCount();
+                onFrameCompleted();
+            }
+        }
+    }
+}
+
+void EmulationThread::executePendingCommands()
+{
+    std::vector<std::function<void(Emulator&)>> commands;
+    {
+        std::lock_guard<std::mutex> lock(m_commandMutex);
+        commands.swap(m_pendingCommands);
+        m_hasPendingCommands = false;
+    }
+
+    for (auto& command : commands)
+    {
+        command(*m_emulator);
+    }
+
+    updateSnapshot();
+}
+
+void EmulationThread::onFrameCompleted()
+{
+    if (m_movieRecorder)
+    {
+        uint8_t buttonMask = m_emulator->applyHostInput();
+        m_movieRecorder->onFrameBoundary(*m_emulator, buttonMask);
+    }
+    m_rewindBuffer.onFrameCompleted(*m_emulator);
+    paceFrame();
+    updateSnapshot();
+}
+
+void EmulationThread::paceFrame()
+{
+    m_framePacer.setSpeedMultiplier(m_emulator->getTurboModeMultiplier());
+    m_framePacer.waitForNextFrame();
+}
+
+void EmulationThread::finishMovieRecording()
+{
+    if (!m_movieRecorder) return;
+
+    if (!m_movieRecorder->getMovie().saveToFile(m_movieFilename.c_str()))
+    {
+        m_numFailedMovieSaves++;
+        m_failedMovieFilename = m_movieFilename;
+    }
+    m_movieRecorder.reset();
+    m_emulator->setHostInputDeferred(false);
+    m_emulator->applyHostInput();
+}
+
+void EmulationThread::updateSnapshot()
+{
+    Snapshot snapshot;
+    snapshot.m_hasOpenedRomFile = m_emulator->hasOpenedRomFile();
+    snapshot.m_isPaused = m_isPaused;
+    snapshot.m_turboModeMultiplier = m_emulator->getTurboModeMultiplier();
+    snapshot.m_isRewinding = m_isRewinding;
+    snapshot.m_runAheadFrames = m_runAheadFrames;
+    snapshot.m_isRecordingMovie = m_movieRecorder != nullptr;
+    snapshot.m_numFailedMovieSaves = m_numFailedMovieSaves;
+    snapshot.m_failedMovieFilename = m_failedMovieFilename;
+    snapshot.m_isTracingInstructions = m_instructionTrace != nullptr;
+    snapshot.m_framePacingMode = m_framePacer.getMode();
+    snapshot.m_framePacerStats = m_framePacer.getStats();
+    snapshot.m_rewindStats = m_rewindBuffer.getStats();
+    snapshot.m_cartridgeInfo = m_emulator->getCartridgeInfo();
+
+    std::lock_guard<std::mutex> lock(m_snapshotMutex);
+    m_snapshot = snapshot;
+}
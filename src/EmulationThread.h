@@ -0,0 +1,112 @@
+#pragma once
+
+#include <Windows.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+#include "Emulator.h"
+#include "RewindBuffer.h"
+#include "Movie.h"
+#include "InstructionTrace.h"
+#include "FramePacer.h"
+
+// Runs an Emulator on its own thread. Everything that changes emulator state goes through a command queue
+// and is applied between instructions; frames come out through the emulator's FrameQueue, and the UI reads
+// everything else from snapshots, so no emulator member is ever touched from two threads.
+class EmulationThread
+{
+public:
+    EmulationThread(Emulator* emulator);
+    ~EmulationThread();
+
+    struct Snapshot
+    {
+        bool m_hasOpenedRomFile = false;
+        bool m_isPaused = false;
+        uint32_t m_turboModeMultiplier = 1;
+        bool m_isRewinding = false;
+        uint32_t m_runAheadFrames = 0;
+        bool m_isRecordingMovie = false;
+        // Goes up every time a finished movie couldn't be written, the UI tells the user when it changes
+        uint32_t m_numFailedMovieSaves = 0;
+        std::string m_failedMovieFilename;
+        bool m_isTracingInstructions = false;
+        FramePacer::Mode m_framePacingMode = FramePacer::Mode::Timer;
+        FramePacer::Stats m_framePacerStats;
+        RewindBuffer::Stats m_rewindStats;
+        Emulator::CartridgeInfo m_cartridgeInfo;
+    };
+    Snapshot getSnapshot() const;
+
+    void openRomFile(std::string const& romFilename);
+    void closeCurrentRom();
+    void setPaused(bool isPaused);
+    void saveBatteryBackedRamToFile();
+    void setTurboModeMultiplier(uint32_t val);
+    // While rewinding every frame steps one snapshot back in time instead of running forward
+    void setRewinding(bool isRewinding);
+    // Frames to run ahead of the real timeline to hide the game's own input lag, 0 turns it off
+    void setRunAheadFrames(uint32_t frames);
+    void setFramePacingMode(FramePacer::Mode mode);
+    // Keyboard and controller input only reaches the game at frame boundaries while recording, so it replays exactly.
+    // Rewinding is ignored meanwhile. The movie is written when recording stops or another ROM is opened.
+    void startMovieRecording(std::string const& movieFilename);
+    void stopMovieRecording();
+    // Records every executed instruction into a ring mapped to ringFilename, which gb_tracedump can read even after
+    // a crash. A dump holds the same instructions oldest first and is written without stopping the trace.
+    void startInstructionTrace(std::string const& ringFilename);
+    void stopInstructionTrace();
+    void dumpInstructionTrace(std::string const& filename);
+    // Resolves the key state on the calling thread, since GetKeyState only tracks the caller's own input
+    void processKeyboardInput(WPARAM wParam, LPARAM lParam);
+
+    // Runs the given function on the emulation thread before the next instruction
+    void postCommand(std::function<void(Emulator&)> command);
+
+    // Keeps the emulation thread on the given set of cores, returns false if Windows refused
+    bool setAffinityMask(DWORD_PTR affinityMask);
+
+private:
+    void run();
+    void executePendingCommands();
+    void updateSnapshot();
+    void onFrameCompleted();
+    void paceFrame();
+    void finishMovieRecording();
+
+    // Instructions executed between two checks of the command queue
+    static const uint32_t sc_instructionsPerCommandCheck = 256;
+
+    // One snapshot per frame, a few minutes of history for most games
+    static const size_t sc_rewindBudgetBytes = 32 * 1024 * 1024;
+
+    Emulator* m_emulator;
+    bool m_isPaused = false;
+    bool m_isRewinding = false;
+    uint32_t m_runAheadFrames = 0;
+    RewindBuffer m_rewindBuffer;
+    FramePacer m_framePacer;
+    std::unique_ptr<MovieRecorder> m_movieRecorder;
+    std::string m_movieFilename;
+    uint32_t m_numFailedMovieSaves = 0;
+    std::string m_failedMovieFilename;
+    std::unique_ptr<InstructionTrace> m_instructionTrace;
+
+    std::vector<std::function<void(Emulator&)>> m_pendingCommands;
+    std::atomic<bool> m_hasPendingCommands = false;
+    std::mutex m_commandMutex;
+    std::condition_variable m_commandAvailable;
+
+    Snapshot m_snapshot;
+    mutable std::mutex m_snapshotMutex;
+
+    std::atomic<bool> m_continueRunning = true;
+    std::thread m_thread;
+};
\ No newline at end of file
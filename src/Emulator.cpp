@@ -5,6 +5,9 @@
 #include <string>
 #include <chrono>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
+#include <bit>
 
 #include "CPU.h"
 #include "Timer.h"
@@ -12,17 +15,20 @@
 #include "Memory.h"
 #include "Joypad.h"
 #include "Sound.h"
+#include "SaveState.h"
+#include "GuestProfiler.h"
+#include "InstructionTrace.h"
+#include "Instrumentation.h"
 
-Emulator::Mode Emulator::s_currentMode = Mode::DMG;
-uint32_t Emulator::s_turboModeMultiplier = 1;
+Emulator::Emulator()
+    : Emulator(Config())
+{
+}
 
-std::chrono::steady_clock::time_point start;
-std::chrono::steady_clock::time_point end;
-Emulator::Emulator(ResourceHandle frameTexture, uint8_t* frameTextureData)
-    : m_frameTexture(frameTexture)
-    , m_frameTextureData(frameTextureData)
+Emulator::Emulator(Config const& config)
+    : m_config(config)
+    , m_frameQueue(std::make_unique<FrameQueue>())
 {
-    start = std::chrono::high_resolution_clock::now();
 }
 
 Emulator::~Emulator()
@@ -30,10 +36,8 @@ Emulator::~Emulator()
     saveBatteryBackedRamToFile();
 }
 
-void Emulator::openRomFile(char const* romFilename)
+bool Emulator::openRomFile(char const* romFilename)
 {
-    switchToMode(Mode::DMG);
-
     std::string filepath(romFilename);
     if (filepath.starts_with('\"'))
     {
@@ -48,19 +52,103 @@ void Emulator::openRomFile(char const* romFilename)
 
     if (!std::filesystem::exists(romFilename))
     {
-        return;
+        return false;
+    }
+
+    size_t romSize = std::filesystem::file_size(romFilename);
+    if (romSize < sc_minRomSize || romSize > sc_maxRomSize)
+    {
+        return false;
+    }
+
+    // Allocated and read before anything changes, so a ROM that can't be loaded leaves the previous one as it was
+    size_t cartridgeSize = 0;
+    std::shared_ptr<uint8_t[]> cartridge = allocateCartridge(romSize, cartridgeSize);
+
+    std::ifstream file(romFilename, std::fstream::in | std::fstream::binary);
+    file.read(reinterpret_cast<char*>(cartridge.get()), romSize);
+    if (!file.good() || !hasKnownSizeCodes(cartridge.get()))
+    {
+        return false;
     }
 
     saveBatteryBackedRamToFile(); // Save ram to file in case we had another game opened before this
+    switchToMode(Mode::DMG);
 
     m_romFilename = romFilename;
+    m_cartridgeSize = cartridgeSize;
+    m_cartridge = std::move(cartridge);
 
-    m_cartridgeSize = std::filesystem::file_size(romFilename);
-    m_cartridge = std::make_unique<uint8_t[]>(m_cartridgeSize);
+    loadCartridge();
+    loadSavFileToRam();
+    return true;
+}
 
-    std::ifstream file(romFilename, std::fstream::in | std::fstream::binary);
-    file.read(reinterpret_cast<char*>(m_cartridge.get()), m_cartridgeSize);
+bool Emulator::openRomFromMemory(uint8_t const* rom, size_t romSize)
+{
+    // Too small to even hold a cartridge header, or bigger than any cartridge
+    if (!rom || romSize < sc_minRomSize || romSize > sc_maxRomSize || !hasKnownSizeCodes(rom))
+    {
+        return false;
+    }
+
+    size_t cartridgeSize = 0;
+    std::shared_ptr<uint8_t[]> cartridge = allocateCartridge(romSize, cartridgeSize);
+    std::memcpy(cartridge.get(), rom, romSize);
+
+    saveBatteryBackedRamToFile();
+    switchToMode(Mode::DMG);
 
+    m_romFilename.clear();
+    m_cartridgeSize = cartridgeSize;
+    m_cartridge = std::move(cartridge);
+
+    loadCartridge();
+    loadSavFileToRam();
+    return true;
+}
+
+bool Emulator::cloneFrom(Emulator const& source)
+{
+    if (&source == this) return true;
+    if (!source.m_hasOpenedRomFile) return false;
+
+    if (!m_hasOpenedRomFile || m_cartridge != source.m_cartridge)
+    {
+        saveBatteryBackedRamToFile();
+
+        // Without a filename the clone never touches the source's .sav and .rtc files, like a ROM opened from memory
+        m_romFilename.clear();
+        m_cartridge = source.m_cartridge;
+        m_cartridgeSize = source.m_cartridgeSize;
+
+        // The .sav file isn't read, the state below replaces the RAM anyway
+        switchToMode(Mode::DMG);
+        loadCartridge();
+    }
+
+    size_t stateSize = source.getStateSize();
+    resizeScratchState(stateSize);
+    return source.saveState(m_scratchState.get(), stateSize) && loadState(m_scratchState.get(), stateSize);
+}
+
+bool Emulator::hasKnownSizeCodes(uint8_t const* rom)
+{
+    bool isKnownRomSize = rom[0x148] <= 0x08 || (rom[0x148] >= 0x52 && rom[0x148] <= 0x54);
+    bool isKnownRamSize = rom[0x149] <= 0x05;
+    return isKnownRomSize && isKnownRamSize;
+}
+
+std::shared_ptr<uint8_t[]> Emulator::allocateCartridge(size_t romSize, size_t& cartridgeSize)
+{
+    cartridgeSize = std::bit_ceil(std::max<size_t>(romSize, 2 * 0x4000));
+    std::shared_ptr<uint8_t[]> cartridge = std::make_shared<uint8_t[]>(cartridgeSize);
+    std::fill(cartridge.get() + romSize, cartridge.get() + cartridgeSize, uint8_t(0xFF));
+    return cartridge;
+}
+
+void Emulator::loadCartridge()
+{
     extractCartridgeInfo();
 
     if ((m_cartridge[0x143] & 0x80) == 0x80)
@@ -69,38 +157,88 @@ void Emulator::openRomFile(char const* romFilename)
     }
     //switchToMode(Mode::DMG);
 
+    // The previous ROM's components go before the arena they live in. Until the new ones exist there's no ROM, also
+    // if allocating them throws.
+    m_hasOpenedRomFile = false;
+    m_lcd.reset();
+    m_timer.reset();
+    m_cpu.reset();
+    m_sound.reset();
+    m_joypad.reset();
+    m_memory.reset();
+    m_componentArena.release();
+
+    // Small components that are touched every instruction share the first cache lines, the memory arrays go last
+    size_t memorySize = m_cartridgeInfo.hasMBC1() ? sizeof(MBC1)
+                      : m_cartridgeInfo.hasMBC2() ? sizeof(MBC2)
+                      : m_cartridgeInfo.hasMBC3() ? sizeof(MBC3)
+                      : m_cartridgeInfo.hasMBC5() ? sizeof(MBC5)
+                      : sizeof(Memory);
+    size_t cpuOffset = m_componentArena.reserve(sizeof(CPU));
+    size_t timerOffset = m_componentArena.reserve(sizeof(Timer));
+    size_t joypadOffset = m_componentArena.reserve(sizeof(Joypad));
+    size_t lcdOffset = m_componentArena.reserve(sizeof(LCD));
+    size_t soundOffset = m_componentArena.reserve(sizeof(Sound));
+    size_t memoryOffset = m_componentArena.reserve(memorySize);
+    m_componentArena.allocate();
+
     if (m_cartridgeInfo.hasMBC1())
     {
-        m_memory = std::make_unique<MBC1>(m_cartridge.get(), m_cartridgeSize);
+        m_memory = m_componentArena.construct<MBC1>(memoryOffset, this, m_cartridge.get(), m_cartridgeSize);
     }
     else if (m_cartridgeInfo.hasMBC2())
     {
-        m_memory = std::make_unique<MBC2>(m_cartridge.get(), m_cartridgeSize);
+        m_memory = m_componentArena.construct<MBC2>(memoryOffset, this, m_cartridge.get(), m_cartridgeSize);
     }
     else if (m_cartridgeInfo.hasMBC3())
     {
-        m_memory = std::make_unique<MBC3>(m_cartridge.get(), m_cartridgeSize);
+        m_memory = m_componentArena.construct<MBC3>(memoryOffset, this, m_cartridge.get(), m_cartridgeSize);
     }
     else if (m_cartridgeInfo.hasMBC5())
     {
-        m_memory = std::make_unique<MBC5>(m_cartridge.get(), m_cartridgeSize);
+        m_memory = m_componentArena.construct<MBC5>(memoryOffset, this, m_cartridge.get(), m_cartridgeSize);
     }
     else
     {
-        m_memory = std::make_unique<Memory>(m_cartridge.get(), m_cartridgeSize);
+        m_memory = m_componentArena.construct<Memory>(memoryOffset, this, m_cartridge.get(), m_cartridgeSize);
     }
-    m_joypad = std::make_unique<Joypad>(m_memory.get());
-    m_sound = std::make_unique<Sound>(m_memory.get());
-    m_cpu = std::make_unique<CPU>(m_memory.get(), m_joypad.get());
-    m_timer = std::make_unique<Timer>(m_cpu.get(), m_memory.get());
-    m_lcd = std::make_unique<LCD>(m_cpu.get(), m_memory.get(), m_frameTexture, m_frameTextureData);
-
-    loadSavFileToRam();
+    m_joypad = m_componentArena.construct<Joypad>(joypadOffset, m_memory.get(), m_config.m_enableControllerInput);
+    m_joypad->setHostInputDeferred(m_isHostInputDeferred);
+    m_sound = m_componentArena.construct<Sound>(soundOffset, this, m_memory.get(), m_config.m_enableAudioOutput);
+    m_sound->setSampleCaptureEnabled(m_config.m_captureAudioSamples);
+    m_sound->setOutputMuted(m_isAudioMuted);
+    m_cpu = m_componentArena.construct<CPU>(cpuOffset, this, m_memory.get(), m_joypad.get());
+    m_cpu->setGuestProfiler(m_guestProfiler);
+    m_cpu->setInstructionTrace(m_instructionTrace);
+    m_timer = m_componentArena.construct<Timer>(timerOffset, m_cpu.get(), m_memory.get());
+    m_lcd = m_componentArena.construct<LCD>(lcdOffset, this, m_cpu.get(), m_memory.get(), m_frameQueue.get());
+    m_lcd->setLayerCacheEnabled(m_layerCacheEnabled);
+    m_lcd->setFrameSkip(m_frameSkipMode, m_framesToSkip);
+
+    // The RTC counts from here
+    m_elapsedCycles = 0;
+    m_cycleCount = 0;
+    m_haltCycleCount = 0;
+    m_lastLoggedFrame = 0;
+    m_lastLoggedStats = EmulatorStats();
+    m_nextSaveCheckCycle = CPU::s_normalSpeedFrequencyHz;
+
+    SaveStateWriter sizeWriter(nullptr, 0);
+    writeState(sizeWriter);
+    m_stateSize = sizeWriter.getSize();
 
     m_hasOpenedRomFile = true;
 }
 
-static double saveTimer = 0.0;
+void Emulator::resizeScratchState(size_t stateSize) const
+{
+    if (stateSize != m_scratchStateSize)
+    {
+        m_scratchState = std::make_unique<uint8_t[]>(stateSize);
+        m_scratchStateSize = stateSize;
+    }
+}
+
 void Emulator::emulate()
 {
     if (!m_hasOpenedRomFile) return;
@@ -111,43 +249,321 @@ void Emulator::emulate()
         setTurboModeMultiplier(m_joypad->areShoulderButtonsBeingPressed() ? 2 : 1);
     }
 
-    end = std::chrono::high_resolution_clock::now();
-
-    auto elapsedNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
-    double deltaTimeSeconds = std::chrono::abs(elapsedNanoseconds).count() / 1000000000.0;
-
-    start = std::chrono::high_resolution_clock::now();
-
-    saveTimer += deltaTimeSeconds;
-
-    m_memory->updateRTC(deltaTimeSeconds);
-
+    bool wasHalted = m_cpu->isHalted();
     uint64_t executedCycles = m_cpu->executeInstruction();
+    m_cycleCount += executedCycles;
+    if (wasHalted && m_cpu->isHalted()) m_haltCycleCount += executedCycles;
+    if (!m_isSpeculating)
+    {
+        if (m_guestProfiler) m_guestProfiler->recordStep(*m_memory, m_cpu->getPC(), m_cpu->getSP(), executedCycles);
+        if (m_instructionTrace) m_instructionTrace->addCycles(executedCycles);
+    }
     m_timer->update(executedCycles);
-    if (CPU::isDoubleSpeedMode()) executedCycles /= 4;
+    if (m_cpu->isDoubleSpeedMode()) executedCycles /= 4;
     m_lcd->update(executedCycles);
     m_sound->update(executedCycles);
+    m_elapsedCycles += executedCycles;
+
+    // Nothing from a speculative frame may leave the emulator, it gets thrown away
+    if (m_isSpeculating) return;
+
+    if (m_isStatsLoggingEnabled && m_lcd->getFrameCount() != m_lastLoggedFrame)
+    {
+        logFrameStats();
+    }
 
-    if (saveTimer >= 1.0)
+    // Looked at once per emulated second, but written at most once per real second, since turbo and unpaced runs
+    // go through many emulated seconds in one
+    if (m_elapsedCycles >= m_nextSaveCheckCycle && hasBatteryFile())
     {
-        saveTimer = 0.0;
-        if (m_memory->areRamBanksDirty())
+        m_nextSaveCheckCycle = m_elapsedCycles + CPU::s_normalSpeedFrequencyHz;
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (m_memory->areRamBanksDirty() && now - m_lastBatterySaveTime >= std::chrono::seconds(1))
         {
+            m_lastBatterySaveTime = now;
             saveBatteryBackedRamToFile();
         }
     }
 }
 
+void Emulator::runFrame(uint64_t maxCycles)
+{
+    if (!m_hasOpenedRomFile) return;
+    INSTRUMENT_ZONE("CPU run");
+
+    uint64_t frameCount = m_lcd->getFrameCount();
+    uint64_t cycleLimit = m_elapsedCycles + maxCycles;
+    while (m_lcd->getFrameCount() == frameCount && m_elapsedCycles < cycleLimit)
+    {
+        emulate();
+    }
+}
+
+void Emulator::runCycles(uint64_t cycles)
+{
+    if (!m_hasOpenedRomFile) return;
+    INSTRUMENT_ZONE("CPU run");
+
+    uint64_t cycleLimit = m_elapsedCycles + cycles;
+    while (m_elapsedCycles < cycleLimit)
+    {
+        emulate();
+    }
+}
+
+void Emulator::runFrameAhead(uint32_t framesAhead)
+{
+    if (!m_hasOpenedRomFile) return;
+    if (framesAhead == 0)
+    {
+        runFrame();
+        return;
+    }
+
+    m_lcd->setFrameSkip(FrameSkipMode::OnRequest, 0);
+    EmulatorStats statsBeforeFrame = getStats();
+    runFrame();
+
+    resizeScratchState(getStateSize());
+    saveState(m_scratchState.get(), m_scratchStateSize);
+
+    // Nothing from these frames may reach the audio device, the .sav file, the stats, the profiler or the trace
+    EmulatorStats realStats = getStats();
+    uint64_t realCycleCount = m_cycleCount;
+    uint64_t realHaltCycleCount = m_haltCycleCount;
+    m_isSpeculating = true;
+    m_sound->setOutputMuted(true);
+    m_cpu->setGuestProfiler(nullptr);
+    m_cpu->setInstructionTrace(nullptr);
+    for (uint32_t i = 0; i < framesAhead; i++)
+    {
+        if (i == framesAhead - 1)
+        {
+            m_lcd->requestNextFrame();
+        }
+        runFrame();
+    }
+    EmulatorStats aheadStats = getStats();
+    m_cpu->setGuestProfiler(m_guestProfiler);
+    m_cpu->setInstructionTrace(m_instructionTrace);
+    m_sound->setOutputMuted(m_isAudioMuted);
+    m_isSpeculating = false;
+
+    loadState(m_scratchState.get(), m_scratchStateSize);
+    m_lcd->setFrameSkip(m_frameSkipMode, m_framesToSkip);
+
+    // The picture shown for the real frame is the one rendered ahead, the lines rasterized for it count
+    if (aheadStats.m_framesRendered != realStats.m_framesRendered && realStats.m_framesSkipped != statsBeforeFrame.m_framesSkipped)
+    {
+        realStats.m_framesSkipped--;
+        realStats.m_framesRendered++;
+        realStats.m_scanlines = aheadStats.m_scanlines;
+    }
+    restoreStats(realStats);
+    m_cycleCount = realCycleCount;
+    m_haltCycleCount = realHaltCycleCount;
+}
+
+uint64_t Emulator::getFrameCount() const
+{
+    return m_lcd ? m_lcd->getFrameCount() : 0;
+}
+
+uint64_t Emulator::getInstructionCount() const
+{
+    return m_cpu ? m_cpu->getInstructionCount() : 0;
+}
+
+EmulatorStats Emulator::getStats() const
+{
+    EmulatorStats stats;
+    if (!m_hasOpenedRomFile) return stats;
+
+    m_cpu->collectStats(stats);
+    m_lcd->collectStats(stats);
+    m_sound->collectStats(stats);
+    stats.m_cycles = m_cycleCount;
+    stats.m_haltCycles = m_haltCycleCount;
+    stats.m_bankSwitches = m_memory->getBankSwitchCount();
+    return stats;
+}
+
+void Emulator::restoreStats(EmulatorStats const& stats)
+{
+    m_cpu->restoreStats(stats);
+    m_lcd->restoreStats(stats);
+    m_sound->restoreStats(stats);
+    m_memory->setBankSwitchCount(stats.m_bankSwitches);
+}
+
+void Emulator::setStatsLoggingEnabled(bool enabled)
+{
+    m_isStatsLoggingEnabled = enabled;
+    m_lastLoggedFrame = getFrameCount();
+    m_lastLoggedStats = getStats();
+}
+
+void Emulator::setGuestProfiler(GuestProfiler* profiler)
+{
+    m_guestProfiler = profiler;
+    if (m_cpu) m_cpu->setGuestProfiler(profiler);
+}
+
+void Emulator::setInstructionTrace(InstructionTrace* trace)
+{
+    m_instructionTrace = trace;
+    if (m_cpu) m_cpu->setInstructionTrace(trace);
+}
+
+void Emulator::logFrameStats()
+{
+    EmulatorStats stats = getStats();
+    m_lastLoggedFrame = m_lcd->getFrameCount();
+    std::string line = "Frame " + std::to_string(m_lastLoggedFrame) + ": " + stats.since(m_lastLoggedStats).toString() + "\n";
+    OutputDebugStringA(line.c_str());
+    m_lastLoggedStats = stats;
+}
+
 void Emulator::processKeyboardInput(WPARAM wParam, LPARAM lParam)
 {
-    if (!m_cartridge) return;
+    if (!m_hasOpenedRomFile) return;
 
     m_joypad->processKeyboardInput(wParam, lParam);
 }
 
+void Emulator::setKeyboardKeyState(WPARAM key, bool isPressed)
+{
+    if (!m_hasOpenedRomFile) return;
+
+    m_joypad->setKeyboardKeyState(key, isPressed);
+}
+
+void Emulator::setButtonPressed(Joypad::Button button, bool isPressed)
+{
+    if (!m_hasOpenedRomFile) return;
+
+    m_joypad->setButtonPressed(button, isPressed);
+}
+
+void Emulator::setPressedButtons(uint8_t buttonMask)
+{
+    if (!m_hasOpenedRomFile) return;
+
+    m_joypad->setPressedButtonMask(buttonMask);
+}
+
+uint8_t Emulator::getPressedButtons() const
+{
+    return m_joypad ? m_joypad->getPressedButtonMask() : 0;
+}
+
+void Emulator::setHostInputDeferred(bool deferred)
+{
+    m_isHostInputDeferred = deferred;
+    if (m_joypad)
+    {
+        m_joypad->setHostInputDeferred(deferred);
+    }
+}
+
+uint8_t Emulator::applyHostInput()
+{
+    return m_joypad ? m_joypad->applyHostInput() : 0;
+}
+
+uint8_t Emulator::readMemory(uint16_t address) const
+{
+    return m_memory ? m_memory->read(address) : 0xFF;
+}
+
+void Emulator::writeMemory(uint16_t address, uint8_t value)
+{
+    if (!m_memory) return;
+
+    m_memory->write(address, value);
+}
+
+float const* Emulator::getCapturedAudioSamples(size_t* numSamples) const
+{
+    if (!m_sound)
+    {
+        *numSamples = 0;
+        return nullptr;
+    }
+
+    std::vector<float> const& samples = m_sound->getCapturedSamples();
+    *numSamples = samples.size();
+    return samples.data();
+}
+
+void Emulator::clearCapturedAudioSamples()
+{
+    if (m_sound)
+    {
+        m_sound->clearCapturedSamples();
+    }
+}
+
+bool Emulator::isFrameReady() const
+{
+    return m_frameQueue->hasNewFrame();
+}
+
+void Emulator::convertFrame(Framebuffer::PixelFormat format, uint8_t* destination)
+{
+    m_frameQueue->acquireLatestFrame().convertTo(format, destination);
+}
+
+void Emulator::setFrameReadyCallback(FrameQueue::FrameReadyCallback callback)
+{
+    m_frameQueue->setFrameReadyCallback(std::move(callback));
+}
+
+void Emulator::setLayerCacheEnabled(bool enabled)
+{
+    m_layerCacheEnabled = enabled;
+    if (m_lcd)
+    {
+        m_lcd->setLayerCacheEnabled(enabled);
+    }
+}
+
+void Emulator::setAudioMuted(bool muted)
+{
+    m_isAudioMuted = muted;
+    if (m_sound)
+    {
+        m_sound->setOutputMuted(muted);
+    }
+}
+
+void Emulator::setFrameSkip(FrameSkipMode mode, uint32_t framesToSkip)
+{
+    m_frameSkipMode = mode;
+    m_framesToSkip = framesToSkip;
+    if (m_lcd)
+    {
+        m_lcd->setFrameSkip(mode, framesToSkip);
+    }
+}
+
+void Emulator::requestNextFrame()
+{
+    if (m_lcd)
+    {
+        m_lcd->requestNextFrame();
+    }
+}
+
+bool Emulator::hasBatteryFile() const
+{
+    return m_cartridge && m_memory && m_cartridgeInfo.hasBatteryBackedRam() && m_config.m_persistBatteryBackedRam && !m_romFilename.empty();
+}
+
 void Emulator::saveBatteryBackedRamToFile()
 {
-    if (!m_cartridge || !m_cartridgeInfo.hasBatteryBackedRam()) return;
+    if (!hasBatteryFile()) return;
+    INSTRUMENT_ZONE("Save RAM write");
 
     std::string savFilename = m_romFilename.substr(0, m_romFilename.rfind(".") + 1) + "sav";
     std::ofstream savFile(savFilename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
@@ -163,7 +579,8 @@ void Emulator::saveBatteryBackedRamToFile()
 
 void Emulator::loadSavFileToRam()
 {
-    if (!m_cartridge) return;
+    if (!m_cartridge || !m_config.m_persistBatteryBackedRam || m_romFilename.empty()) return;
+    INSTRUMENT_ZONE("Save RAM load");
 
     std::string savFilename = m_romFilename.substr(0, m_romFilename.rfind(".") + 1) + "sav";
     if (!std::filesystem::exists(savFilename))
@@ -179,7 +596,131 @@ void Emulator::loadSavFileToRam()
         return;
     }
     std::ifstream rtcFile(rtcFilename, std::fstream::in | std::fstream::binary);
-    m_memory->loadRTCRegistersFromFile(rtcFile);
+    m_memory->loadRTCRegistersFromFile(rtcFile, m_config.m_syncRTCWithWallClock);
+}
+
+size_t Emulator::getStateSize() const
+{
+    return m_hasOpenedRomFile ? m_stateSize : 0;
+}
+
+bool Emulator::saveState(uint8_t* buffer, size_t bufferSize, size_t* stateSize) const
+{
+    if (!m_hasOpenedRomFile) return false;
+
+    SaveStateWriter writer(buffer, bufferSize);
+    writeState(writer);
+    if (stateSize)
+    {
+        *stateSize = writer.getSize();
+    }
+    return !writer.hasOverflowed();
+}
+
+bool Emulator::loadState(uint8_t const* state, size_t stateSize)
+{
+    if (!m_hasOpenedRomFile || !state) return false;
+
+    // Everything is checked before the first component is touched, a state that passes can't run out midway
+    SaveStateReader reader(state, stateSize);
+    if (stateSize != getStateSize() || !readStateHeader(reader))
+    {
+        return false;
+    }
+
+    reader.read(m_elapsedCycles);
+    m_nextSaveCheckCycle = m_elapsedCycles + CPU::s_normalSpeedFrequencyHz;
+    m_memory->loadState(reader);
+    m_cpu->loadState(reader);
+    m_timer->loadState(reader);
+    m_lcd->loadState(reader);
+    m_joypad->loadState(reader);
+    m_sound->loadState(reader);
+
+    assert(!reader.hasFailed() && reader.getPosition() == stateSize);
+    return true;
+}
+
+bool Emulator::saveStateToFile(char const* filename) const
+{
+    INSTRUMENT_ZONE("Save state write");
+    size_t stateSize = getStateSize();
+    if (stateSize == 0) return false;
+
+    std::unique_ptr<uint8_t[]> state = std::make_unique<uint8_t[]>(stateSize);
+    if (!saveState(state.get(), stateSize))
+    {
+        return false;
+    }
+
+    std::ofstream file(filename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    file.write(reinterpret_cast<char const*>(state.get()), stateSize);
+    return file.good();
+}
+
+bool Emulator::loadStateFromFile(char const* filename)
+{
+    INSTRUMENT_ZONE("Save state load");
+    if (!std::filesystem::exists(filename)) return false;
+
+    size_t stateSize = std::filesystem::file_size(filename);
+    std::unique_ptr<uint8_t[]> state = std::make_unique<uint8_t[]>(stateSize);
+
+    std::ifstream file(filename, std::fstream::in | std::fstream::binary);
+    file.read(reinterpret_cast<char*>(state.get()), stateSize);
+    if (!file.good())
+    {
+        return false;
+    }
+    return loadState(state.get(), stateSize);
+}
+
+uint64_t Emulator::computeStateHash() const
+{
+    size_t stateSize = getStateSize();
+    if (stateSize == 0) return 0;
+
+    resizeScratchState(stateSize);
+    saveState(m_scratchState.get(), stateSize);
+
+    // FNV-1a, like Framebuffer::computeHash
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < stateSize; i++)
+    {
+        hash = (hash ^ m_scratchState[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void Emulator::writeState(SaveStateWriter& writer) const
+{
+    writer.write(sc_saveStateMagic);
+    writer.write(sc_saveStateVersion);
+    writer.write(static_cast<uint8_t>(m_currentMode));
+    writer.write(static_cast<uint64_t>(m_cartridgeSize));
+    writer.write(m_cartridge[0x14D]);   // Header checksum
+    writer.write(m_cartridge[0x14E]);   // Global checksum
+    writer.write(m_cartridge[0x14F]);
+
+    writer.write(m_elapsedCycles);
+    m_memory->saveState(writer);
+    m_cpu->saveState(writer);
+    m_timer->saveState(writer);
+    m_lcd->saveState(writer);
+    m_joypad->saveState(writer);
+    m_sound->saveState(writer);
+}
+
+bool Emulator::readStateHeader(SaveStateReader& reader) const
+{
+    bool isValid = reader.read<uint32_t>() == sc_saveStateMagic;
+    isValid &= reader.read<uint32_t>() == sc_saveStateVersion;
+    isValid &= reader.read<uint8_t>() == static_cast<uint8_t>(m_currentMode);
+    isValid &= reader.read<uint64_t>() == m_cartridgeSize;
+    isValid &= reader.read<uint8_t>() == m_cartridge[0x14D];
+    isValid &= reader.read<uint8_t>() == m_cartridge[0x14E];
+    isValid &= reader.read<uint8_t>() == m_cartridge[0x14F];
+    return isValid && !reader.hasFailed();
 }
 
 void Emulator::extractCartridgeInfo()
@@ -200,7 +741,7 @@ void Emulator::extractCartridgeInfo()
         numRomBanks = 96;
         break;
     default:
-        numRomBanks = 2 * static_cast<uint64_t>(std::powf(2.0f, m_cartridge[0x148]));
+        numRomBanks = uint64_t(2) << m_cartridge[0x148];
         break;
     }
 
@@ -225,6 +766,11 @@ void Emulator::extractCartridgeInfo()
     case 4:
         ramSize = 128 * 1024;
         numRamBanks = 16;
+        break;
+    case 5:
+        ramSize = 64 * 1024;
+        numRamBanks = 8;
+        break;
     default:
         assert(false);
         break;
@@ -246,7 +792,12 @@ void Emulator::extractCartridgeInfo()
 
 void Emulator::switchToMode(Mode mode)
 {
-    s_currentMode = mode;
+    m_currentMode = mode;
+}
+
+bool Emulator::isDoubleSpeedMode() const
+{
+    return m_cpu && m_cpu->isDoubleSpeedMode();
 }
 
 std::string Emulator::CartridgeInfo::getCartridgeTypeStr() const
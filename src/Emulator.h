@@ -1,22 +1,43 @@
 #pragma once
 
-#include <resource/ResourceHandle.h>
+#include <Windows.h>
 
 #include <string>
 #include <cstdint>
 #include <memory>
+#include <chrono>
+
+#include "FrameQueue.h"
+#include "Joypad.h"
+#include "ComponentArena.h"
+#include "EmulatorStats.h"
 
 class CPU;
 class Timer;
 class LCD;
 class Memory;
-class Joypad;
 class Sound;
+class GuestProfiler;
+class InstructionTrace;
+class SaveStateWriter;
+class SaveStateReader;
 
 class Emulator
 {
 public:
-    Emulator(ResourceHandle frameTexture, uint8_t* frameTextureData);
+    // Host integrations an instance uses. Batch and headless runs turn them off, since thousands of instances
+    // can't share one audio device, one controller or the .sav file next to the ROM.
+    struct Config
+    {
+        bool m_enableAudioOutput = true;        // Also paces emulation to real time through the audio queue
+        bool m_enableControllerInput = true;    // Polls XInput on a background thread
+        bool m_persistBatteryBackedRam = true;  // Loads and saves .sav/.rtc files next to the ROM
+        bool m_captureAudioSamples = false;     // Keeps generated samples around for getCapturedAudioSamples()
+        bool m_syncRTCWithWallClock = true;     // Advances MBC3 clocks by the time the .rtc file spent on disk
+    };
+
+    Emulator();
+    Emulator(Config const& config);
     ~Emulator();
 
     struct CartridgeInfo
@@ -39,46 +60,182 @@ public:
         bool hasMBC5() const;
     };
 
-    void openRomFile(char const* romFilename);
+    // Returns false when the ROM can't be loaded, the previously opened one then keeps running
+    bool openRomFile(char const* romFilename);
+    // Copies the ROM, battery-backed RAM isn't persisted for ROMs without a file
+    bool openRomFromMemory(uint8_t const* rom, size_t romSize);
+    // Turns this instance into a copy of source, sharing its ROM. An instance that already runs the same ROM keeps
+    // its components and only copies the state, which makes resetting many instances to one snapshot cheap.
+    // Host settings (config, frame skip, input deferral) stay this instance's own. Battery-backed RAM isn't persisted.
+    bool cloneFrom(Emulator const& source);
     void closeCurrentRom() { m_hasOpenedRomFile = false; }
     bool hasOpenedRomFile() const { return m_hasOpenedRomFile; }
     CartridgeInfo getCartridgeInfo() const { return m_cartridgeInfo; }
 
+    static const uint64_t sc_cyclesPerFrame = 70224;
+
     void emulate();
+    // Emulates up to and including the next VBlank, or at most maxCycles (a frame's worth while the LCD is off)
+    void runFrame(uint64_t maxCycles = sc_cyclesPerFrame);
+    void runCycles(uint64_t cycles);
+    // Run-ahead: emulates one frame you hear but don't see, then framesAhead more frames with the same input and
+    // shows the last one, and goes back to the end of the first. The game reacts to input framesAhead frames sooner.
+    void runFrameAhead(uint32_t framesAhead);
+    uint64_t getFrameCount() const;
+    // Running total of executed instructions for throughput statistics, halted cycles don't count and loadState()
+    // leaves it alone
+    uint64_t getInstructionCount() const;
+    // Emulated cycles since the ROM was opened, at the LCD's clock
+    uint64_t getElapsedCycles() const { return m_elapsedCycles; }
+    // Snapshot of the performance counters since the ROM was opened, all zero without a ROM
+    EmulatorStats getStats() const;
+    // Writes the counters of every frame as one line to the debugger output
+    void setStatsLoggingEnabled(bool enabled);
+    // Profiles the game's code from the next instruction on, null stops it. The profiler isn't owned and keeps
+    // profiling across ROM changes until it's taken away.
+    void setGuestProfiler(GuestProfiler* profiler);
+    GuestProfiler* getGuestProfiler() const { return m_guestProfiler; }
+    // Records every instruction into the trace's ring from the next one on, null stops it. Not owned either.
+    void setInstructionTrace(InstructionTrace* trace);
+    InstructionTrace* getInstructionTrace() const { return m_instructionTrace; }
+
     void processKeyboardInput(WPARAM wParam, LPARAM lParam);
+    void setKeyboardKeyState(WPARAM key, bool isPressed);
+    void setButtonPressed(Joypad::Button button, bool isPressed);
+    // Bit i set when Joypad::Button i is held
+    void setPressedButtons(uint8_t buttonMask);
+    uint8_t getPressedButtons() const;
+    // See Joypad::setHostInputDeferred, movie recording defers keyboard/controller input to frame boundaries
+    void setHostInputDeferred(bool deferred);
+    uint8_t applyHostInput();
+    // Reads and writes through the memory map like the CPU would, for observing and poking game state from the outside
+    uint8_t readMemory(uint16_t address) const;
+    void writeMemory(uint16_t address, uint8_t value);
+
+    // Interleaved stereo samples at Sound::sc_SampleRate since the last clear, if enabled in the config
+    float const* getCapturedAudioSamples(size_t* numSamples) const;
+    void clearCapturedAudioSamples();
+
+    // A frame is ready after each rendered VBlank until it's converted. Completed frames go through a triple-buffered
+    // queue, so the consumer side (these two and the queue's acquire functions) may live on another thread than emulate()
+    bool isFrameReady() const;
+    void convertFrame(Framebuffer::PixelFormat format, uint8_t* destination);
+    FrameQueue* getFrameQueue() const { return m_frameQueue.get(); }
+    void setFrameReadyCallback(FrameQueue::FrameReadyCallback callback);
 
     void saveBatteryBackedRamToFile();
     void loadSavFileToRam();
 
-    void setTurboModeMultiplier(uint32_t val) { s_turboModeMultiplier = val; }
-    static uint32_t s_turboModeMultiplier;
+    // Save states are tied to the opened ROM and always have the same size for it. The frame being drawn isn't
+    // part of a state, so only states saved at a frame boundary (after runFrame()) reproduce every frame exactly.
+    size_t getStateSize() const;
+    bool saveState(uint8_t* buffer, size_t bufferSize, size_t* stateSize = nullptr) const;
+    // Rejects states of another ROM, version or size without touching the running game
+    bool loadState(uint8_t const* state, size_t stateSize);
+    bool saveStateToFile(char const* filename) const;
+    bool loadStateFromFile(char const* filename);
+    // Hash of the whole machine state, equal for two instances that will behave the same from here on
+    uint64_t computeStateHash() const;
+
+    void setTurboModeMultiplier(uint32_t val) { m_turboModeMultiplier = val; }
+    uint32_t getTurboModeMultiplier() const { return m_turboModeMultiplier; }
+    void setLayerCacheEnabled(bool enabled);
+    // Muted audio still emulates every channel but skips mixing samples for the device or capture
+    void setAudioMuted(bool muted);
+
+    enum class FrameSkipMode
+    {
+        Disabled,   // Render every frame
+        Fixed,      // Render one frame, then skip the given number of frames
+        Auto,       // Skip frames while the host can't keep up with real time, up to the given number in a row (at least 1)
+        OnRequest,  // Only render frames asked for with requestNextFrame()
+    };
+    void setFrameSkip(FrameSkipMode mode, uint32_t framesToSkip = 0);
+    // Renders the next frame whatever the frame skip mode says
+    void requestNextFrame();
 
     enum class Mode
     {
         DMG, // Regular Game Boy
         CGB  // Color Game Boy
     };
-    static Mode s_currentMode;
-    static bool isCGBMode() { return s_currentMode == Mode::CGB; }
+    Mode getCurrentMode() const { return m_currentMode; }
+    bool isCGBMode() const { return m_currentMode == Mode::CGB; }
+    bool isDoubleSpeedMode() const;
+
+    // The opened ROM's components, for benchmarks and tools that drive them one by one. Null until a ROM is opened.
+    CPU* getCPU() const { return m_cpu.get(); }
+    Memory* getMemory() const { return m_memory.get(); }
+    Timer* getTimer() const { return m_timer.get(); }
+    LCD* getLCD() const { return m_lcd.get(); }
+    Sound* getSound() const { return m_sound.get(); }
 
 private:
+    // Rounded up to a power of two of at least two banks and padded with 0xFF, so Memory can wrap bank numbers with
+    // a mask whatever size the ROM or its header claim
+    // The ROM and RAM size bytes of the header, anything else can't be a cartridge
+    static bool hasKnownSizeCodes(uint8_t const* rom);
+    static std::shared_ptr<uint8_t[]> allocateCartridge(size_t romSize, size_t& cartridgeSize);
+    void loadCartridge();
+    void resizeScratchState(size_t stateSize) const;
     void extractCartridgeInfo();
     void switchToMode(Mode mode);
-
+    void writeState(SaveStateWriter& writer) const;
+    // False for ROMs without battery-backed RAM, ROMs opened from memory and instances that don't persist it
+    bool hasBatteryFile() const;
+    void logFrameStats();
+    // Puts the counters back, so frames run ahead of run-ahead don't count
+    void restoreStats(EmulatorStats const& stats);
+    bool readStateHeader(SaveStateReader& reader) const;
+
+    static const size_t sc_minRomSize = 0x150;       // Up to the end of the cartridge header
+    static const size_t sc_maxRomSize = 0x800000;    // 512 banks, the most MBC5 can address
+    static constexpr uint32_t sc_saveStateMagic = 'G' | ('B' << 8) | ('S' << 16) | ('S' << 24);
+    static constexpr uint32_t sc_saveStateVersion = 5;
+
+    Config m_config;
     bool m_hasOpenedRomFile = false;
-
-    ResourceHandle m_frameTexture;
-    uint8_t* m_frameTextureData;
+    uint64_t m_elapsedCycles = 0;
+    uint64_t m_cycleCount = 0;                 // At the CPU's clock, for stats
+    uint64_t m_haltCycleCount = 0;
+    bool m_isHostInputDeferred = false;
+
+    Mode m_currentMode = Mode::DMG;
+    uint32_t m_turboModeMultiplier = 1;
+
+    uint64_t m_nextSaveCheckCycle = 0;
+    std::chrono::steady_clock::time_point m_lastBatterySaveTime;
+    bool m_layerCacheEnabled = true;
+    bool m_isAudioMuted = false;
+    bool m_isStatsLoggingEnabled = false;
+    bool m_isSpeculating = false;               // While running the frames ahead of run-ahead
+    uint64_t m_lastLoggedFrame = 0;
+    EmulatorStats m_lastLoggedStats;
+    GuestProfiler* m_guestProfiler = nullptr;
+    InstructionTrace* m_instructionTrace = nullptr;
+    FrameSkipMode m_frameSkipMode = FrameSkipMode::Disabled;
+    uint32_t m_framesToSkip = 0;
+
+    // Run-ahead, cloning and state hashes go through a state kept here, so none of them allocates once it has the
+    // right size
+    mutable std::unique_ptr<uint8_t[]> m_scratchState;
+    mutable size_t m_scratchStateSize = 0;
+    size_t m_stateSize = 0;     // Fixed by the ROM and mode, measured once in loadCartridge()
 
     std::string m_romFilename;
-    std::unique_ptr<uint8_t[]> m_cartridge;
+    std::shared_ptr<uint8_t[]> m_cartridge;    // Never written to, clones share it
     size_t m_cartridgeSize = 0;
     CartridgeInfo m_cartridgeInfo;
 
-    std::unique_ptr<Memory> m_memory;
-    std::unique_ptr<CPU> m_cpu;
-    std::unique_ptr<Timer> m_timer;
-    std::unique_ptr<LCD> m_lcd;
-    std::unique_ptr<Joypad> m_joypad;
-    std::unique_ptr<Sound> m_sound;
+    // Outlives ROM changes so consumers can hold on to it
+    std::unique_ptr<FrameQueue> m_frameQueue;
+
+    // Declared before the components so it outlives them
+    ComponentArena m_componentArena;
+    ComponentArena::Pointer<Memory> m_memory;
+    ComponentArena::Pointer<CPU> m_cpu;
+    ComponentArena::Pointer<Timer> m_timer;
+    ComponentArena::Pointer<LCD> m_lcd;
+    ComponentArena::Pointer<Joypad> m_joypad;
+    ComponentArena::Pointer<Sound> m_sound;
 };
\ No newline at end of file
@@ -0,0 +1,51 @@
+#include "EmulatorStats.h"
+
+#include <cstdio>
+
+char const* EmulatorStats::getMemoryRegionName(uint32_t region)
+{
+    static char const* const sc_names[NumMemoryRegions] = { "ROM0", "ROMX", "VRAM", "SRAM", "WRAM", "OAM", "IO", "HRAM" };
+    return region < NumMemoryRegions ? sc_names[region] : "?";
+}
+
+EmulatorStats EmulatorStats::since(EmulatorStats const& earlier) const
+{
+    EmulatorStats difference = *this;
+    difference.m_instructions -= earlier.m_instructions;
+    difference.m_cycles -= earlier.m_cycles;
+    difference.m_haltCycles -= earlier.m_haltCycles;
+    for (uint32_t i = 0; i < sc_numInterrupts; i++)
+    {
+        difference.m_interrupts[i] -= earlier.m_interrupts[i];
+    }
+    for (uint32_t region = 0; region < NumMemoryRegions; region++)
+    {
+        difference.m_memoryReads[region] -= earlier.m_memoryReads[region];
+        difference.m_memoryWrites[region] -= earlier.m_memoryWrites[region];
+    }
+    difference.m_bankSwitches -= earlier.m_bankSwitches;
+    difference.m_scanlines -= earlier.m_scanlines;
+    difference.m_framesRendered -= earlier.m_framesRendered;
+    difference.m_framesSkipped -= earlier.m_framesSkipped;
+    difference.m_audioSamples -= earlier.m_audioSamples;
+    difference.m_audioUnderruns -= earlier.m_audioUnderruns;
+    return difference;
+}
+
+std::string EmulatorStats::toString() const
+{
+    using ull = unsigned long long;
+    char buffer[512];
+    snprintf(buffer, sizeof(buffer), "instructions %llu cycles %llu halted %llu interrupts %llu/%llu/%llu/%llu/%llu bank switches %llu lines %llu frames %llu skipped %llu samples %llu underruns %llu |",
+        ull(m_instructions), ull(m_cycles), ull(m_haltCycles), ull(m_interrupts[0]), ull(m_interrupts[1]), ull(m_interrupts[2]), ull(m_interrupts[3]), ull(m_interrupts[4]),
+        ull(m_bankSwitches), ull(m_scanlines), ull(m_framesRendered), ull(m_framesSkipped), ull(m_audioSamples), ull(m_audioUnderruns));
+    std::string line = buffer;
+
+    // Reads/writes per region
+    for (uint32_t region = 0; region < NumMemoryRegions; region++)
+    {
+        snprintf(buffer, sizeof(buffer), " %s %llu/%llu", getMemoryRegionName(region), ull(m_memoryReads[region]), ull(m_memoryWrites[region]));
+        line += buffer;
+    }
+    return line;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// What the emulator did since the ROM was opened. The counters are always on: every component increments its own
+// with plain adds on its hot path, and Emulator::getStats() gathers them into one snapshot. None of them are part of
+// save states, so they keep counting across loads and rewinds.
+struct EmulatorStats
+{
+    enum MemoryRegion
+    {
+        ROM0,
+        ROMX,
+        VRAM,
+        SRAM,
+        WRAM,   // Including echo RAM
+        OAM,    // Including the unused area after it
+        IO,     // Including IE
+        HRAM,
+        NumMemoryRegions,
+    };
+    static char const* getMemoryRegionName(uint32_t region);
+
+    static MemoryRegion getMemoryRegion(uint16_t address)
+    {
+        static constexpr MemoryRegion sc_regionsBelowOAM[8] = { ROM0, ROM0, ROMX, ROMX, VRAM, SRAM, WRAM, WRAM };
+        if (address < 0xFE00) return sc_regionsBelowOAM[address >> 13];
+        if (address < 0xFF00) return OAM;
+        if (address < 0xFF80 || address == 0xFFFF) return IO;
+        return HRAM;
+    }
+
+    static const uint32_t sc_numInterrupts = 5;     // In CPU::Interrupt order
+
+    uint64_t m_instructions = 0;
+    uint64_t m_cycles = 0;                          // At the CPU's clock, so twice as many per frame in double speed
+    uint64_t m_haltCycles = 0;                      // Part of m_cycles
+    uint64_t m_interrupts[sc_numInterrupts] = {};
+    uint64_t m_memoryReads[NumMemoryRegions] = {};  // By instructions, DMA and the other components don't count
+    uint64_t m_memoryWrites[NumMemoryRegions] = {};
+    uint64_t m_bankSwitches = 0;                    // Writes to ROM or RAM bank registers
+    uint64_t m_scanlines = 0;                       // Lines rasterized, skipped frames have none
+    uint64_t m_framesRendered = 0;
+    uint64_t m_framesSkipped = 0;
+    uint64_t m_audioSamples = 0;                    // Stereo samples mixed, muted sound produces none
+    uint64_t m_audioUnderruns = 0;                  // Times the audio device ran dry before the next buffer came
+
+    // Counter by counter difference, for the stats of a frame or any other interval
+    EmulatorStats since(EmulatorStats const& earlier) const;
+    // One line with every counter, e.g. for logging each frame
+    std::string toString() const;
+};
\ No newline at end of file
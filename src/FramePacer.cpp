@@ -0,0 +1,127 @@
+#include "FramePacer.h"
+#include "Emulator.h"
+#include "CPU.h"
+
+#include <Windows.h>
+#include <timeapi.h>
+#include <dwmapi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+FramePacer::FramePacer()
+{
+    // Sleeps otherwise end on the system timer's default 15.6ms tick
+    timeBeginPeriod(1);
+    reset();
+}
+
+FramePacer::~FramePacer()
+{
+    timeEndPeriod(1);
+}
+
+void FramePacer::setMode(Mode mode)
+{
+    m_mode = mode;
+    reset();
+}
+
+void FramePacer::setSpeedMultiplier(uint32_t multiplier)
+{
+    multiplier = std::max(multiplier, 1u);
+    if (multiplier == m_speedMultiplier) return;
+    m_speedMultiplier = multiplier;
+    reset();
+}
+
+void FramePacer::reset()
+{
+    m_startTime = Clock::now();
+    m_framesSinceReset = 0;
+    m_lastFrameTime = Clock::time_point();
+}
+
+void FramePacer::waitForNextFrame()
+{
+    m_framesSinceReset++;
+
+    // DwmFlush fails right away without desktop composition, the timer paces then
+    bool isPaced = m_mode == Mode::Unpaced || (m_mode == Mode::VSync && SUCCEEDED(DwmFlush()));
+    if (!isPaced)
+    {
+        std::chrono::duration<double> frameTime(Emulator::sc_cyclesPerFrame / (CPU::s_normalSpeedFrequencyHz * sc_audioLeadFactor * m_speedMultiplier));
+        Clock::time_point deadline = m_startTime + std::chrono::duration_cast<Clock::duration>(frameTime * static_cast<double>(m_framesSinceReset));
+        if (Clock::now() - deadline > frameTime * 3)
+        {
+            // Far behind, after a hitch or on a host too slow for full speed. Rushing frames out to catch up would
+            // only be another hitch.
+            m_startTime = Clock::now();
+            m_framesSinceReset = 0;
+        }
+        else
+        {
+            sleepUntil(deadline);
+        }
+    }
+
+    updateStats(Clock::now());
+}
+
+void FramePacer::sleepUntil(Clock::time_point deadline)
+{
+    Clock::duration timeLeft = deadline - Clock::now();
+    if (timeLeft > sc_spinTime)
+    {
+        Sleep(static_cast<DWORD>(std::chrono::duration_cast<std::chrono::milliseconds>(timeLeft - sc_spinTime).count()));
+    }
+    while (Clock::now() < deadline)
+    {
+        std::this_thread::yield();
+    }
+}
+
+uint64_t FramePacer::getThreadCpuTime100ns()
+{
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) return 0;
+    auto toUint64 = [](FILETIME const& time) { return (uint64_t(time.dwHighDateTime) << 32) | time.dwLowDateTime; };
+    return toUint64(kernelTime) + toUint64(userTime);
+}
+
+void FramePacer::startStatsWindow(Clock::time_point now)
+{
+    m_lastFrameTime = now;
+    m_windowFrames = 0;
+    m_windowSum = 0.0;
+    m_windowSumOfSquares = 0.0;
+    m_windowMax = 0.0;
+    m_windowStartTime = now;
+    m_windowStartCpuTime = getThreadCpuTime100ns();
+}
+
+void FramePacer::updateStats(Clock::time_point now)
+{
+    // The time between the frames around a reset doesn't count
+    if (m_lastFrameTime == Clock::time_point())
+    {
+        startStatsWindow(now);
+        return;
+    }
+
+    double frameMilliseconds = std::chrono::duration<double, std::milli>(now - m_lastFrameTime).count();
+    m_lastFrameTime = now;
+    m_windowSum += frameMilliseconds;
+    m_windowSumOfSquares += frameMilliseconds * frameMilliseconds;
+    m_windowMax = std::max(m_windowMax, frameMilliseconds);
+    if (++m_windowFrames < sc_statsWindowFrames) return;
+
+    double average = m_windowSum / m_windowFrames;
+    double wallTime100ns = std::chrono::duration<double>(now - m_windowStartTime).count() * 1e7;
+    m_stats.m_averageFrameMilliseconds = average;
+    m_stats.m_frameJitterMilliseconds = std::sqrt(std::max(m_windowSumOfSquares / m_windowFrames - average * average, 0.0));
+    m_stats.m_maxFrameMilliseconds = m_windowMax;
+    m_stats.m_cpuUtilization = wallTime100ns > 0.0 ? (getThreadCpuTime100ns() - m_windowStartCpuTime) / wallTime100ns : 0.0;
+    startStatsWindow(now);
+}
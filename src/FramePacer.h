@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+// Holds the emulation thread to the Game Boy's frame rate without keeping a core busy. After a frame it sleeps until
+// sc_spinTime before the next deadline and spins the rest, since a sleep only ends on a scheduler tick. The
+// deadlines count from the last reset rather than from the previous wake-up, so a late frame shortens the next one
+// instead of the error adding up. In VSync mode it waits for the display's next vertical blank instead.
+class FramePacer
+{
+public:
+    enum class Mode
+    {
+        Timer,      // The Game Boy's frame rate times the speed multiplier
+        VSync,      // One frame per display refresh, the game runs at the display's rate
+        Unpaced,    // Only audio output throttles
+    };
+
+    FramePacer();
+    ~FramePacer();
+
+    void setMode(Mode mode);
+    Mode getMode() const { return m_mode; }
+    void setSpeedMultiplier(uint32_t multiplier);
+    // Starts the deadlines over from now, after a pause or anything else that held frames up
+    void reset();
+
+    // Call after every emulated frame, returns once the next one is due
+    void waitForNextFrame();
+
+    // Over the last sc_statsWindowFrames frames
+    struct Stats
+    {
+        double m_averageFrameMilliseconds = 0.0;
+        double m_frameJitterMilliseconds = 0.0;     // Standard deviation of the frame times
+        double m_maxFrameMilliseconds = 0.0;
+        double m_cpuUtilization = 0.0;              // CPU time of the calling thread over wall time, 1.0 is a whole core
+    };
+    Stats getStats() const { return m_stats; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void sleepUntil(Clock::time_point deadline);
+    void startStatsWindow(Clock::time_point now);
+    void updateStats(Clock::time_point now);
+    static uint64_t getThreadCpuTime100ns();
+
+    static const uint32_t sc_statsWindowFrames = 60;
+    static constexpr std::chrono::microseconds sc_spinTime = std::chrono::microseconds(1000);
+    // The deadlines run this much ahead of the Game Boy's clock. Audio output then throttles the rest of the way
+    // instead of running dry when the host's clocks drift apart.
+    static constexpr double sc_audioLeadFactor = 1.001;
+
+    Mode m_mode = Mode::Timer;
+    uint32_t m_speedMultiplier = 1;
+    Clock::time_point m_startTime;
+    uint64_t m_framesSinceReset = 0;
+
+    Clock::time_point m_lastFrameTime;
+    uint32_t m_windowFrames = 0;
+    double m_windowSum = 0.0;
+    double m_windowSumOfSquares = 0.0;
+    double m_windowMax = 0.0;
+    Clock::time_point m_windowStartTime;
+    uint64_t m_windowStartCpuTime = 0;
+    Stats m_stats;
+};
\ No newline at end of file
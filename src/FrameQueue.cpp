@@ -0,0 +1,38 @@
+#include "FrameQueue.h"
+
+FrameQueue::FrameQueue()
+{
+    for (uint32_t i = 0; i < sc_numBuffers; i++)
+    {
+        for (uint32_t line = 0; line < Framebuffer::sc_height; line++)
+        {
+            m_buffers[i].fillLine(line, Framebuffer::sc_blankShade, Framebuffer::sc_blankColor);
+        }
+    }
+}
+
+void FrameQueue::publishBackBuffer()
+{
+    uint64_t sequenceNumber = m_publishedFrameCount.load(std::memory_order_relaxed) + 1;
+    m_sequenceNumbers[m_backIndex] = sequenceNumber;
+
+    // Release makes the frame contents visible to the consumer once it exchanges the index back out
+    uint32_t previousReadyIndex = m_readyIndex.exchange(m_backIndex | sc_newFrameBit, std::memory_order_acq_rel);
+    m_backIndex = previousReadyIndex & sc_indexMask;
+    m_publishedFrameCount.store(sequenceNumber, std::memory_order_relaxed);
+
+    if (m_frameReadyCallback)
+    {
+        m_frameReadyCallback(sequenceNumber);
+    }
+}
+
+Framebuffer const& FrameQueue::acquireLatestFrame()
+{
+    if (hasNewFrame())
+    {
+        uint32_t previousReadyIndex = m_readyIndex.exchange(m_frontIndex, std::memory_order_acq_rel);
+        m_frontIndex = previousReadyIndex & sc_indexMask;
+    }
+    return m_buffers[m_frontIndex];
+}
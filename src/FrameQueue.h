@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+#include <functional>
+
+#include "Framebuffer.h"
+
+// Triple-buffered frame output between one producer (the LCD) and one consumer (the presentation side).
+// The producer always owns a back buffer, the consumer a front buffer, and the most recently completed
+// frame sits in between. Publishing and acquiring only swap buffer indices, so neither side ever waits
+// and the consumer never sees a frame that is still being drawn.
+class FrameQueue
+{
+public:
+    static const uint32_t sc_numBuffers = 3;
+
+    // Called on the producer's thread right after a frame has been published
+    using FrameReadyCallback = std::function<void(uint64_t sequenceNumber)>;
+
+    FrameQueue();
+
+    void setFrameReadyCallback(FrameReadyCallback callback) { m_frameReadyCallback = std::move(callback); }
+
+    // Producer side
+    Framebuffer& getBackBuffer() { return m_buffers[m_backIndex]; }
+    void publishBackBuffer();
+
+    // Consumer side
+    bool hasNewFrame() const { return (m_readyIndex.load(std::memory_order_acquire) & sc_newFrameBit) != 0; }
+    // Swaps in the latest published frame if there is one; returns the consumer's current frame either way
+    Framebuffer const& acquireLatestFrame();
+    Framebuffer const& getFrontBuffer() const { return m_buffers[m_frontIndex]; }
+    // Sequence numbers start at 1 for the first published frame, 0 means nothing was acquired yet
+    uint64_t getFrontSequenceNumber() const { return m_sequenceNumbers[m_frontIndex]; }
+
+    // Total number of frames published, readable from any thread
+    uint64_t getPublishedFrameCount() const { return m_publishedFrameCount.load(std::memory_order_relaxed); }
+
+private:
+    static const uint32_t sc_indexMask = 0x3;
+    static const uint32_t sc_newFrameBit = 0x4;
+
+    Framebuffer m_buffers[sc_numBuffers];
+    uint64_t m_sequenceNumbers[sc_numBuffers] = {};
+
+    uint32_t m_backIndex = 0;                // Only touched by the producer
+    uint32_t m_frontIndex = 1;               // Only touched by the consumer
+    std::atomic<uint32_t> m_readyIndex = 2;  // Exchanged by both, with sc_newFrameBit set when unread
+
+    std::atomic<uint64_t> m_publishedFrameCount = 0;
+    FrameReadyCallback m_frameReadyCallback;
+};
\ No newline at end of file
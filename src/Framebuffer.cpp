@@ -0,0 +1,178 @@
+#include "Framebuffer.h"
+
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+struct RGB
+{
+    uint8_t r, g, b;
+};
+
+static const RGB originalGBPalette[4] = { {0x9B, 0xBC, 0x0F}, {0x8B, 0xAC, 0x0F}, {0x30, 0x62, 0x30}, {0x0F, 0x38, 0x0F} };
+static const RGB lospecPalette[4] = { {0xC7, 0xC6, 0xC6}, {0x7C, 0x6D, 0x80}, {0x38, 0x28, 0x43}, {0x00, 0x00, 0x00} };
+static const RGB greyscalePalette[4] = { {255, 255, 255}, {168, 168, 168}, {84, 84, 84}, {0, 0, 0} };
+
+static const RGB* sc_currentPalette = lospecPalette;
+
+static const uint8_t sc_maxBrightness = 200;
+static const RGB sc_white = { sc_maxBrightness, sc_maxBrightness, sc_maxBrightness };
+
+static RGB getShadeColor(uint8_t shade)
+{
+    return shade == Framebuffer::sc_blankShade ? sc_white : sc_currentPalette[shade];
+}
+
+static uint8_t getShadeGray(uint8_t shade)
+{
+    return shade == Framebuffer::sc_blankShade ? 255 : greyscalePalette[shade].r;
+}
+
+static uint32_t packPixel(RGB color, Framebuffer::PixelFormat format)
+{
+    switch (format)
+    {
+    case Framebuffer::PixelFormat::RGBA8888:
+        return color.r | (color.g << 8) | (color.b << 16) | (0xFFu << 24);
+    case Framebuffer::PixelFormat::BGRA8888:
+        return color.b | (color.g << 8) | (color.r << 16) | (0xFFu << 24);
+    case Framebuffer::PixelFormat::RGB565:
+        return ((color.r >> 3) << 11) | ((color.g >> 2) << 5) | (color.b >> 3);
+    case Framebuffer::PixelFormat::Grayscale8:
+        return (color.r * 77 + color.g * 150 + color.b * 29) >> 8;
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+struct ChannelTables
+{
+    uint8_t m_brightness[32];
+    uint8_t m_fullRange[32];
+};
+
+static ChannelTables buildChannelTables()
+{
+    ChannelTables tables = {};
+    for (uint32_t c = 0; c < 32; c++)
+    {
+        tables.m_brightness[c] = (uint8_t)round((c / 31.0) * sc_maxBrightness);
+        tables.m_fullRange[c] = (uint8_t)round((c / 31.0) * 255);
+    }
+    return tables;
+}
+
+template<Framebuffer::PixelFormat format, typename PixelType>
+static void convertColors(uint16_t const* colors, uint8_t* destination, uint8_t const* channelTable)
+{
+    PixelType* pixels = reinterpret_cast<PixelType*>(destination);
+    for (uint32_t i = 0; i < Framebuffer::sc_width * Framebuffer::sc_height; i++)
+    {
+        RGB color = { channelTable[colors[i] & 0x1F], channelTable[(colors[i] >> 5) & 0x1F], channelTable[(colors[i] >> 10) & 0x1F] };
+        pixels[i] = static_cast<PixelType>(packPixel(color, format));
+    }
+}
+
+uint32_t Framebuffer::getBytesPerPixel(PixelFormat format)
+{
+    switch (format)
+    {
+    case PixelFormat::RGBA8888:
+    case PixelFormat::BGRA8888:
+        return 4;
+    case PixelFormat::RGB565:
+        return 2;
+    case PixelFormat::Grayscale8:
+        return 1;
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+void Framebuffer::fillLine(uint32_t line, uint8_t shade, uint16_t color)
+{
+    std::memset(getShadeLine(line), shade, sc_width);
+    for (uint32_t j = 0; j < sc_width; j++)
+    {
+        m_colors[line * sc_width + j] = color;
+    }
+}
+
+uint64_t Framebuffer::computeHash() const
+{
+    uint8_t const* data = m_isCGBFrame ? reinterpret_cast<uint8_t const*>(m_colors) : m_shades;
+    size_t size = m_isCGBFrame ? sizeof(m_colors) : sizeof(m_shades);
+
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ data[i]) * 1099511628211ull;
+    }
+    return hash;
+}
+
+void Framebuffer::convertTo(PixelFormat format, uint8_t* destination) const
+{
+    const uint32_t numPixels = sc_width * sc_height;
+
+    if (!m_isCGBFrame)
+    {
+        // 5 possible shades, so the whole conversion is a single table lookup per pixel
+        uint32_t shadeToPixel[sc_blankShade + 1];
+        for (uint8_t shade = 0; shade <= sc_blankShade; shade++)
+        {
+            shadeToPixel[shade] = format == PixelFormat::Grayscale8 ? getShadeGray(shade) : packPixel(getShadeColor(shade), format);
+        }
+
+        switch (getBytesPerPixel(format))
+        {
+        case 4:
+        {
+            uint32_t* pixels = reinterpret_cast<uint32_t*>(destination);
+            for (uint32_t i = 0; i < numPixels; i++)
+            {
+                pixels[i] = shadeToPixel[m_shades[i]];
+            }
+            break;
+        }
+        case 2:
+        {
+            uint16_t* pixels = reinterpret_cast<uint16_t*>(destination);
+            for (uint32_t i = 0; i < numPixels; i++)
+            {
+                pixels[i] = static_cast<uint16_t>(shadeToPixel[m_shades[i]]);
+            }
+            break;
+        }
+        case 1:
+        {
+            for (uint32_t i = 0; i < numPixels; i++)
+            {
+                destination[i] = static_cast<uint8_t>(shadeToPixel[m_shades[i]]);
+            }
+            break;
+        }
+        }
+        return;
+    }
+
+    // CGB colors are 5 bits per channel, scaled to the same max brightness as the DMG palettes
+    static const ChannelTables sc_channelTables = buildChannelTables();
+    switch (format)
+    {
+    case PixelFormat::RGBA8888:
+        convertColors<PixelFormat::RGBA8888, uint32_t>(m_colors, destination, sc_channelTables.m_brightness);
+        break;
+    case PixelFormat::BGRA8888:
+        convertColors<PixelFormat::BGRA8888, uint32_t>(m_colors, destination, sc_channelTables.m_brightness);
+        break;
+    case PixelFormat::RGB565:
+        convertColors<PixelFormat::RGB565, uint16_t>(m_colors, destination, sc_channelTables.m_brightness);
+        break;
+    case PixelFormat::Grayscale8:
+        convertColors<PixelFormat::Grayscale8, uint8_t>(m_colors, destination, sc_channelTables.m_fullRange);
+        break;
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// Compact LCD output. DMG frames store one shade (0-3) per pixel, CGB frames the raw 15-bit BGR color.
+// Conversion to a presentation format only happens when a consumer asks for it.
+class Framebuffer
+{
+public:
+    static const uint32_t sc_width = 160;
+    static const uint32_t sc_height = 144;
+
+    // Shade of a blank screen (LCD just turned on), lighter than DMG shade 0
+    static const uint8_t sc_blankShade = 4;
+    static const uint16_t sc_blankColor = 0x7FFF;
+
+    // The 32-bit formats are opaque, alpha is always 0xFF
+    enum class PixelFormat
+    {
+        RGBA8888,
+        BGRA8888,
+        RGB565,
+        Grayscale8,
+    };
+    static uint32_t getBytesPerPixel(PixelFormat format);
+
+    void setCGBFrame(bool isCGBFrame) { m_isCGBFrame = isCGBFrame; }
+    bool isCGBFrame() const { return m_isCGBFrame; }
+
+    uint8_t* getShadeLine(uint32_t line) { return &m_shades[line * sc_width]; }
+    uint16_t* getColorLine(uint32_t line) { return &m_colors[line * sc_width]; }
+    uint8_t const* getShades() const { return m_shades; }
+    uint16_t const* getColors() const { return m_colors; }
+
+    void fillLine(uint32_t line, uint8_t shade, uint16_t color);
+    void convertTo(PixelFormat format, uint8_t* destination) const;
+
+    // 64-bit FNV-1a of the frame contents, independent of palette and output format
+    uint64_t computeHash() const;
+
+private:
+    bool m_isCGBFrame = false;
+    uint8_t m_shades[sc_width * sc_height] = {};
+    uint16_t m_colors[sc_width * sc_height] = {};
+};
\ No newline at end of file
@@ -0,0 +1,285 @@
+#include "GuestProfiler.h"
+#include "Memory.h"
+#include "EmulatorStats.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+
+static std::string getOpcodeName(uint32_t opcode)
+{
+    static char const* const sc_registers[8] = { "B", "C", "D", "E", "H", "L", "(HL)", "A" };
+    static char const* const sc_aluOperations[8] = { "ADD A,", "ADC A,", "SUB ", "SBC A,", "AND ", "XOR ", "OR ", "CP " };
+    static char const* const sc_lowOpcodes[0x40] =
+    {
+        "NOP", "LD BC,d16", "LD (BC),A", "INC BC", "INC B", "DEC B", "LD B,d8", "RLCA", "LD (a16),SP", "ADD HL,BC", "LD A,(BC)", "DEC BC", "INC C", "DEC C", "LD C,d8", "RRCA",
+        "STOP", "LD DE,d16", "LD (DE),A", "INC DE", "INC D", "DEC D", "LD D,d8", "RLA", "JR r8", "ADD HL,DE", "LD A,(DE)", "DEC DE", "INC E", "DEC E", "LD E,d8", "RRA",
+        "JR NZ,r8", "LD HL,d16", "LD (HL+),A", "INC HL", "INC H", "DEC H", "LD H,d8", "DAA", "JR Z,r8", "ADD HL,HL", "LD A,(HL+)", "DEC HL", "INC L", "DEC L", "LD L,d8", "CPL",
+        "JR NC,r8", "LD SP,d16", "LD (HL-),A", "INC SP", "INC (HL)", "DEC (HL)", "LD (HL),d8", "SCF", "JR C,r8", "ADD HL,SP", "LD A,(HL-)", "DEC SP", "INC A", "DEC A", "LD A,d8", "CCF",
+    };
+    static char const* const sc_highOpcodes[0x40] =
+    {
+        "RET NZ", "POP BC", "JP NZ,a16", "JP a16", "CALL NZ,a16", "PUSH BC", "ADD A,d8", "RST 00H", "RET Z", "RET", "JP Z,a16", "PREFIX CB", "CALL Z,a16", "CALL a16", "ADC A,d8", "RST 08H",
+        "RET NC", "POP DE", "JP NC,a16", "-", "CALL NC,a16", "PUSH DE", "SUB d8", "RST 10H", "RET C", "RETI", "JP C,a16", "-", "CALL C,a16", "-", "SBC A,d8", "RST 18H",
+        "LDH (a8),A", "POP HL", "LD (C),A", "-", "-", "PUSH HL", "AND d8", "RST 20H", "ADD SP,r8", "JP (HL)", "LD (a16),A", "-", "-", "-", "XOR d8", "RST 28H",
+        "LDH A,(a8)", "POP AF", "LD A,(C)", "DI", "-", "PUSH AF", "OR d8", "RST 30H", "LD HL,SP+r8", "LD SP,HL", "LD A,(a16)", "EI", "-", "-", "CP d8", "RST 38H",
+    };
+    static char const* const sc_cbShifts[8] = { "RLC ", "RRC ", "RL ", "RR ", "SLA ", "SRA ", "SWAP ", "SRL " };
+    static char const* const sc_cbBitOperations[4] = { "", "BIT ", "RES ", "SET " };
+
+    if (opcode >= 0x100)
+    {
+        uint32_t cbOpcode = opcode - 0x100;
+        char const* reg = sc_registers[cbOpcode & 7];
+        if (cbOpcode < 0x40) return std::string(sc_cbShifts[cbOpcode >> 3]) + reg;
+        return std::string(sc_cbBitOperations[cbOpcode >> 6]) + std::to_string((cbOpcode >> 3) & 7) + "," + reg;
+    }
+    if (opcode < 0x40) return sc_lowOpcodes[opcode];
+    if (opcode >= 0xC0) return sc_highOpcodes[opcode - 0xC0];
+    if (opcode == 0x76) return "HALT";
+    if (opcode < 0x80) return std::string("LD ") + sc_registers[(opcode >> 3) & 7] + "," + sc_registers[opcode & 7];
+    return std::string(sc_aluOperations[(opcode >> 3) & 7]) + sc_registers[opcode & 7];
+}
+
+static bool isCallOpcode(uint32_t opcode)
+{
+    // CALL, CALL cc and RST
+    return opcode == 0xCD || (opcode < 0x100 && (opcode & 0xE7) == 0xC4) || (opcode < 0x100 && (opcode & 0xC7) == 0xC7);
+}
+
+GuestProfiler::GuestProfiler(uint32_t sampleIntervalCycles)
+    : m_sampleIntervalCycles(std::max(sampleIntervalCycles, 1u))
+    , m_cyclesUntilSample(m_sampleIntervalCycles)
+{
+    m_callStack.reserve(sc_maxCallDepth);
+}
+
+void GuestProfiler::reset()
+{
+    std::fill(std::begin(m_opcodeCounts), std::end(m_opcodeCounts), 0);
+    std::fill(std::begin(m_cbOpcodeCounts), std::end(m_cbOpcodeCounts), 0);
+    std::fill(std::begin(m_opcodeCycles), std::end(m_opcodeCycles), 0);
+    m_pendingOpcode = sc_noOpcode;
+    m_cyclesUntilSample = m_sampleIntervalCycles;
+
+    m_hasPreviousStep = false;
+    m_callStack.clear();
+
+    m_sampleCount = 0;
+    m_haltedSampleCount = 0;
+    m_samplesByLocation.clear();
+    m_samplesByStack.clear();
+}
+
+bool GuestProfiler::loadSymbolFile(char const* filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open()) return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        unsigned int bank = 0;
+        unsigned int address = 0;
+        char name[256] = {};
+        if (line.empty() || line[0] == ';') continue;
+        if (sscanf(line.c_str(), "%x:%x %255s", &bank, &address, name) != 3) continue;
+        if (address > 0xFFFF) continue;
+
+        if (address < 0x4000 || address >= 0x8000) bank = 0;
+        m_symbols[(bank << 16) | address] = name;
+    }
+    return true;
+}
+
+GuestProfiler::Location GuestProfiler::getLocation(Memory const& memory, uint16_t address)
+{
+    if (address >= 0x4000 && address < 0x8000) return (uint32_t(memory.getCurrentRomBank()) << 16) | address;
+    return address;
+}
+
+std::string GuestProfiler::getLocationName(Location location) const
+{
+    static char const* const sc_interruptNames[EmulatorStats::sc_numInterrupts] = { "VBlank", "STAT", "timer", "serial", "joypad" };
+    uint16_t address = location & 0xFFFF;
+
+    auto symbol = m_symbols.upper_bound(location);
+    if (symbol != m_symbols.begin())
+    {
+        --symbol;
+        uint16_t symbolAddress = symbol->first & 0xFFFF;
+        if (symbol->first == location) return symbol->second;
+        if ((symbol->first >> 16) == (location >> 16) && EmulatorStats::getMemoryRegion(symbolAddress) == EmulatorStats::getMemoryRegion(address))
+        {
+            char offset[16];
+            snprintf(offset, sizeof(offset), "+0x%X", address - symbolAddress);
+            return symbol->second + offset;
+        }
+    }
+
+    char name[32];
+    snprintf(name, sizeof(name), "%02X:%04X", location >> 16, address);
+    if (location >= 0x40 && location <= 0x60 && (location & 7) == 0)
+    {
+        return std::string(name) + "_" + sc_interruptNames[(location - 0x40) >> 3];
+    }
+    return name;
+}
+
+void GuestProfiler::recordStep(Memory const& memory, uint16_t pc, uint16_t sp, uint64_t cycles)
+{
+    if (!m_hasPreviousStep)
+    {
+        m_hasPreviousStep = true;
+        m_pc = pc;
+        m_sp = sp;
+        m_pendingOpcode = sc_noOpcode;
+        return;
+    }
+
+    // The sample belongs to the instruction that was running, with the call stack it ran in
+    m_cyclesUntilSample -= static_cast<int64_t>(cycles);
+    while (m_cyclesUntilSample <= 0)
+    {
+        m_cyclesUntilSample += m_sampleIntervalCycles;
+        m_sampleCount++;
+        if (m_pendingOpcode == sc_noOpcode) m_haltedSampleCount++;
+        m_samplesByLocation[getLocation(memory, m_pc)]++;
+
+        std::vector<Location> stack;
+        stack.reserve(m_callStack.size());
+        for (CallFrame const& frame : m_callStack)
+        {
+            stack.push_back(frame.m_function);
+        }
+        m_samplesByStack[stack]++;
+    }
+
+    if (m_pendingOpcode < sc_interruptDispatch)
+    {
+        m_opcodeCycles[m_pendingOpcode] += cycles;
+    }
+
+    // Unwind first: anything that moved SP above a frame's return address left that frame
+    while (!m_callStack.empty() && m_callStack.back().m_returnAddressSP < sp)
+    {
+        m_callStack.pop_back();
+    }
+
+    // A taken call or a dispatched interrupt pushed exactly a return address. Calls deeper than the limit aren't
+    // tracked, their returns leave SP below the innermost tracked frame.
+    bool pushedReturnAddress = uint16_t(m_sp - 2) == sp;
+    if (pushedReturnAddress && (m_pendingOpcode == sc_interruptDispatch || isCallOpcode(m_pendingOpcode)) && m_callStack.size() < sc_maxCallDepth)
+    {
+        m_callStack.push_back({ getLocation(memory, pc), sp });
+    }
+
+    m_pc = pc;
+    m_sp = sp;
+    m_pendingOpcode = sc_noOpcode;
+}
+
+std::string GuestProfiler::getReport(uint32_t topCount) const
+{
+    using ull = unsigned long long;
+    std::string report;
+    char line[256];
+    auto percentOf = [](uint64_t count, uint64_t total) { return total > 0 ? 100.0 * count / total : 0.0; };
+
+    uint64_t numInstructions = 0;
+    for (uint32_t i = 0; i < 0x100; i++)
+    {
+        numInstructions += m_opcodeCounts[i];
+    }
+    snprintf(line, sizeof(line), "%llu samples, one every %u cycles, %.1f%% halted. %llu instructions.\n",
+        ull(m_sampleCount), m_sampleIntervalCycles, percentOf(m_haltedSampleCount, m_sampleCount), ull(numInstructions));
+    report += line;
+
+    // Hot spots
+    std::vector<std::pair<Location, uint64_t>> locations(m_samplesByLocation.begin(), m_samplesByLocation.end());
+    std::sort(locations.begin(), locations.end(), [](auto const& a, auto const& b) { return a.second != b.second ? a.second > b.second : a.first < b.first; });
+    report += "\nHot spots\n   samples       %  location\n";
+    for (size_t i = 0; i < locations.size() && i < topCount; i++)
+    {
+        snprintf(line, sizeof(line), "%10llu  %5.1f%%  %s\n", ull(locations[i].second), percentOf(locations[i].second, m_sampleCount), getLocationName(locations[i].first).c_str());
+        report += line;
+    }
+
+    // Functions: self samples are those with the function innermost, total samples those with it anywhere on the stack
+    std::unordered_map<Location, std::pair<uint64_t, uint64_t>> functions;
+    static const Location sc_root = 0xFFFFFFFF;
+    for (auto const& [stack, count] : m_samplesByStack)
+    {
+        functions[stack.empty() ? sc_root : stack.back()].first += count;
+        std::unordered_set<Location> seen;
+        for (Location function : stack)
+        {
+            if (seen.insert(function).second) functions[function].second += count;
+        }
+        if (stack.empty()) functions[sc_root].second += count;
+    }
+    std::vector<std::pair<Location, std::pair<uint64_t, uint64_t>>> sortedFunctions(functions.begin(), functions.end());
+    std::sort(sortedFunctions.begin(), sortedFunctions.end(), [](auto const& a, auto const& b) { return a.second.first != b.second.first ? a.second.first > b.second.first : a.first < b.first; });
+    report += "\nFunctions\n      self       %     total       %  function\n";
+    for (size_t i = 0; i < sortedFunctions.size() && i < topCount; i++)
+    {
+        auto const& [function, counts] = sortedFunctions[i];
+        snprintf(line, sizeof(line), "%10llu  %5.1f%%  %8llu  %5.1f%%  %s\n", ull(counts.first), percentOf(counts.first, m_sampleCount),
+            ull(counts.second), percentOf(counts.second, m_sampleCount), function == sc_root ? "(root)" : getLocationName(function).c_str());
+        report += line;
+    }
+
+    // Opcodes, CB-prefixed ones count as both 0xCB and their own
+    auto addOpcodeTable = [&](char const* title, uint64_t const* counts, uint32_t base, uint64_t total)
+    {
+        std::vector<uint32_t> opcodes;
+        for (uint32_t i = 0; i < 0x100; i++)
+        {
+            if (counts[i] > 0) opcodes.push_back(i);
+        }
+        std::sort(opcodes.begin(), opcodes.end(), [counts](uint32_t a, uint32_t b) { return counts[a] != counts[b] ? counts[a] > counts[b] : a < b; });
+        report += title;
+        report += "\n     count       %      cycles  opcode\n";
+        for (size_t i = 0; i < opcodes.size() && i < topCount; i++)
+        {
+            uint32_t opcode = opcodes[i];
+            snprintf(line, sizeof(line), "%10llu  %5.1f%%  %10llu  %s%02X %s\n", ull(counts[opcode]), percentOf(counts[opcode], total), ull(m_opcodeCycles[base + opcode]),
+                base > 0 ? "CB " : "", opcode, getOpcodeName(base + opcode).c_str());
+            report += line;
+        }
+    };
+    addOpcodeTable("\nOpcodes", m_opcodeCounts, 0, numInstructions);
+    addOpcodeTable("\nCB opcodes", m_cbOpcodeCounts, sc_cbOpcodeBase, m_opcodeCounts[0xCB]);
+    return report;
+}
+
+std::string GuestProfiler::getCollapsedStacks() const
+{
+    std::ostringstream stream;
+    for (auto const& [stack, count] : m_samplesByStack)
+    {
+        if (stack.empty()) stream << "(root)";
+        for (size_t i = 0; i < stack.size(); i++)
+        {
+            stream << (i > 0 ? ";" : "") << getLocationName(stack[i]);
+        }
+        stream << ' ' << count << '\n';
+    }
+    return stream.str();
+}
+
+bool GuestProfiler::writeReport(char const* filename, uint32_t topCount) const
+{
+    std::ofstream file(filename);
+    file << getReport(topCount);
+    return file.good();
+}
+
+bool GuestProfiler::writeCollapsedStacks(char const* filename) const
+{
+    std::ofstream file(filename);
+    file << getCollapsedStacks();
+    return file.good();
+}
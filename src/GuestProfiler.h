@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+
+class Memory;
+
+// Profiles the game's code rather than the emulator's: how often each opcode (CB-prefixed ones apart) runs and how
+// many cycles it takes, plus a (bank, PC) sample every N cycles together with the guest call stack. The call stack
+// follows CALL, RST and interrupt dispatch, and a frame is dropped once SP moves above the return address it pushed,
+// so RET, RETI and games that pop their return address and jump both unwind it.
+//
+// Nothing is recorded until it's handed to Emulator::setGuestProfiler(). Frames run speculatively for run-ahead aren't
+// profiled, only the ones that are kept.
+class GuestProfiler
+{
+public:
+    GuestProfiler(uint32_t sampleIntervalCycles = 1024);
+
+    // Names locations after an RGBDS/BGB style symbol file ("BB:AAAA name" per line, ; comments)
+    bool loadSymbolFile(char const* filename);
+    void reset();
+
+    uint32_t getSampleIntervalCycles() const { return m_sampleIntervalCycles; }
+    uint64_t getSampleCount() const { return m_sampleCount; }
+    uint64_t getOpcodeCount(uint8_t opcode) const { return m_opcodeCounts[opcode]; }
+    uint64_t getCBOpcodeCount(uint8_t opcode) const { return m_cbOpcodeCounts[opcode]; }
+
+    // Hot spots by PC, functions by self and total samples and both opcode histograms, topCount lines each
+    std::string getReport(uint32_t topCount = 30) const;
+    // One line per distinct call stack, "root;caller;callee samples", for flamegraph.pl, speedscope and alike
+    std::string getCollapsedStacks() const;
+    bool writeReport(char const* filename, uint32_t topCount = 30) const;
+    bool writeCollapsedStacks(char const* filename) const;
+
+    // Called by the CPU as it fetches opcodes and dispatches interrupts
+    void recordOpcode(uint8_t opcode)
+    {
+        m_opcodeCounts[opcode]++;
+        m_pendingOpcode = opcode;
+    }
+    void recordCBOpcode(uint8_t opcode)
+    {
+        m_cbOpcodeCounts[opcode]++;
+        m_pendingOpcode = sc_cbOpcodeBase + opcode;
+    }
+    void recordInterruptDispatch() { m_pendingOpcode = sc_interruptDispatch; }
+    // Called by the emulator after each step with the CPU's registers afterwards and the cycles it took
+    void recordStep(Memory const& memory, uint16_t pc, uint16_t sp, uint64_t cycles);
+
+private:
+    static const uint32_t sc_cbOpcodeBase = 0x100;
+    static const uint32_t sc_interruptDispatch = 0x200;
+    static const uint32_t sc_noOpcode = 0x201;      // Halted
+    static const uint32_t sc_maxCallDepth = 256;
+
+    // Bank in the upper 16 bits, address in the lower, the bank is 0 outside of switchable ROM
+    using Location = uint32_t;
+    static Location getLocation(Memory const& memory, uint16_t address);
+    std::string getLocationName(Location location) const;
+
+    struct CallFrame
+    {
+        Location m_function;
+        uint16_t m_returnAddressSP;     // Where the return address is, the frame is gone once SP is above it
+    };
+
+    uint32_t m_sampleIntervalCycles;
+    int64_t m_cyclesUntilSample;
+
+    uint64_t m_opcodeCounts[0x100] = {};
+    uint64_t m_cbOpcodeCounts[0x100] = {};
+    uint64_t m_opcodeCycles[0x200] = {};
+    uint32_t m_pendingOpcode = sc_noOpcode;
+
+    bool m_hasPreviousStep = false;
+    uint16_t m_pc = 0;                  // Before the step being recorded
+    uint16_t m_sp = 0;
+    std::vector<CallFrame> m_callStack;
+
+    uint64_t m_sampleCount = 0;
+    uint64_t m_haltedSampleCount = 0;
+    std::unordered_map<Location, uint64_t> m_samplesByLocation;
+    std::map<std::vector<Location>, uint64_t> m_samplesByStack;   // Outermost function first
+
+    std::map<Location, std::string> m_symbols;
+};
\ No newline at end of file
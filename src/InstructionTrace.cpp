@@ -0,0 +1,320 @@
+#include "InstructionTrace.h"
+#include "Memory.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+
+InstructionTrace::InstructionTrace(size_t sizeBytes, char const* ringFilename)
+{
+    m_numBlocks = static_cast<uint32_t>(std::max<size_t>(sizeBytes / sc_blockSize, 2));
+    m_ringSize = sizeof(FileHeader) + size_t(m_numBlocks) * sc_blockSize;
+
+    if (ringFilename)
+    {
+        HANDLE file = CreateFileA(ringFilename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return;
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, DWORD(uint64_t(m_ringSize) >> 32), DWORD(m_ringSize & 0xFFFFFFFF), nullptr);
+        void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, m_ringSize) : nullptr;
+        if (!view)
+        {
+            if (mapping) CloseHandle(mapping);
+            CloseHandle(file);
+            return;
+        }
+        m_file = file;
+        m_fileMapping = mapping;
+        m_ring = static_cast<uint8_t*>(view);
+    }
+    else
+    {
+        m_memoryRing = std::make_unique<uint8_t[]>(m_ringSize);
+        m_ring = m_memoryRing.get();
+    }
+
+    FileHeader header;
+    header.m_blockSize = sc_blockSize;
+    header.m_numBlocks = m_numBlocks;
+    memcpy(m_ring, &header, sizeof(header));
+    m_blocks = m_ring + sizeof(FileHeader);
+    clear();
+}
+
+InstructionTrace::~InstructionTrace()
+{
+    if (m_fileMapping)
+    {
+        UnmapViewOfFile(m_ring);
+        CloseHandle(m_fileMapping);
+        CloseHandle(m_file);
+    }
+}
+
+void InstructionTrace::clear()
+{
+    if (!m_ring) return;
+
+    for (uint64_t slot = 0; slot < m_numBlocks; slot++)
+    {
+        *getBlockHeader(slot) = { sc_unusedBlock, sizeof(BlockHeader), 0 };
+    }
+    m_recordCount = 0;
+    m_nextSequence = 0;
+    m_pendingCycles = 0;
+    m_isAfterInterrupt = false;
+    m_hasTriggered = false;
+    startNextBlock();
+}
+
+void InstructionTrace::startNextBlock()
+{
+    uint64_t sequence = m_nextSequence++;
+    m_currentBlock = getBlockHeader(sequence % m_numBlocks);
+    *m_currentBlock = { sequence, sizeof(BlockHeader), 0 };
+    m_writePosition = reinterpret_cast<uint8_t*>(m_currentBlock) + sizeof(BlockHeader);
+    m_isFirstRecordOfBlock = true;
+}
+
+void InstructionTrace::setAddressTrigger(int32_t bank, uint16_t address, std::string const& filename)
+{
+    m_triggerAddress = address;
+    m_triggerBank = bank;
+    m_triggerFilename = filename;
+}
+
+void InstructionTrace::setOpcodeTrigger(uint8_t opcode, std::string const& filename)
+{
+    m_triggerOpcode = opcode;
+    m_triggerFilename = filename;
+}
+
+void InstructionTrace::clearTriggers()
+{
+    m_triggerAddress = -1;
+    m_triggerOpcode = -1;
+}
+
+void InstructionTrace::trigger()
+{
+    m_hasTriggered = true;
+    m_isRecording = false;
+    dumpToFile(m_triggerFilename.c_str());
+}
+
+static uint8_t* writeVarint(uint8_t* position, uint32_t value)
+{
+    while (value >= 0x80)
+    {
+        *position++ = uint8_t(value | 0x80);
+        value >>= 7;
+    }
+    *position++ = uint8_t(value);
+    return position;
+}
+
+void InstructionTrace::record(Memory& memory, uint16_t pc, uint8_t opcode, uint16_t AF, uint16_t BC, uint16_t DE, uint16_t HL, uint16_t SP)
+{
+    if (!m_isRecording || !m_ring) return;
+
+    // Asked every time, the bank also changes without a bank switch when a state is loaded or MBC1 changes mode
+    uint16_t bank = (pc >= 0x4000 && pc < 0x8000) ? memory.getCurrentRomBank() : 0;
+
+    if (m_writePosition + sc_maxRecordSize > reinterpret_cast<uint8_t*>(m_currentBlock) + sc_blockSize)
+    {
+        startNextBlock();
+    }
+
+    uint8_t registers[8] = { uint8_t(AF >> 8), uint8_t(AF), uint8_t(BC >> 8), uint8_t(BC), uint8_t(DE >> 8), uint8_t(DE), uint8_t(HL >> 8), uint8_t(HL) };
+    uint8_t* position = m_writePosition;
+    uint8_t* header = position;
+    position += 2;
+
+    uint8_t changedRegisters = 0;
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        if (registers[i] != m_previousRegisters[i] || m_isFirstRecordOfBlock)
+        {
+            changedRegisters |= 1 << i;
+            *position++ = registers[i];
+            m_previousRegisters[i] = registers[i];
+        }
+    }
+
+    uint8_t flags = m_isAfterInterrupt ? AfterInterrupt : 0;
+    if (SP != m_previousSP || m_isFirstRecordOfBlock)
+    {
+        flags |= SPChanged;
+        memcpy(position, &SP, 2);
+        position += 2;
+        m_previousSP = SP;
+    }
+    if (bank != m_previousBank || m_isFirstRecordOfBlock)
+    {
+        flags |= BankChanged;
+        memcpy(position, &bank, 2);
+        position += 2;
+        m_previousBank = bank;
+    }
+    header[0] = changedRegisters;
+    header[1] = flags;
+
+    // Zigzag, so short jumps back stay short too
+    int16_t pcDelta = static_cast<int16_t>(pc - (m_isFirstRecordOfBlock ? 0 : m_previousPC));
+    position = writeVarint(position, uint32_t((pcDelta << 1) ^ (pcDelta >> 15)) & 0x1FFFF);
+    position = writeVarint(position, static_cast<uint32_t>(std::min<uint64_t>(m_pendingCycles, UINT32_MAX)));
+    m_previousPC = pc;
+
+    position[0] = opcode;
+    position[1] = memory.read(uint16_t(pc + 1));
+    position[2] = memory.read(uint16_t(pc + 2));
+    position[3] = memory.read(uint16_t(pc + 3));
+    position += 4;
+
+    m_writePosition = position;
+    m_currentBlock->m_usedBytes = static_cast<uint32_t>(position - reinterpret_cast<uint8_t*>(m_currentBlock));
+    m_currentBlock->m_numRecords++;
+    m_recordCount++;
+    m_pendingCycles = 0;
+    m_isAfterInterrupt = false;
+    m_isFirstRecordOfBlock = false;
+
+    // The triggering instruction is the last one in the dump
+    if ((pc == m_triggerAddress && (bank == 0 || m_triggerBank < 0 || bank == m_triggerBank)) || opcode == m_triggerOpcode)
+    {
+        trigger();
+    }
+}
+
+bool InstructionTrace::dumpToFile(char const* filename) const
+{
+    if (!m_ring) return false;
+
+    // The ring holds the latest numBlocks blocks by sequence number
+    std::vector<BlockHeader const*> blocks;
+    for (uint64_t sequence = m_nextSequence > m_numBlocks ? m_nextSequence - m_numBlocks : 0; sequence < m_nextSequence; sequence++)
+    {
+        BlockHeader const* block = getBlockHeader(sequence % m_numBlocks);
+        if (block->m_sequence == sequence && block->m_numRecords > 0) blocks.push_back(block);
+    }
+
+    FileHeader header;
+    header.m_blockSize = sc_blockSize;
+    header.m_numBlocks = static_cast<uint32_t>(blocks.size());
+
+    std::ofstream file(filename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    file.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    for (BlockHeader const* block : blocks)
+    {
+        file.write(reinterpret_cast<char const*>(block), sc_blockSize);
+    }
+    return file.good();
+}
+
+bool InstructionTraceReader::open(char const* filename)
+{
+    std::error_code error;
+    size_t fileSize = std::filesystem::file_size(filename, error);
+    if (error || fileSize < sizeof(InstructionTrace::FileHeader)) return false;
+
+    m_data.resize(fileSize);
+    std::ifstream file(filename, std::fstream::in | std::fstream::binary);
+    file.read(reinterpret_cast<char*>(m_data.data()), fileSize);
+    if (!file.good()) return false;
+
+    InstructionTrace::FileHeader header;
+    memcpy(&header, m_data.data(), sizeof(header));
+    if (header.m_magic != InstructionTrace::sc_magic || header.m_version != InstructionTrace::sc_version) return false;
+    if (header.m_blockSize < sizeof(InstructionTrace::BlockHeader)) return false;
+    if (sizeof(header) + uint64_t(header.m_numBlocks) * header.m_blockSize > fileSize) return false;
+
+    // A ring file has its blocks in any order, a dump oldest first
+    std::vector<std::pair<uint64_t, size_t>> blocks;
+    for (uint32_t i = 0; i < header.m_numBlocks; i++)
+    {
+        size_t offset = sizeof(header) + size_t(i) * header.m_blockSize;
+        InstructionTrace::BlockHeader block;
+        memcpy(&block, &m_data[offset], sizeof(block));
+        if (block.m_sequence == InstructionTrace::sc_unusedBlock || block.m_numRecords == 0) continue;
+        if (block.m_usedBytes > header.m_blockSize) return false;
+        blocks.push_back({ block.m_sequence, offset });
+    }
+    std::sort(blocks.begin(), blocks.end());
+
+    m_blockOffsets.clear();
+    for (auto const& block : blocks)
+    {
+        m_blockOffsets.push_back(block.second);
+    }
+    m_currentBlock = 0;
+    m_isCorrupt = false;
+    return startBlock();
+}
+
+bool InstructionTraceReader::startBlock()
+{
+    if (m_currentBlock >= m_blockOffsets.size()) return false;
+
+    InstructionTrace::BlockHeader block;
+    memcpy(&block, &m_data[m_blockOffsets[m_currentBlock]], sizeof(block));
+    m_position = m_blockOffsets[m_currentBlock] + sizeof(block);
+    m_blockEnd = m_blockOffsets[m_currentBlock] + block.m_usedBytes;
+    m_previous = Record();
+    return true;
+}
+
+bool InstructionTraceReader::next(Record& record)
+{
+    while (m_position >= m_blockEnd)
+    {
+        m_currentBlock++;
+        if (!startBlock()) return false;
+    }
+
+    auto readByte = [this]() { return m_position < m_blockEnd ? m_data[m_position++] : (m_isCorrupt = true, uint8_t(0)); };
+    auto readVarint = [&readByte]()
+    {
+        uint32_t value = 0;
+        for (uint32_t shift = 0; shift < 35; shift += 7)
+        {
+            uint8_t byte = readByte();
+            value |= uint32_t(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) break;
+        }
+        return value;
+    };
+
+    record = m_previous;
+    uint8_t changedRegisters = readByte();
+    uint8_t flags = readByte();
+    uint8_t* registers[8] = { &record.m_A, &record.m_F, &record.m_B, &record.m_C, &record.m_D, &record.m_E, &record.m_H, &record.m_L };
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        if (changedRegisters & (1 << i)) *registers[i] = readByte();
+    }
+    if (flags & InstructionTrace::SPChanged)
+    {
+        record.m_SP = readByte();
+        record.m_SP |= readByte() << 8;
+    }
+    if (flags & InstructionTrace::BankChanged)
+    {
+        record.m_bank = readByte();
+        record.m_bank |= readByte() << 8;
+    }
+    record.m_isAfterInterrupt = (flags & InstructionTrace::AfterInterrupt) != 0;
+
+    uint32_t zigzag = readVarint();
+    int16_t pcDelta = static_cast<int16_t>((zigzag >> 1) ^ (~(zigzag & 1) + 1));
+    record.m_pc = uint16_t(m_previous.m_pc + pcDelta);
+    record.m_cycleDelta = readVarint();
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        record.m_bytes[i] = readByte();
+    }
+
+    m_previous = record;
+    return !m_isCorrupt;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+
+class Memory;
+
+// Binary trace of the latest executed instructions: PC, ROM bank, the 4 bytes at PC, AF/BC/DE/HL/SP before the
+// instruction and the cycles since the previous one. Records are delta encoded against the previous record, around
+// 10 bytes for a typical instruction, and go into a ring of fixed-size blocks that each start with a full record, so
+// the oldest block can be dropped whole once the ring is full.
+//
+// The ring lives in memory or in a mapped file. A mapped ring is always a readable trace, also after a crash. A dump
+// writes the blocks oldest first, on demand or when a trigger fires. gb_tracedump turns either into text.
+class InstructionTrace
+{
+public:
+    static const size_t sc_defaultSizeBytes = 64 * 1024 * 1024;
+
+    // Without a file name the ring is allocated in memory
+    InstructionTrace(size_t sizeBytes = sc_defaultSizeBytes, char const* ringFilename = nullptr);
+    ~InstructionTrace();
+
+    // False if the ring file couldn't be created or mapped
+    bool isValid() const { return m_ring != nullptr; }
+
+    void setRecording(bool isRecording) { m_isRecording = isRecording; }
+    bool isRecording() const { return m_isRecording; }
+    void clear();
+    uint64_t getRecordCount() const { return m_recordCount; }
+
+    // Writes the ring oldest first, readable by InstructionTraceReader
+    bool dumpToFile(char const* filename) const;
+
+    // Dump to filename and stop recording once the game executes the address (in the given bank if it's in
+    // switchable ROM, any bank with -1) or the opcode, e.g. 0x40 (LD B,B), which test ROMs use as a breakpoint
+    void setAddressTrigger(int32_t bank, uint16_t address, std::string const& filename);
+    void setOpcodeTrigger(uint8_t opcode, std::string const& filename);
+    void clearTriggers();
+    bool hasTriggered() const { return m_hasTriggered; }
+
+    // Called by the CPU before every instruction and after every interrupt dispatch, and by the emulator after every step
+    void record(Memory& memory, uint16_t pc, uint8_t opcode, uint16_t AF, uint16_t BC, uint16_t DE, uint16_t HL, uint16_t SP);
+    void recordInterruptDispatch() { m_isAfterInterrupt = true; }
+    void addCycles(uint64_t cycles) { m_pendingCycles += cycles; }
+
+    // Layout of a ring file and a dump: the file header, then numBlocks blocks of blockSize bytes, each starting with a
+    // block header. A block with the sequence number sc_unusedBlock holds nothing yet.
+    struct FileHeader
+    {
+        uint32_t m_magic = sc_magic;
+        uint32_t m_version = sc_version;
+        uint32_t m_blockSize = 0;
+        uint32_t m_numBlocks = 0;
+        uint8_t m_padding[48] = {};
+    };
+    struct BlockHeader
+    {
+        uint64_t m_sequence;
+        uint32_t m_usedBytes;       // Including this header
+        uint32_t m_numRecords;
+    };
+    static constexpr uint32_t sc_magic = 'G' | ('B' << 8) | ('T' << 16) | ('R' << 24);
+    static constexpr uint32_t sc_version = 1;
+    static constexpr uint64_t sc_unusedBlock = ~0ull;
+    static const uint32_t sc_blockSize = 64 * 1024;
+
+    // First byte: which of A, F, B, C, D, E, H and L follow. Second byte: these flags.
+    enum RecordFlags : uint8_t
+    {
+        SPChanged = 1 << 0,
+        BankChanged = 1 << 1,
+        AfterInterrupt = 1 << 2,
+    };
+    // Then the changed registers, SP, bank, the PC as zigzag varint delta, the cycle delta as varint and the 4 bytes at PC
+    static const uint32_t sc_maxRecordSize = 2 + 8 + 2 + 2 + 3 + 5 + 4;
+
+private:
+    BlockHeader* getBlockHeader(uint64_t slot) const { return reinterpret_cast<BlockHeader*>(m_blocks + slot * sc_blockSize); }
+    void startNextBlock();
+    void trigger();
+
+    uint8_t* m_ring = nullptr;          // File header followed by the blocks
+    uint8_t* m_blocks = nullptr;
+    size_t m_ringSize = 0;
+    uint32_t m_numBlocks = 0;
+    std::unique_ptr<uint8_t[]> m_memoryRing;
+    void* m_file = nullptr;             // Windows handles of a mapped ring
+    void* m_fileMapping = nullptr;
+
+    bool m_isRecording = true;
+    uint64_t m_recordCount = 0;
+    uint64_t m_nextSequence = 0;
+    BlockHeader* m_currentBlock = nullptr;
+    uint8_t* m_writePosition = nullptr;
+
+    // What the previous record left the decoder with, a block's first record starts from zero with everything changed
+    uint8_t m_previousRegisters[8] = {};
+    uint16_t m_previousSP = 0;
+    uint16_t m_previousPC = 0;
+    uint16_t m_previousBank = 0;
+    bool m_isFirstRecordOfBlock = true;
+
+    uint64_t m_pendingCycles = 0;
+    bool m_isAfterInterrupt = false;
+
+    int32_t m_triggerAddress = -1;
+    int32_t m_triggerBank = -1;
+    int32_t m_triggerOpcode = -1;
+    std::string m_triggerFilename;
+    bool m_hasTriggered = false;
+};
+
+// Reads a ring file or a dump back, oldest instruction first
+class InstructionTraceReader
+{
+public:
+    struct Record
+    {
+        uint16_t m_pc = 0;
+        uint16_t m_bank = 0;            // Mapped to 0x4000-0x7FFF when the instruction ran
+        uint8_t m_bytes[4] = {};        // At PC, the opcode first
+        uint8_t m_A = 0, m_F = 0, m_B = 0, m_C = 0, m_D = 0, m_E = 0, m_H = 0, m_L = 0;
+        uint16_t m_SP = 0;
+        uint32_t m_cycleDelta = 0;      // Cycles since the previous instruction started, at the CPU's clock
+        bool m_isAfterInterrupt = false;
+    };
+
+    bool open(char const* filename);
+    // False once every record was read or a block turned out to be corrupt
+    bool next(Record& record);
+    bool isCorrupt() const { return m_isCorrupt; }
+
+private:
+    bool startBlock();
+
+    std::vector<uint8_t> m_data;
+    std::vector<size_t> m_blockOffsets;     // Oldest first
+    size_t m_currentBlock = 0;
+    size_t m_position = 0;
+    size_t m_blockEnd = 0;
+    Record m_previous;
+    bool m_isCorrupt = false;
+};
\ No newline at end of file
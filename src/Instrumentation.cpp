@@ -0,0 +1,148 @@
+#include "Instrumentation.h"
+
+#ifdef EMULATOR_INSTRUMENTATION
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Instrumentation
+{
+    static const uint64_t sc_instant = ~0ull;
+
+    struct Event
+    {
+        char const* m_name;
+        uint64_t m_startNs;
+        uint64_t m_durationNs;      // sc_instant for instants
+    };
+
+    // Written by its thread only, read by writeChromeTrace()
+    struct ThreadBuffer
+    {
+        uint32_t m_threadId = 0;
+        std::string m_threadName;   // Guarded by s_registryMutex
+        std::unique_ptr<Event[]> m_events = std::make_unique<Event[]>(sc_eventsPerThread);
+        std::atomic<uint64_t> m_writeIndex = 0;
+    };
+
+    // Buffers stay around after their thread ends, so its events still make it into the trace
+    static std::mutex s_registryMutex;
+    static std::vector<std::unique_ptr<ThreadBuffer>> s_threadBuffers;
+    static thread_local ThreadBuffer* s_threadBuffer = nullptr;
+
+    static ThreadBuffer& getThreadBuffer()
+    {
+        if (!s_threadBuffer)
+        {
+            std::lock_guard<std::mutex> lock(s_registryMutex);
+            s_threadBuffers.push_back(std::make_unique<ThreadBuffer>());
+            s_threadBuffer = s_threadBuffers.back().get();
+            s_threadBuffer->m_threadId = static_cast<uint32_t>(s_threadBuffers.size());
+        }
+        return *s_threadBuffer;
+    }
+
+    static void recordEvent(char const* name, uint64_t startNs, uint64_t durationNs)
+    {
+        ThreadBuffer& buffer = getThreadBuffer();
+        uint64_t index = buffer.m_writeIndex.load(std::memory_order_relaxed);
+        buffer.m_events[index & (sc_eventsPerThread - 1)] = { name, startNs, durationNs };
+        buffer.m_writeIndex.store(index + 1, std::memory_order_release);
+    }
+
+    uint64_t getTimestampNs()
+    {
+        static const std::chrono::steady_clock::time_point sc_start = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - sc_start).count();
+    }
+
+    void recordZone(char const* name, uint64_t startNs, uint64_t endNs)
+    {
+        recordEvent(name, startNs, endNs - startNs);
+    }
+
+    void recordInstant(char const* name)
+    {
+        recordEvent(name, getTimestampNs(), sc_instant);
+    }
+
+    void setThreadName(char const* name)
+    {
+        ThreadBuffer& buffer = getThreadBuffer();
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        buffer.m_threadName = name;
+    }
+
+    static std::string escapeJson(char const* text)
+    {
+        std::string escaped;
+        for (; *text; text++)
+        {
+            if (*text == '"' || *text == '\\') escaped += '\\';
+            escaped += *text;
+        }
+        return escaped;
+    }
+
+    bool writeChromeTrace(char const* filename)
+    {
+        std::ofstream file(filename);
+        if (!file.is_open()) return false;
+
+        std::lock_guard<std::mutex> lock(s_registryMutex);
+        file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+        bool isFirstEvent = true;
+        std::vector<Event> events;
+        char line[512];
+        for (auto const& buffer : s_threadBuffers)
+        {
+            uint32_t threadId = buffer->m_threadId;
+            std::string threadName = buffer->m_threadName.empty() ? "Thread " + std::to_string(threadId) : buffer->m_threadName;
+            snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                isFirstEvent ? "" : ",\n", threadId, escapeJson(threadName.c_str()).c_str());
+            file << line;
+            isFirstEvent = false;
+
+            // Copy the latest events, then drop the ones the thread may have overwritten meanwhile
+            uint64_t endIndex = buffer->m_writeIndex.load(std::memory_order_acquire);
+            uint64_t beginIndex = endIndex > sc_eventsPerThread ? endIndex - sc_eventsPerThread : 0;
+            events.clear();
+            for (uint64_t i = beginIndex; i < endIndex; i++)
+            {
+                events.push_back(buffer->m_events[i & (sc_eventsPerThread - 1)]);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t indexAfterCopy = buffer->m_writeIndex.load(std::memory_order_relaxed);
+            // The thread may already be writing the event at indexAfterCopy, which shares its slot with the one a
+            // whole ring before it
+            uint64_t firstIntactIndex = indexAfterCopy + 1 > sc_eventsPerThread ? indexAfterCopy + 1 - sc_eventsPerThread : 0;
+
+            for (uint64_t i = std::max(beginIndex, firstIntactIndex); i < endIndex; i++)
+            {
+                Event const& event = events[i - beginIndex];
+                if (event.m_durationNs == sc_instant)
+                {
+                    snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":1,\"tid\":%u,\"ts\":%.3f}",
+                        escapeJson(event.m_name).c_str(), threadId, event.m_startNs / 1000.0);
+                }
+                else
+                {
+                    snprintf(line, sizeof(line), ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                        escapeJson(event.m_name).c_str(), threadId, event.m_startNs / 1000.0, event.m_durationNs / 1000.0);
+                }
+                file << line;
+            }
+        }
+        file << "\n]}\n";
+        return file.good();
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#pragma once
+
+// Timeline of the emulator's phases on the host's clock, written as Chrome trace events for chrome://tracing,
+// Perfetto or speedscope. Only compiled in with EMULATOR_INSTRUMENTATION defined (premake5 --instrumentation=zones),
+// EMULATOR_INSTRUMENTATION_DETAIL adds the zones entered once per instruction (--instrumentation=detail). Otherwise
+// every macro expands to nothing.
+//
+//   INSTRUMENT_ZONE("Scanline render");      Times the rest of the enclosing scope
+//   INSTRUMENT_ZONE_DETAIL("...");           The same, only with EMULATOR_INSTRUMENTATION_DETAIL
+//   INSTRUMENT_INSTANT("LCD mode 3");        Marks a point in time
+//   INSTRUMENT_THREAD_NAME("Emulation");     Names the calling thread in the trace
+//   INSTRUMENT_WRITE_TRACE("trace.json");    Writes the events of every thread so far
+//
+// Names must outlive the trace, string literals do. Every thread records into its own ring of the latest
+// sc_eventsPerThread events without taking locks. Writing the trace only reads the rings and drops the events a
+// thread overwrote while they were being copied, so it can happen while the other threads keep running.
+
+#ifdef EMULATOR_INSTRUMENTATION
+
+#include <cstdint>
+
+namespace Instrumentation
+{
+    static const uint32_t sc_eventsPerThread = 1 << 18;
+
+    // Nanoseconds since the first call in this process
+    uint64_t getTimestampNs();
+    void recordZone(char const* name, uint64_t startNs, uint64_t endNs);
+    void recordInstant(char const* name);
+    void setThreadName(char const* name);
+    bool writeChromeTrace(char const* filename);
+
+    class Zone
+    {
+    public:
+        Zone(char const* name) : m_name(name), m_startNs(getTimestampNs()) {}
+        ~Zone() { recordZone(m_name, m_startNs, getTimestampNs()); }
+
+        Zone(Zone const&) = delete;
+        Zone& operator=(Zone const&) = delete;
+
+    private:
+        char const* m_name;
+        uint64_t m_startNs;
+    };
+}
+
+#define INSTRUMENT_CONCAT_INNER(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_INNER(a, b)
+#define INSTRUMENT_ZONE(name) Instrumentation::Zone INSTRUMENT_CONCAT(instrumentationZone, __LINE__)(name)
+#define INSTRUMENT_INSTANT(name) Instrumentation::recordInstant(name)
+#define INSTRUMENT_THREAD_NAME(name) Instrumentation::setThreadName(name)
+#define INSTRUMENT_WRITE_TRACE(filename) Instrumentation::writeChromeTrace(filename)
+
+#ifdef EMULATOR_INSTRUMENTATION_DETAIL
+#define INSTRUMENT_ZONE_DETAIL(name) INSTRUMENT_ZONE(name)
+#else
+#define INSTRUMENT_ZONE_DETAIL(name)
+#endif
+
+#else
+
+#define INSTRUMENT_ZONE(name)
+#define INSTRUMENT_ZONE_DETAIL(name)
+#define INSTRUMENT_INSTANT(name)
+#define INSTRUMENT_THREAD_NAME(name)
+#define INSTRUMENT_WRITE_TRACE(filename)
+
+#endif
\ No newline at end of file
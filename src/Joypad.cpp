@@ -3,9 +3,12 @@
 #include <Windows.h>
 #include <Xinput.h>
 
+#include <chrono>
+
 #include "Memory.h"
+#include "SaveState.h"
 
-Joypad::Joypad(Memory* memory)
+Joypad::Joypad(Memory* memory, bool enableControllerInput)
     : m_memory(memory)
     , m_upPressed(1)
     , m_downPressed(1)
@@ -17,14 +20,20 @@ Joypad::Joypad(Memory* memory)
     , m_selectPressed(1)
     , m_LBPressed(1)
     , m_RBPressed(1)
-    , m_controllerPollingThread(&Joypad::pollControllerInput, this)
 {
+    if (enableControllerInput)
+    {
+        m_controllerPollingThread = std::thread(&Joypad::pollControllerInput, this);
+    }
 }
 
 Joypad::~Joypad()
 {
     m_continueControllerPollingThread = false;
-    m_controllerPollingThread.join();
+    if (m_controllerPollingThread.joinable())
+    {
+        m_controllerPollingThread.join();
+    }
 }
 
 bool Joypad::updateJOYPRegister()
@@ -53,49 +62,121 @@ bool Joypad::updateJOYPRegister()
     return (JOYP & 0x0F) != (newJOYP & 0x0F);
 }
 
+void Joypad::saveState(SaveStateWriter& writer) const
+{
+    writer.write(m_upPressed);
+    writer.write(m_downPressed);
+    writer.write(m_leftPressed);
+    writer.write(m_rightPressed);
+    writer.write(m_APressed);
+    writer.write(m_BPressed);
+    writer.write(m_startPressed);
+    writer.write(m_selectPressed);
+}
+
+void Joypad::loadState(SaveStateReader& reader)
+{
+    reader.read(m_upPressed);
+    reader.read(m_downPressed);
+    reader.read(m_leftPressed);
+    reader.read(m_rightPressed);
+    reader.read(m_APressed);
+    reader.read(m_BPressed);
+    reader.read(m_startPressed);
+    reader.read(m_selectPressed);
+}
+
 void Joypad::processKeyboardInput(WPARAM wParam, LPARAM lParam)
+{
+    setKeyboardKeyState(wParam, (GetKeyState(static_cast<int>(wParam)) & 0x8000) != 0);
+}
+
+void Joypad::setKeyboardKeyState(WPARAM key, bool isPressed)
 {
     m_currentInputDeviceType = InputDeviceType::Keyboard;
 
-    switch (wParam)
+    switch (key)
     {
     case VK_DOWN:
-        m_downPressed = (GetKeyState(VK_DOWN) & 0x8000) >> 15;
-        m_downPressed = m_downPressed ? 0 : 1;
+        setHostButtonPressed(Button::Down, isPressed);
         break;
     case VK_UP:
-        m_upPressed = (GetKeyState(VK_UP) & 0x8000) >> 15;
-        m_upPressed = m_upPressed ? 0 : 1;
+        setHostButtonPressed(Button::Up, isPressed);
         break;
     case VK_LEFT:
-        m_leftPressed = (GetKeyState(VK_LEFT) & 0x8000) >> 15;
-        m_leftPressed = m_leftPressed ? 0 : 1;
+        setHostButtonPressed(Button::Left, isPressed);
         break;
     case VK_RIGHT:
-        m_rightPressed = (GetKeyState(VK_RIGHT) & 0x8000) >> 15;
-        m_rightPressed = m_rightPressed ? 0 : 1;
+        setHostButtonPressed(Button::Right, isPressed);
         break;
     case 0x5A: // Z
-        m_APressed = (GetKeyState(0x5A) & 0x8000) >> 15;
-        m_APressed = m_APressed ? 0 : 1;
+        setHostButtonPressed(Button::A, isPressed);
         break;
     case 0x58: // X
-        m_BPressed = (GetKeyState(0x58) & 0x8000) >> 15;
-        m_BPressed = m_BPressed ? 0 : 1;
+        setHostButtonPressed(Button::B, isPressed);
         break;
     case 0x43: // C
-        m_startPressed = (GetKeyState(0x43) & 0x8000) >> 15;
-        m_startPressed = m_startPressed ? 0 : 1;
+        setHostButtonPressed(Button::Start, isPressed);
         break;
     case 0x56: // V
-        m_selectPressed = (GetKeyState(0x56) & 0x8000) >> 15;
-        m_selectPressed = m_selectPressed ? 0 : 1;
+        setHostButtonPressed(Button::Select, isPressed);
         break;
     default:
         break;
     }
 }
 
+void Joypad::setButtonPressed(Button button, bool isPressed)
+{
+    *getButtonState(button) = isPressed ? 0 : 1;
+}
+
+uint8_t Joypad::getPressedButtonMask() const
+{
+    // Button states are 0 when held
+    return (!m_rightPressed) | (!m_leftPressed << 1) | (!m_upPressed << 2) | (!m_downPressed << 3) |
+        (!m_APressed << 4) | (!m_BPressed << 5) | (!m_selectPressed << 6) | (!m_startPressed << 7);
+}
+
+void Joypad::setPressedButtonMask(uint8_t buttonMask)
+{
+    for (uint32_t button = 0; button < 8; button++)
+    {
+        setButtonPressed(static_cast<Button>(button), (buttonMask >> button) & 1);
+    }
+}
+
+uint8_t Joypad::applyHostInput()
+{
+    uint8_t buttonMask = m_hostButtonMask;
+    setPressedButtonMask(buttonMask);
+    return buttonMask;
+}
+
+void Joypad::setHostButtonPressed(Button button, bool isPressed)
+{
+    uint8_t buttonBit = 1 << static_cast<uint32_t>(button);
+    if (isPressed)
+    {
+        m_hostButtonMask |= buttonBit;
+    }
+    else
+    {
+        m_hostButtonMask &= ~buttonBit;
+    }
+
+    if (!m_isHostInputDeferred)
+    {
+        setButtonPressed(button, isPressed);
+    }
+}
+
+uint8_t* Joypad::getButtonState(Button button)
+{
+    uint8_t* buttonStates[] = { &m_rightPressed, &m_leftPressed, &m_upPressed, &m_downPressed, &m_APressed, &m_BPressed, &m_selectPressed, &m_startPressed };
+    return buttonStates[static_cast<uint32_t>(button)];
+}
+
 void Joypad::pollControllerInput()
 {
     while (m_continueControllerPollingThread)
@@ -105,14 +186,14 @@ void Joypad::pollControllerInput()
         {
             if (m_currentInputDeviceType == InputDeviceType::Controller)
             {
-                m_APressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_A) ? 0 : 1;
-                m_BPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_B) ? 0 : 1;
-                m_startPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_START) ? 0 : 1;
-                m_selectPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_BACK) ? 0 : 1;
-                m_downPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_DOWN) ? 0 : 1;
-                m_upPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_UP) ? 0 : 1;
-                m_leftPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_LEFT) ? 0 : 1;
-                m_rightPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_RIGHT) ? 0 : 1;
+                setHostButtonPressed(Button::A, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_A);
+                setHostButtonPressed(Button::B, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_B);
+                setHostButtonPressed(Button::Start, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_START);
+                setHostButtonPressed(Button::Select, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_BACK);
+                setHostButtonPressed(Button::Down, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_DOWN);
+                setHostButtonPressed(Button::Up, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_UP);
+                setHostButtonPressed(Button::Left, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_LEFT);
+                setHostButtonPressed(Button::Right, controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_DPAD_RIGHT);
                 m_LBPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_LEFT_SHOULDER) ? 0 : 1;
                 m_RBPressed = (controllerState.Gamepad.wButtons & XINPUT_GAMEPAD_RIGHT_SHOULDER) ? 0 : 1;
             }
@@ -133,15 +214,20 @@ void Joypad::pollControllerInput()
             {
                 if (std::abs(normalizedLX) > std::abs(normalizedLY))
                 {
-                    m_leftPressed = normalizedLX < 0 ? 0 : 1;
-                    m_rightPressed = normalizedLX > 0 ? 0 : 1;
+                    setHostButtonPressed(Button::Left, normalizedLX < 0);
+                    setHostButtonPressed(Button::Right, normalizedLX > 0);
                 }
                 else
                 {
-                    m_downPressed = normalizedLY < 0 ? 0 : 1;
-                    m_upPressed = normalizedLY > 0 ? 0 : 1;
+                    setHostButtonPressed(Button::Down, normalizedLY < 0);
+                    setHostButtonPressed(Button::Up, normalizedLY > 0);
                 }
             }
+            std::this_thread::sleep_for(std::chrono::milliseconds(sc_controllerPollIntervalMs));
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(sc_disconnectedPollIntervalMs));
         }
     }
 }
@@ -3,17 +3,26 @@
 #include <Windows.h>
 #include <cstdint>
 #include <thread>
+#include <atomic>
 
 class Memory;
+class SaveStateWriter;
+class SaveStateReader;
 
 class Joypad
 {
 public:
-    Joypad(Memory* memory);
+    Joypad(Memory* memory, bool enableControllerInput);
     ~Joypad();
 
     bool updateJOYPRegister();
+
+    void saveState(SaveStateWriter& writer) const;
+    void loadState(SaveStateReader& reader);
+
     void processKeyboardInput(WPARAM wParam, LPARAM lParam);
+    // For callers that resolved the key state themselves, GetKeyState only knows about the calling thread's input
+    void setKeyboardKeyState(WPARAM key, bool isPressed);
 
     enum InputDeviceType
     {
@@ -21,11 +30,36 @@ public:
         Controller
     };
 
+    enum class Button
+    {
+        Right,
+        Left,
+        Up,
+        Down,
+        A,
+        B,
+        Select,
+        Start,
+    };
+    // Programmatic input, goes straight to what the game sees
+    void setButtonPressed(Button button, bool isPressed);
+    // Bit i set when Button i is held
+    uint8_t getPressedButtonMask() const;
+    void setPressedButtonMask(uint8_t buttonMask);
+
+    // Keyboard and controller input reaches the game as soon as it happens, from whatever thread it comes from.
+    // Deferred, it's only collected and applyHostInput() hands it to the game, so it can happen at known points.
+    void setHostInputDeferred(bool deferred) { m_isHostInputDeferred = deferred; }
+    // Returns the button mask the game sees from now on
+    uint8_t applyHostInput();
+
     InputDeviceType getCurrentInputDeviceType() const { return m_currentInputDeviceType; }
     bool areShoulderButtonsBeingPressed() const { return !m_LBPressed || !m_RBPressed; }
 
 private:
     void pollControllerInput();
+    void setHostButtonPressed(Button button, bool isPressed);
+    uint8_t* getButtonState(Button button);
 
     Memory* m_memory;
 
@@ -40,6 +74,13 @@ private:
     uint8_t m_LBPressed;
     uint8_t m_RBPressed;
 
+    std::atomic<uint8_t> m_hostButtonMask = 0;
+    std::atomic<bool> m_isHostInputDeferred = false;
+
+    // A connected controller is polled every millisecond, an empty port far less often since asking it is expensive
+    static constexpr uint32_t sc_controllerPollIntervalMs = 1;
+    static constexpr uint32_t sc_disconnectedPollIntervalMs = 250;
+
     std::thread m_controllerPollingThread;
     bool m_continueControllerPollingThread = true;
 
@@ -3,27 +3,34 @@
 #include "Emulator.h"
 #include "CPU.h"
 #include "Memory.h"
+#include "SaveState.h"
+#include "Instrumentation.h"
 
 #include <vector>
 #include <algorithm>
+#include <cstring>
+#include <chrono>
 
-static const LCD::RGB originalGBPalette[4] = { {0x9B, 0xBC, 0x0F}, {0x8B, 0xAC, 0x0F}, {0x30, 0x62, 0x30}, {0x0F, 0x38, 0x0F} };
-static const LCD::RGB lospecPalette[4] = { {0xC7, 0xC6, 0xC6}, {0x7C, 0x6D, 0x80}, {0x38, 0x28, 0x43}, {0x00, 0x00, 0x00} };
-static const LCD::RGB greyscalePalette[4] = { {255, 255, 255}, {168, 168, 168}, {84, 84, 84}, {0, 0, 0} };
+static const uint16_t sc_CGBWhite = 0x7FFF;
 
-static const LCD::RGB* sc_currentPalette = lospecPalette;
-
-static const uint8_t sc_maxBrightness = 200;
-static const LCD::RGB sc_white = { sc_maxBrightness, sc_maxBrightness, sc_maxBrightness };
-
-LCD::LCD(CPU* cpu, Memory* memory, ResourceHandle frameTexture, uint8_t* frameTextureData)
-    : m_cpu(cpu)
+LCD::LCD(Emulator* emulator, CPU* cpu, Memory* memory, FrameQueue* frameQueue)
+    : m_emulator(emulator)
+	, m_cpu(cpu)
 	, m_memory(memory)
-	, m_frameTexture(frameTexture)
-	, m_frameTextureData(frameTextureData)
+	, m_frameQueue(frameQueue)
     , m_timerCounter(0)
 	, m_currentLine(-1)
 {
+	if (m_emulator->isCGBMode())
+	{
+		m_writeScanlineToFrame = &LCD::writeScanlineToFrame<Emulator::Mode::CGB>;
+		m_readSpritesToDraw = &LCD::readSpritesToDraw<Emulator::Mode::CGB>;
+	}
+	else
+	{
+		m_writeScanlineToFrame = &LCD::writeScanlineToFrame<Emulator::Mode::DMG>;
+		m_readSpritesToDraw = &LCD::readSpritesToDraw<Emulator::Mode::DMG>;
+	}
 }
 
 LCD::~LCD()
@@ -32,27 +39,22 @@ LCD::~LCD()
 
 void LCD::clearScreen()
 {
+	Framebuffer& framebuffer = m_frameQueue->getBackBuffer();
 	for (uint32_t i = 0; i < 144; i++)
 	{
-		fillScanlineWithColor(i, sc_white);
-	}
-}
-
-void LCD::fillScanlineWithColor(uint8_t line, RGB color)
-{
-	for (uint32_t j = 0; j < 160; j++)
-	{
-		m_frameTextureData[(line * 160 + j) * 4] = color.r;
-		m_frameTextureData[(line * 160 + j) * 4 + 1] = color.g;
-		m_frameTextureData[(line * 160 + j) * 4 + 2] = color.b;
+		framebuffer.fillLine(i, Framebuffer::sc_blankShade, sc_CGBWhite);
 	}
 }
 
+template<Emulator::Mode mode>
 void LCD::readSpritesToDraw()
 {
+	constexpr bool isCGB = (mode == Emulator::Mode::CGB);
+	INSTRUMENT_ZONE("Sprite fetch");
+
 	uint8_t LCDC = m_memory->read(0xFF40);
 	uint8_t SpriteSize = (LCDC & 4) >> 2; // (0=8x8, 1=8x16)
-	m_spritesToDraw.clear();
+	m_numSpritesToDraw = 0;
 	// Selection priority, first 10 in mem that can be drawn are selected
 	for (int i = 0; i < 40; i++)
 	{
@@ -66,17 +68,17 @@ void LCD::readSpritesToDraw()
 		if ((sprite.spriteY - 16) <= m_currentLine &&
 			(sprite.spriteY - 16 + (SpriteSize ? 16 : 8)) > m_currentLine)
 		{
-			m_spritesToDraw.push_back(sprite);
+			m_spritesToDraw[m_numSpritesToDraw++] = sprite;
 		}
-		if (m_spritesToDraw.size() >= 10)
+		if (m_numSpritesToDraw >= sc_maxSpritesPerLine)
 		{
 			break;
 		}
 	}
 	// Drawing priority
-	std::sort(m_spritesToDraw.begin(), m_spritesToDraw.end(), [&](Sprite const& a, Sprite const& b)
+	std::sort(m_spritesToDraw, m_spritesToDraw + m_numSpritesToDraw, [&](Sprite const& a, Sprite const& b)
 		{
-			if (!Emulator::isCGBMode())
+			if constexpr (!isCGB)
 			{
 				if (a.spriteX < b.spriteX) return true;
 				if (a.spriteX == b.spriteX && a.locationInOAM < b.locationInOAM) return true;
@@ -90,6 +92,84 @@ void LCD::readSpritesToDraw()
 
 }
 
+void LCD::collectStats(EmulatorStats& stats) const
+{
+	stats.m_scanlines = m_scanlineCount;
+	stats.m_framesRendered = m_renderedFrameCount;
+	stats.m_framesSkipped = m_skippedFrameCount;
+}
+
+void LCD::restoreStats(EmulatorStats const& stats)
+{
+	m_scanlineCount = stats.m_scanlines;
+	m_renderedFrameCount = stats.m_framesRendered;
+	m_skippedFrameCount = stats.m_framesSkipped;
+}
+
+void LCD::setFrameSkip(Emulator::FrameSkipMode mode, uint32_t framesToSkip)
+{
+	m_frameSkipMode = mode;
+	m_framesToSkip = framesToSkip;
+	m_skippedFramesInARow = 0;
+	m_lastFrameStartTime = std::chrono::steady_clock::now();
+}
+
+void LCD::saveState(SaveStateWriter& writer) const
+{
+	writer.write(m_timerCounter);
+	writer.write(m_currentLine);
+	writer.write(m_isDisplayEnabled);
+	writer.write(m_frameCount);
+}
+
+void LCD::loadState(SaveStateReader& reader)
+{
+	reader.read(m_timerCounter);
+	reader.read(m_currentLine);
+	reader.read(m_isDisplayEnabled);
+	reader.read(m_frameCount);
+
+	// What only drawing uses stays out of states, since it depends on which frames the host skips. The frame being
+	// drawn isn't part of a state anyway; the sprites of a line in pixel transfer are fetched again from the loaded OAM.
+	m_skipNextFrame = false;
+	m_numSpritesToDraw = 0;
+	if (m_isDisplayEnabled && (m_memory->read(0xFF41) & 3) == 3)
+	{
+		(this->*m_readSpritesToDraw)();
+	}
+}
+
+void LCD::beginFrame()
+{
+	bool renderFrame = true;
+	switch (m_frameSkipMode)
+	{
+	case Emulator::FrameSkipMode::Disabled:
+		renderFrame = true;
+		break;
+	case Emulator::FrameSkipMode::Fixed:
+		renderFrame = m_skippedFramesInARow >= m_framesToSkip;
+		break;
+	case Emulator::FrameSkipMode::Auto:
+	{
+		// Skip while the last frame took longer on the host than it lasts on real hardware
+		auto now = std::chrono::steady_clock::now();
+		double hostFrameSeconds = std::chrono::duration<double>(now - m_lastFrameStartTime).count();
+		double emulatedFrameSeconds = (sc_cyclesPerFrame / static_cast<double>(CPU::s_normalSpeedFrequencyHz)) / m_emulator->getTurboModeMultiplier();
+		m_lastFrameStartTime = now;
+		renderFrame = hostFrameSeconds <= emulatedFrameSeconds || m_skippedFramesInARow >= std::max(m_framesToSkip, 1u);
+		break;
+	}
+	case Emulator::FrameSkipMode::OnRequest:
+		renderFrame = false;
+		break;
+	}
+
+	m_renderCurrentFrame = renderFrame || m_isNextFrameRequested;
+	m_isNextFrameRequested = false;
+	m_skippedFramesInARow = m_renderCurrentFrame ? 0 : m_skippedFramesInARow + 1;
+}
+
 void LCD::checkForSTATInterrupt()
 {
 	uint8_t LCDStatusRegister = m_memory->read(0xFF41);
@@ -122,6 +202,7 @@ void LCD::update(uint64_t cyclesToEmulate)
 	if (m_isDisplayEnabled && !newIsDisplayEnabled)
 	{
 		// if the LCD was just disabled, clear LY=LYC and mode bits in STAT, set LY to 0 and clear the framebuffer
+		INSTRUMENT_INSTANT("LCD off");
 		m_memory->write(0xFF41, m_memory->read(0xFF41) & 0xF8);
 		m_currentLine = 0;
 		m_memory->write(0xFF44, m_currentLine);
@@ -131,11 +212,13 @@ void LCD::update(uint64_t cyclesToEmulate)
 	if (!m_isDisplayEnabled && newIsDisplayEnabled)
 	{
 		// if the LCD was just enabled, reset state to first scanline, clear the STAT interrupt and skip rendering the next frame
+		INSTRUMENT_INSTANT("LCD on");
 		m_memory->write(0xFF41, (m_memory->read(0xFF41) & 0b11111100) | 2);
 		m_memory->write(0xFF0F, m_memory->read(0xFF0F) & ~(1 << CPU::Interrupt::LCD_STAT));
 		m_skipNextFrame = true;
 		m_timerCounter = 0;
 		clearScreen();
+		beginFrame();
 	}
 
 	m_isDisplayEnabled = newIsDisplayEnabled;
@@ -159,8 +242,12 @@ void LCD::update(uint64_t cyclesToEmulate)
 	case 2:
 		if (m_timerCounter >= 80)
 		{
-			readSpritesToDraw();
+			if (m_renderCurrentFrame)
+			{
+				(this->*m_readSpritesToDraw)();
+			}
 			// Enter scanline mode 3
+			INSTRUMENT_INSTANT("LCD mode 3 (pixel transfer)");
 			m_timerCounter -= 80;
 			m_memory->write(0xFF41, (m_memory->read(0xFF41) & 0b11111100) | 3);
 		}
@@ -172,6 +259,7 @@ void LCD::update(uint64_t cyclesToEmulate)
 		if (m_timerCounter >= 172)
 		{
 			// Enter hblank
+			INSTRUMENT_INSTANT("LCD mode 0 (HBlank)");
 			m_timerCounter -= 172;
 			m_memory->write(0xFF41, (m_memory->read(0xFF41) & 0b11111100));
 
@@ -180,7 +268,7 @@ void LCD::update(uint64_t cyclesToEmulate)
 				m_cpu->requestInterrupt(CPU::Interrupt::LCD_STAT);
 			}
 
-			writeScanlineToFrame();
+			(this->*m_writeScanlineToFrame)();
 
 			if (m_currentLine >= 0 && m_currentLine <= 143)
 			{
@@ -201,6 +289,7 @@ void LCD::update(uint64_t cyclesToEmulate)
 			if (m_currentLine == 144)
 			{
 				// Enter vblank
+				INSTRUMENT_INSTANT("LCD mode 1 (VBlank)");
 				m_memory->write(0xFF41, (m_memory->read(0xFF41) & 0b11111100) | 1);
 
 				m_cpu->requestInterrupt(CPU::Interrupt::VBlank);
@@ -209,10 +298,21 @@ void LCD::update(uint64_t cyclesToEmulate)
 					m_cpu->requestInterrupt(CPU::Interrupt::LCD_STAT);
 				}
 
-				m_frameTexture.setNeedsCopyToGPU();
+				m_frameCount++;
+				if (m_renderCurrentFrame)
+				{
+					m_frameQueue->getBackBuffer().setCGBFrame(m_emulator->isCGBMode());
+					m_frameQueue->publishBackBuffer();
+					m_renderedFrameCount++;
+				}
+				else
+				{
+					m_skippedFrameCount++;
+				}
 			}
 			else
 			{
+				INSTRUMENT_INSTANT("LCD mode 2 (OAM scan)");
 				m_memory->write(0xFF41, (m_memory->read(0xFF41) & 0b11111100) | 2);
 
 				if (OAMInterruptEnable)
@@ -235,6 +335,7 @@ void LCD::update(uint64_t cyclesToEmulate)
 			if (m_currentLine > 153)
 			{
 				// Restart scanning modes
+				INSTRUMENT_INSTANT("LCD mode 2 (OAM scan)");
 				m_memory->write(0xFF41, (m_memory->read(0xFF41) & 0b11111100) | 2);
 
 				if (OAMInterruptEnable)
@@ -246,6 +347,7 @@ void LCD::update(uint64_t cyclesToEmulate)
 				checkForSTATInterrupt();
 
 				m_skipNextFrame = false;
+				beginFrame();
 			}
 		}
 		break;
@@ -265,134 +367,71 @@ void LCD::update(uint64_t cyclesToEmulate)
 	}
 }
 
+template<Emulator::Mode mode>
 void LCD::writeScanlineToFrame()
 {
-	if (m_currentLine >= 144 || m_skipNextFrame) return;
+	constexpr bool isCGB = (mode == Emulator::Mode::CGB);
+
+	if (m_currentLine >= 144 || m_skipNextFrame || !m_renderCurrentFrame) return;
+	INSTRUMENT_ZONE("Scanline render");
+	m_scanlineCount++;
 
 	// Read LCD control register
 	uint8_t LCDC = m_memory->read(0xFF40);
 	uint8_t LCDDisplayEnable = (LCDC & 128) >> 7;		// (0=Off, 1=On)
-	uint8_t WindowTileMapSelect = (LCDC & 64) >> 6;		// (0=9800-9BFF, 1=9C00-9FFF)
-	uint8_t WindowDisplayEnable = (LCDC & 32) >> 5;		// (0=Off, 1=On)
-	uint8_t BGWindowTileDataSelect = (LCDC & 16) >> 4;	// (0=8800-97FF, 1=8000-8FFF)
-	uint8_t BGTileMapDisplaySelect = (LCDC & 8) >> 3;	// (0=9800-9BFF, 1=9C00-9FFF)
 	uint8_t SpriteSize = (LCDC & 4) >> 2;				// (0=8x8, 1=8x16)
 	uint8_t SpriteDisplayEnable = (LCDC & 2) >> 1;		// (0=Off, 1=On)
 	uint8_t BGDisplayEnable = (LCDC & 1);				// (0=Off, 1=On)
 	uint8_t BGDisplayPriority = (LCDC & 1);				// CGB-only (0=BG/Window lose prio, 1=Prio is as normal)
 
+	Framebuffer& framebuffer = m_frameQueue->getBackBuffer();
 	if (LCDDisplayEnable == 0)
 	{
-		fillScanlineWithColor(m_currentLine, Emulator::isCGBMode() ? sc_white : sc_currentPalette[0]);
+		framebuffer.fillLine(m_currentLine, 0, sc_CGBWhite);
 		return;
 	}
 
-	if (BGDisplayEnable || Emulator::isCGBMode())
+	uint8_t* shadeLine = framebuffer.getShadeLine(m_currentLine);
+	uint16_t* colorLine = framebuffer.getColorLine(m_currentLine);
+
+	if (BGDisplayEnable || isCGB)
 	{
-		uint8_t WX = m_memory->read(0xFF4B) - 7;
-		uint8_t WY = m_memory->read(0xFF4A);
-		uint8_t SCX = m_memory->read(0xFF43);
-		uint8_t SCY = m_memory->read(0xFF42);
+		if (m_layerCacheEnabled)
+		{
+			fetchBackgroundLineFromLayerCache<mode>(LCDC);
+		}
+		else
+		{
+			fetchBackgroundLine<mode>(LCDC);
+		}
+
 		uint8_t paletteColors = m_memory->read(0xFF47);
-		uint16_t beginBGTileMap = BGTileMapDisplaySelect ? 0x9C00 : 0x9800;
-		uint16_t beginWindowTileMap = WindowTileMapSelect ? 0x9C00 : 0x9800;
-		uint16_t beginBGWindowTileData = BGWindowTileDataSelect ? 0x8000 : 0x8800;
-
-		int bgmX = SCX;
-		int bgmY = (SCY + m_currentLine) % 256;
-		int tileMapX = bgmX / 8;
-		int tileMapY = bgmY / 8;
-		int tileMapOffset = (tileMapY * 32) + tileMapX;
-		int tileOffsetX = 7 - (bgmX % 8);
-		int tileOffsetY = bgmY % 8;
 		for (uint32_t j = 0; j < 160; j++)
 		{
-			uint16_t beginTileMap = 0;
-			if (WindowDisplayEnable && j >= WX && m_currentLine >= WY)
-			{
-				beginTileMap = beginWindowTileMap;
-				tileMapX = ((j - WX) / 8) % 32;
-				tileMapY = ((m_currentLine - WY) / 8) % 32;
-				tileMapOffset = (tileMapY * 32) + tileMapX;
-				tileOffsetX = 7 - ((j - WX) % 8);
-				tileOffsetY = (m_currentLine - WY) % 8;
-			}
-			else
-			{
-				beginTileMap = beginBGTileMap;
-				tileMapX = ((bgmX + j) / 8) % 32;
-				tileMapOffset = (tileMapY * 32) + tileMapX;
-				tileOffsetX = 7 - ((bgmX + j) % 8);
-				tileOffsetY = bgmY % 8;
-			}
-
-			// CGB BG Map Attributes
-			uint8_t attr = Emulator::isCGBMode() ? m_memory->readFromVramBank(beginTileMap + tileMapOffset, 1) : 0;
-			uint8_t priority = (attr >> 7);
-			uint8_t yFlip = (attr >> 6) & 1;
-			uint8_t xFlip = (attr >> 5) & 1;
-			uint8_t bank = Emulator::isCGBMode() ? (attr >> 3) & 1 : 0;
-			uint8_t colorPaletteIdx = (attr & 7);
-
-			if (yFlip)
-			{
-				tileOffsetY = 7 - tileOffsetY;
-			}
-			if (xFlip)
-			{
-				tileOffsetX = 7 - tileOffsetX;
-			}
-
-			m_priorityMap[(m_currentLine * 160 + j)] = (m_priorityMap[(m_currentLine * 160 + j)] & 0x2) | (BGDisplayPriority << 2) | (priority);
+			uint8_t priority = m_bgLine[j] >> 7;
+			uint8_t colorPaletteIdx = (m_bgLine[j] >> 2) & 7;
+			uint8_t paletteIdx = m_bgLine[j] & 3;
 
-			uint16_t tileIdx = 0;
-			if (!BGWindowTileDataSelect)
-			{
-				uint8_t signedTileIdx = m_memory->readFromVramBank(beginTileMap + tileMapOffset, 0);
-				if (signedTileIdx & 0x80)
-				{
-					tileIdx = signedTileIdx - 0x80;
-				}
-				else
-				{
-					tileIdx = signedTileIdx + 0x80;
-				}
-			}
-			else
-			{
-				tileIdx = m_memory->readFromVramBank(beginTileMap + tileMapOffset, 0);
-			}
+			m_priorityMap[j] = (m_priorityMap[j] & 0x2) | (BGDisplayPriority << 2) | (priority);
 
-			uint8_t tileLSB = m_memory->readFromVramBank(beginBGWindowTileData + (tileIdx << 4) + (tileOffsetY << 1), bank);
-			uint8_t tileMSB = m_memory->readFromVramBank(beginBGWindowTileData + (tileIdx << 4) + (tileOffsetY << 1) + 1, bank);
-			uint8_t paletteIdx = (((tileMSB & (1 << tileOffsetX)) >> tileOffsetX) << 1) | (((tileLSB & (1 << tileOffsetX)) >> tileOffsetX));
-			m_BGColorIndex[(m_currentLine * 160 + j)] = paletteIdx;
-			if(Emulator::isCGBMode())
+			m_BGColorIndex[j] = paletteIdx;
+			if constexpr (isCGB)
 			{
-				uint16_t packedColor = m_memory->m_BGColorPaletteRam[(colorPaletteIdx * 4) + paletteIdx];
-				m_frameTextureData[(m_currentLine * 160 + j) * 4] = (uint8_t)round(((packedColor & 0x1F) / 31.0) * sc_maxBrightness);
-				m_frameTextureData[(m_currentLine * 160 + j) * 4 + 1] = (uint8_t)round((((packedColor >> 5) & 0x1F) / 31.0) * sc_maxBrightness);
-				m_frameTextureData[(m_currentLine * 160 + j) * 4 + 2] = (uint8_t)round((((packedColor >> 10) & 0x1F) / 31.0) * sc_maxBrightness);
+				colorLine[j] = m_memory->m_BGColorPaletteRam[(colorPaletteIdx * 4) + paletteIdx];
 			}
 			else
 			{
-				uint8_t paletteColor = (paletteColors >> (paletteIdx * 2)) & 3;
-				m_frameTextureData[(m_currentLine * 160 + j) * 4] = sc_currentPalette[paletteColor].r;
-				m_frameTextureData[(m_currentLine * 160 + j) * 4 + 1] = sc_currentPalette[paletteColor].g;
-				m_frameTextureData[(m_currentLine * 160 + j) * 4 + 2] = sc_currentPalette[paletteColor].b;
+				shadeLine[j] = (paletteColors >> (paletteIdx * 2)) & 3;
 			}
 		}
 	}
 	else
 	{
-		if (!Emulator::isCGBMode())
+		if constexpr (!isCGB)
 		{
-			for (uint32_t j = 0; j < 160; j++)
-			{
-				m_frameTextureData[(m_currentLine * 160 + j) * 4] = sc_currentPalette[0].r;
-				m_frameTextureData[(m_currentLine * 160 + j) * 4 + 1] = sc_currentPalette[0].g;
-				m_frameTextureData[(m_currentLine * 160 + j) * 4 + 2] = sc_currentPalette[0].b;
-			}
+			// BG disabled shows as color 0, which never hides sprites
+			std::memset(shadeLine, 0, Framebuffer::sc_width);
+			std::memset(m_BGColorIndex, 0, sizeof(m_BGColorIndex));
 		}
 	}
 
@@ -401,14 +440,10 @@ void LCD::writeScanlineToFrame()
 	{
 		for (int rowPixel = 0; rowPixel < 160; ++rowPixel)
 		{
-			for (int i = (int)m_spritesToDraw.size() - 1; i >= 0; --i)
+			for (int i = (int)m_numSpritesToDraw - 1; i >= 0; --i)
 			{
 				if (m_spritesToDraw[i].spriteX - 8 <= rowPixel && m_spritesToDraw[i].spriteX > rowPixel)
 				{
-					uint8_t currentBGRed = m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4];
-					uint8_t currentBGGreen = m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 1];
-					uint8_t currentBGBlue = m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 2];
-
 					uint8_t spriteY = m_spritesToDraw[i].spriteY;
 					uint8_t spriteX = m_spritesToDraw[i].spriteX;
 					uint8_t spriteTile = m_spritesToDraw[i].tileIndex;
@@ -417,12 +452,12 @@ void LCD::writeScanlineToFrame()
 					uint8_t spriteYFlip = (spriteAttributes & 64) >> 6;
 					uint8_t spriteXFlip = (spriteAttributes & 32) >> 5;
 					uint8_t paletteNumber = (spriteAttributes & 16) >> 4;
-					uint8_t bank = Emulator::isCGBMode() ? (spriteAttributes & 8) >> 3 : 0;
+					uint8_t bank = isCGB ? (spriteAttributes & 8) >> 3 : 0;
 					uint8_t colorPaletteIdx = (spriteAttributes & 7);
 					uint8_t paletteColors = paletteNumber ? m_memory->read(0xFF49) : m_memory->read(0xFF48);
 					uint16_t beginSpriteTileData = 0x8000;
 
-					m_priorityMap[(m_currentLine * 160 + rowPixel)] = (m_priorityMap[(m_currentLine * 160 + rowPixel)] & 0x5) | (OBJtoBGPriority << 1);
+					m_priorityMap[rowPixel] = (m_priorityMap[rowPixel] & 0x5) | (OBJtoBGPriority << 1);
 
 					int spriteOffsetY = m_currentLine - (spriteY - 16);
 					if (spriteYFlip)
@@ -459,39 +494,21 @@ void LCD::writeScanlineToFrame()
 					uint8_t paletteIdx = (((spriteMSB & (1 << spriteOffsetX)) >> spriteOffsetX) << 1) | (((spriteLSB & (1 << spriteOffsetX)) >> spriteOffsetX));
 					if (paletteIdx != 0)
 					{
-						if (Emulator::isCGBMode())
+						if constexpr (isCGB)
 						{
-							uint8_t prioMapValue = m_priorityMap[(m_currentLine * 160 + rowPixel)];
-							if (prioMapValue <= 4 || (prioMapValue > 4 && m_BGColorIndex[(m_currentLine * 160 + rowPixel)] == 0))
-							{
-								uint16_t packedColor = m_memory->m_OBJColorPaletteRam[(colorPaletteIdx * 4) + paletteIdx];
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4] = (uint8_t)round(((packedColor & 0x1F) / 31.0) * sc_maxBrightness);
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 1] = (uint8_t)round((((packedColor >> 5) & 0x1F) / 31.0) * sc_maxBrightness);
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 2] = (uint8_t)round((((packedColor >> 10) & 0x1F) / 31.0) * sc_maxBrightness);
-							}
-							else
+							uint8_t prioMapValue = m_priorityMap[rowPixel];
+							if (prioMapValue <= 4 || (prioMapValue > 4 && m_BGColorIndex[rowPixel] == 0))
 							{
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4] = currentBGRed;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 1] = currentBGGreen;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 2] = currentBGBlue;
+								colorLine[rowPixel] = m_memory->m_OBJColorPaletteRam[(colorPaletteIdx * 4) + paletteIdx];
 							}
 						}
 						else
 						{
 							if (!OBJtoBGPriority
 								||
-								(OBJtoBGPriority && m_BGColorIndex[(m_currentLine * 160 + rowPixel)] == 0))
+								(OBJtoBGPriority && m_BGColorIndex[rowPixel] == 0))
 							{
-								uint8_t paletteColor = (paletteColors >> (paletteIdx * 2)) & 3;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4] = sc_currentPalette[paletteColor].r;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 1] = sc_currentPalette[paletteColor].g;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 2] = sc_currentPalette[paletteColor].b;
-							}
-							else
-							{
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4] = currentBGRed;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 1] = currentBGGreen;
-								m_frameTextureData[(m_currentLine * 160 + rowPixel) * 4 + 2] = currentBGBlue;
+								shadeLine[rowPixel] = (paletteColors >> (paletteIdx * 2)) & 3;
 							}
 						}
 					}
@@ -500,3 +517,251 @@ void LCD::writeScanlineToFrame()
 		}
 	}
 }
+
+template<Emulator::Mode mode>
+void LCD::fetchBackgroundLine(uint8_t LCDC)
+{
+	constexpr bool isCGB = (mode == Emulator::Mode::CGB);
+
+	uint8_t WindowTileMapSelect = (LCDC & 64) >> 6;		// (0=9800-9BFF, 1=9C00-9FFF)
+	uint8_t WindowDisplayEnable = (LCDC & 32) >> 5;		// (0=Off, 1=On)
+	uint8_t BGWindowTileDataSelect = (LCDC & 16) >> 4;	// (0=8800-97FF, 1=8000-8FFF)
+	uint8_t BGTileMapDisplaySelect = (LCDC & 8) >> 3;	// (0=9800-9BFF, 1=9C00-9FFF)
+
+	uint8_t WX = m_memory->read(0xFF4B) - 7;
+	uint8_t WY = m_memory->read(0xFF4A);
+	uint8_t SCX = m_memory->read(0xFF43);
+	uint8_t SCY = m_memory->read(0xFF42);
+	uint16_t beginBGTileMap = BGTileMapDisplaySelect ? 0x9C00 : 0x9800;
+	uint16_t beginWindowTileMap = WindowTileMapSelect ? 0x9C00 : 0x9800;
+	uint16_t beginBGWindowTileData = BGWindowTileDataSelect ? 0x8000 : 0x8800;
+
+	int bgmX = SCX;
+	int bgmY = (SCY + m_currentLine) % 256;
+	int tileMapX = bgmX / 8;
+	int tileMapY = bgmY / 8;
+	int tileMapOffset = (tileMapY * 32) + tileMapX;
+	int tileOffsetX = 7 - (bgmX % 8);
+	int tileOffsetY = bgmY % 8;
+	for (uint32_t j = 0; j < 160; j++)
+	{
+		uint16_t beginTileMap = 0;
+		if (WindowDisplayEnable && j >= WX && m_currentLine >= WY)
+		{
+			beginTileMap = beginWindowTileMap;
+			tileMapX = ((j - WX) / 8) % 32;
+			tileMapY = ((m_currentLine - WY) / 8) % 32;
+			tileMapOffset = (tileMapY * 32) + tileMapX;
+			tileOffsetX = 7 - ((j - WX) % 8);
+			tileOffsetY = (m_currentLine - WY) % 8;
+		}
+		else
+		{
+			beginTileMap = beginBGTileMap;
+			tileMapX = ((bgmX + j) / 8) % 32;
+			tileMapOffset = (tileMapY * 32) + tileMapX;
+			tileOffsetX = 7 - ((bgmX + j) % 8);
+			tileOffsetY = bgmY % 8;
+		}
+
+		// CGB BG Map Attributes
+		uint8_t attr = isCGB ? m_memory->readFromVramBank(beginTileMap + tileMapOffset, 1) : 0;
+		uint8_t priority = (attr >> 7);
+		uint8_t yFlip = (attr >> 6) & 1;
+		uint8_t xFlip = (attr >> 5) & 1;
+		uint8_t bank = isCGB ? (attr >> 3) & 1 : 0;
+		uint8_t colorPaletteIdx = (attr & 7);
+
+		if (yFlip)
+		{
+			tileOffsetY = 7 - tileOffsetY;
+		}
+		if (xFlip)
+		{
+			tileOffsetX = 7 - tileOffsetX;
+		}
+
+		uint16_t tileIdx = 0;
+		if (!BGWindowTileDataSelect)
+		{
+			uint8_t signedTileIdx = m_memory->readFromVramBank(beginTileMap + tileMapOffset, 0);
+			if (signedTileIdx & 0x80)
+			{
+				tileIdx = signedTileIdx - 0x80;
+			}
+			else
+			{
+				tileIdx = signedTileIdx + 0x80;
+			}
+		}
+		else
+		{
+			tileIdx = m_memory->readFromVramBank(beginTileMap + tileMapOffset, 0);
+		}
+
+		uint8_t tileLSB = m_memory->readFromVramBank(beginBGWindowTileData + (tileIdx << 4) + (tileOffsetY << 1), bank);
+		uint8_t tileMSB = m_memory->readFromVramBank(beginBGWindowTileData + (tileIdx << 4) + (tileOffsetY << 1) + 1, bank);
+		uint8_t paletteIdx = (((tileMSB & (1 << tileOffsetX)) >> tileOffsetX) << 1) | (((tileLSB & (1 << tileOffsetX)) >> tileOffsetX));
+		m_bgLine[j] = (priority << 7) | (colorPaletteIdx << 2) | paletteIdx;
+	}
+}
+
+template<Emulator::Mode mode>
+void LCD::fetchBackgroundLineFromLayerCache(uint8_t LCDC)
+{
+	uint8_t WindowTileMapSelect = (LCDC & 64) >> 6;		// (0=9800-9BFF, 1=9C00-9FFF)
+	uint8_t WindowDisplayEnable = (LCDC & 32) >> 5;		// (0=Off, 1=On)
+	uint8_t BGWindowTileDataSelect = (LCDC & 16) >> 4;	// (0=8800-97FF, 1=8000-8FFF)
+	uint8_t BGTileMapDisplaySelect = (LCDC & 8) >> 3;	// (0=9800-9BFF, 1=9C00-9FFF)
+
+	uint8_t WX = m_memory->read(0xFF4B) - 7;
+	uint8_t WY = m_memory->read(0xFF4A);
+	uint8_t SCX = m_memory->read(0xFF43);
+	uint8_t SCY = m_memory->read(0xFF42);
+
+	updateLayerCache<mode>(BGWindowTileDataSelect);
+
+	uint32_t windowStartX = 160;
+	if (WindowDisplayEnable && m_currentLine >= WY)
+	{
+		windowStartX = std::min<uint32_t>(WX, 160);
+	}
+
+	// Background, a scroll-offset copy that wraps around the 256 pixel wide map
+	if (windowStartX > 0)
+	{
+		uint8_t bgY = SCY + m_currentLine;
+		prepareLayerCacheSpan<mode>(BGTileMapDisplaySelect, bgY, SCX, windowStartX);
+
+		uint8_t const* bgRow = &m_layerCache[BGTileMapDisplaySelect][bgY * 256];
+		uint32_t firstSpan = std::min<uint32_t>(windowStartX, 256 - SCX);
+		std::memcpy(m_bgLine, bgRow + SCX, firstSpan);
+		std::memcpy(m_bgLine + firstSpan, bgRow, windowStartX - firstSpan);
+	}
+
+	// Window, always drawn from its top-left corner
+	if (windowStartX < 160)
+	{
+		uint8_t windowY = m_currentLine - WY;
+		prepareLayerCacheSpan<mode>(WindowTileMapSelect, windowY, 0, 160 - windowStartX);
+
+		uint8_t const* windowRow = &m_layerCache[WindowTileMapSelect][windowY * 256];
+		std::memcpy(m_bgLine + windowStartX, windowRow, 160 - windowStartX);
+	}
+}
+
+void LCD::setLayerCacheEnabled(bool enabled)
+{
+	m_layerCacheEnabled = enabled;
+
+	// VRAM writes keep being tracked while the cache is disabled, but start over from a clean slate
+	m_layerCacheTileDataSelect = 0xFF;
+}
+
+template<Emulator::Mode mode>
+void LCD::updateLayerCache(uint8_t BGWindowTileDataSelect)
+{
+	constexpr bool isCGB = (mode == Emulator::Mode::CGB);
+
+	if (m_layerCacheTileDataSelect != BGWindowTileDataSelect)
+	{
+		m_layerCacheTileDataSelect = BGWindowTileDataSelect;
+		std::fill_n(&m_layerCacheCellDirty[0][0], 2 * 32 * 32, true);
+	}
+
+	// Tile map and CGB attribute writes invalidate their own cell
+	if (m_memory->m_anyTileMapDirty)
+	{
+		for (uint16_t i = 0; i < 0x800; i++)
+		{
+			if (m_memory->m_tileMapDirty[i])
+			{
+				m_layerCacheCellDirty[i >> 10][i & 0x3FF] = true;
+				m_memory->m_tileMapDirty[i] = false;
+			}
+		}
+		m_memory->m_anyTileMapDirty = false;
+	}
+
+	// Tile data writes invalidate every cell that currently references the tile
+	if (m_memory->m_anyTileDataDirty)
+	{
+		for (uint8_t tileMap = 0; tileMap < 2; tileMap++)
+		{
+			uint16_t beginTileMap = tileMap ? 0x9C00 : 0x9800;
+			for (uint16_t cell = 0; cell < 32 * 32; cell++)
+			{
+				if (m_layerCacheCellDirty[tileMap][cell])
+				{
+					continue;
+				}
+
+				uint8_t attr = isCGB ? m_memory->readFromVramBank(beginTileMap + cell, 1) : 0;
+				uint8_t bank = (attr >> 3) & 1;
+				uint16_t tileIdx = m_memory->readFromVramBank(beginTileMap + cell, 0);
+				if (!BGWindowTileDataSelect && tileIdx < 0x80)
+				{
+					tileIdx += 0x100;
+				}
+				m_layerCacheCellDirty[tileMap][cell] = m_memory->m_tileDataDirty[bank][tileIdx];
+			}
+		}
+		std::fill_n(&m_memory->m_tileDataDirty[0][0], 2 * 384, false);
+		m_memory->m_anyTileDataDirty = false;
+	}
+}
+
+template<Emulator::Mode mode>
+void LCD::prepareLayerCacheSpan(uint8_t tileMap, uint8_t y, uint8_t x, uint32_t width)
+{
+	uint16_t rowCell = (y / 8) * 32;
+	uint32_t firstColumn = x / 8;
+	uint32_t lastColumn = (x + width - 1) / 8;
+	for (uint32_t column = firstColumn; column <= lastColumn; column++)
+	{
+		uint16_t cell = rowCell + (column % 32);
+		if (m_layerCacheCellDirty[tileMap][cell])
+		{
+			renderLayerCacheCell<mode>(tileMap, cell);
+		}
+	}
+}
+
+template<Emulator::Mode mode>
+void LCD::renderLayerCacheCell(uint8_t tileMap, uint16_t cell)
+{
+	constexpr bool isCGB = (mode == Emulator::Mode::CGB);
+
+	uint16_t tileMapAddress = (tileMap ? 0x9C00 : 0x9800) + cell;
+	uint16_t beginBGWindowTileData = m_layerCacheTileDataSelect ? 0x8000 : 0x8800;
+
+	// CGB BG Map Attributes
+	uint8_t attr = isCGB ? m_memory->readFromVramBank(tileMapAddress, 1) : 0;
+	uint8_t priority = (attr >> 7);
+	uint8_t yFlip = (attr >> 6) & 1;
+	uint8_t xFlip = (attr >> 5) & 1;
+	uint8_t bank = (attr >> 3) & 1;
+	uint8_t colorPaletteIdx = (attr & 7);
+
+	uint16_t tileIdx = m_memory->readFromVramBank(tileMapAddress, 0);
+	if (!m_layerCacheTileDataSelect)
+	{
+		tileIdx ^= 0x80;
+	}
+
+	uint8_t* cellPixels = &m_layerCache[tileMap][(cell / 32) * 8 * 256 + (cell % 32) * 8];
+	for (int y = 0; y < 8; y++)
+	{
+		int tileOffsetY = yFlip ? 7 - y : y;
+		uint8_t tileLSB = m_memory->readFromVramBank(beginBGWindowTileData + (tileIdx << 4) + (tileOffsetY << 1), bank);
+		uint8_t tileMSB = m_memory->readFromVramBank(beginBGWindowTileData + (tileIdx << 4) + (tileOffsetY << 1) + 1, bank);
+		for (int x = 0; x < 8; x++)
+		{
+			int tileOffsetX = xFlip ? x : 7 - x;
+			uint8_t paletteIdx = (((tileMSB >> tileOffsetX) & 1) << 1) | ((tileLSB >> tileOffsetX) & 1);
+			cellPixels[y * 256 + x] = (priority << 7) | (colorPaletteIdx << 2) | paletteIdx;
+		}
+	}
+
+	m_layerCacheCellDirty[tileMap][cell] = false;
+}
@@ -1,50 +1,101 @@
 #pragma once
 
 #include <cstdint>
-#include <vector>
+#include <chrono>
 
-#include <resource/ResourceHandle.h>
+#include "Emulator.h"
+#include "FrameQueue.h"
 
 class CPU;
 class Memory;
+class SaveStateWriter;
+class SaveStateReader;
 
 class LCD
 {
 public:
-    LCD(CPU* cpu, Memory* memory, ResourceHandle frameTexture, uint8_t* frameTextureData);
+    LCD(Emulator* emulator, CPU* cpu, Memory* memory, FrameQueue* frameQueue);
     ~LCD();
 
     void update(uint64_t cyclesToEmulate);
 
-    struct RGB
-    {
-        uint8_t r, g, b;
-    };
+    // Covers the LCD's timing and the current line's sprites. The frame being drawn isn't part of it, so a
+    // state saved mid-frame shows the lines drawn before the save from whatever was in the back buffer.
+    // Whether frames get rendered is up to the host and isn't part of it either.
+    void saveState(SaveStateWriter& writer) const;
+    void loadState(SaveStateReader& reader);
+
+    void setLayerCacheEnabled(bool enabled);
+
+    void setFrameSkip(Emulator::FrameSkipMode mode, uint32_t framesToSkip);
+    void requestNextFrame() { m_isNextFrameRequested = true; }
+
+    // Number of VBlanks since the LCD was created, rendered or not
+    uint64_t getFrameCount() const { return m_frameCount; }
+    // Lines rasterized and frames rendered or skipped, see EmulatorStats
+    void collectStats(EmulatorStats& stats) const;
+    void restoreStats(EmulatorStats const& stats);
+
 private:
     void clearScreen();
-    void fillScanlineWithColor(uint8_t line, RGB color);
-    void writeScanlineToFrame();
-    void readSpritesToDraw();
+    void beginFrame();
+    template<Emulator::Mode mode> void writeScanlineToFrame();
+    template<Emulator::Mode mode> void fetchBackgroundLine(uint8_t LCDC);
+    template<Emulator::Mode mode> void fetchBackgroundLineFromLayerCache(uint8_t LCDC);
+    template<Emulator::Mode mode> void updateLayerCache(uint8_t BGWindowTileDataSelect);
+    template<Emulator::Mode mode> void prepareLayerCacheSpan(uint8_t tileMap, uint8_t y, uint8_t x, uint32_t width);
+    template<Emulator::Mode mode> void renderLayerCacheCell(uint8_t tileMap, uint16_t cell);
+    template<Emulator::Mode mode> void readSpritesToDraw();
     void checkForSTATInterrupt();
 
+    Emulator* m_emulator;
     CPU* m_cpu;
     Memory* m_memory;
+    FrameQueue* m_frameQueue;
+
+    // DMG or CGB specializations of the rendering paths, picked once when the ROM is loaded
+    void (LCD::*m_writeScanlineToFrame)();
+    void (LCD::*m_readSpritesToDraw)();
 
-    ResourceHandle m_frameTexture;
-    uint8_t* m_frameTextureData;
+    // Skipped frames keep all timing, STAT and interrupt behaviour but aren't rasterized
+    static const uint32_t sc_cyclesPerFrame = 70224;
+    Emulator::FrameSkipMode m_frameSkipMode = Emulator::FrameSkipMode::Disabled;
+    uint32_t m_framesToSkip = 0;
+    uint32_t m_skippedFramesInARow = 0;
+    uint64_t m_frameCount = 0;
+    uint64_t m_scanlineCount = 0;
+    uint64_t m_renderedFrameCount = 0;
+    uint64_t m_skippedFrameCount = 0;
+    bool m_renderCurrentFrame = true;
+    bool m_isNextFrameRequested = false;
+    std::chrono::steady_clock::time_point m_lastFrameStartTime;
 
-    uint8_t m_priorityMap[160 * 144] = {};
-    uint8_t m_BGColorIndex[160 * 144] = {};
+    double m_timerCounter;
+    uint8_t m_currentLine;
 
+    bool m_isDisplayEnabled = false;
+    bool m_skipNextFrame = false;
+
+    static constexpr uint32_t sc_maxSpritesPerLine = 10;
     struct Sprite
     {
         int spriteY, spriteX, tileIndex, attributes, locationInOAM;
     };
-    std::vector<Sprite> m_spritesToDraw;
+    // Only the first m_numSpritesToDraw are the current line's. Drawing state, so it isn't saved, see loadState().
+    Sprite m_spritesToDraw[sc_maxSpritesPerLine] = {};
+    uint32_t m_numSpritesToDraw = 0;
 
-    double m_timerCounter;
-    uint8_t m_currentLine;
+    // Only the line being drawn needs them
+    uint8_t m_priorityMap[160] = {};
+    uint8_t m_BGColorIndex[160] = {};
 
-    bool m_isDisplayEnabled = false;
-    bool m_skipNextFrame = false;
+    // BG/window pixels of the current line, packed as (BG-to-OAM priority << 7) | (CGB palette << 2) | color index
+    uint8_t m_bgLine[160] = {};
+
+    // Both tile maps pre-rendered in the same packed format as m_bgLine, invalidated per 8x8 cell. Kept last,
+    // so the fields above share cache lines instead of being spread around it.
+    bool m_layerCacheEnabled = true;
+    uint8_t m_layerCacheTileDataSelect = 0xFF;
+    bool m_layerCacheCellDirty[2][32 * 32] = {};
+    uint8_t m_layerCache[2][256 * 256] = {};
 };
\ No newline at end of file
@@ -3,17 +3,21 @@
 #include <Windows.h>
 
 #include <algorithm>
+#include <bit>
 
 #include "Emulator.h"
 #include "CPU.h"
+#include "SaveState.h"
 
-Memory::Memory(uint8_t* cartridge, size_t cartridgeSize)
-    : m_cartridge(cartridge)
+Memory::Memory(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize)
+    : m_emulator(emulator)
+    , m_cartridge(cartridge)
     , m_cartridgeSize(cartridgeSize)
+    , m_romBankMask(std::bit_floor(cartridgeSize / 0x4000) - 1)
 {
     std::memcpy(m_memory, m_cartridge, std::min(0x7FFF, static_cast<int>(m_cartridgeSize)));
 
-    if (!Emulator::isCGBMode())
+    if (!m_emulator->isCGBMode())
     {
         for (uint16_t addr = 0xFF4C; addr <= 0xFF7F; ++addr)
         {
@@ -32,18 +36,33 @@ Memory::~Memory()
 {
 }
 
-void Memory::updateRTC(double deltaTimeSeconds)
+void Memory::syncRTC()
 {
+    uint64_t elapsedCycles = m_emulator->getElapsedCycles();
+    uint64_t cyclesSinceSync = elapsedCycles - m_rtcSyncedCycle;
+    m_rtcSyncedCycle = elapsedCycles;
+
+    // Halted
     if (((m_rtcUpperDayCounter >> 6) & 1) == 1)
     {
         return;
     }
 
-    m_rtcCounter += deltaTimeSeconds;
+    // Elapsed cycles tick at the normal speed clock whatever speed the CPU runs at
+    m_rtcSubsecondCycles += cyclesSinceSync;
+    advanceRTC(m_rtcSubsecondCycles / CPU::s_normalSpeedFrequencyHz);
+    m_rtcSubsecondCycles %= CPU::s_normalSpeedFrequencyHz;
+}
 
-    while (m_rtcCounter >= 1.0)
+void Memory::advanceRTC(uint64_t seconds)
+{
+    if (((m_rtcUpperDayCounter >> 6) & 1) == 1)
+    {
+        return;
+    }
+
+    for (uint64_t i = 0; i < seconds; i++)
     {
-        m_rtcCounter -= 1.0;
         m_rtcSeconds++;
         m_rtcSeconds &= 0x3F;
         if (m_rtcSeconds == 60)
@@ -83,7 +102,7 @@ uint8_t Memory::read(size_t address)
     // Reading from ROM bank
     if (address >= 0x4000 && address <= 0x7FFF)
     {
-        return m_cartridge[(m_currentRomBank * 0x4000) + (address - 0x4000)];
+        return readRomBank(m_currentRomBank, address - 0x4000);
     }
 
     // Reading from Echo RAM
@@ -97,6 +116,9 @@ uint8_t Memory::read(size_t address)
 
 void Memory::write(size_t address, uint8_t value)
 {
+    // ROM can't be written, the mirror of bank 0 in m_memory stays as loaded
+    if (address <= 0x7FFF) return;
+
     handleCGBRegisterWrite(address, value);
     handleCommonMemoryWrite(address, value);
 
@@ -105,6 +127,8 @@ void Memory::write(size_t address, uint8_t value)
 
 void Memory::saveRTCRegistersToFile(std::ofstream& file)
 {
+    syncRTC();
+
     uint64_t timestamp = static_cast<uint64_t>(std::time(nullptr));
     file.write(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
     file.write(reinterpret_cast<char*>(&m_rtcSeconds), sizeof(m_rtcSeconds));
@@ -114,7 +138,7 @@ void Memory::saveRTCRegistersToFile(std::ofstream& file)
     file.write(reinterpret_cast<char*>(&m_rtcUpperDayCounter), sizeof(m_rtcUpperDayCounter));
 }
 
-void Memory::loadRTCRegistersFromFile(std::ifstream& file)
+void Memory::loadRTCRegistersFromFile(std::ifstream& file, bool syncWithWallClock)
 {
     uint64_t timestamp = static_cast<uint64_t>(std::time(nullptr));
     uint64_t savedTimestamp;
@@ -125,9 +149,113 @@ void Memory::loadRTCRegistersFromFile(std::ifstream& file)
     file.read(reinterpret_cast<char*>(&m_rtcLowerDayCounter), sizeof(m_rtcLowerDayCounter));
     file.read(reinterpret_cast<char*>(&m_rtcUpperDayCounter), sizeof(m_rtcUpperDayCounter));
 
-    if (timestamp > savedTimestamp)
+    m_rtcSyncedCycle = m_emulator->getElapsedCycles();
+    m_rtcSubsecondCycles = 0;
+    if (syncWithWallClock && timestamp > savedTimestamp)
+    {
+        advanceRTC(timestamp - savedTimestamp);
+    }
+}
+
+void Memory::saveState(SaveStateWriter& writer) const
+{
+    // Below 0xA000 m_memory only mirrors the ROM and the rest of the VRAM, switchable WRAM and echo RAM reads go
+    // through their own arrays
+    writer.writeBytes(&m_memory[0xA000], 0xD000 - 0xA000);
+    writer.writeBytes(&m_memory[0xFE00], 0x10000 - 0xFE00);
+    writer.write(m_currentRomBank);
+
+    writer.write(m_rtcSyncedCycle);
+    writer.write(m_rtcSubsecondCycles);
+    writer.write(m_rtcSeconds);
+    writer.write(m_rtcMinutes);
+    writer.write(m_rtcHours);
+    writer.write(m_rtcLowerDayCounter);
+    writer.write(m_rtcUpperDayCounter);
+    writer.write(m_latch);
+    writer.write(m_latchedRtcSeconds);
+    writer.write(m_latchedRtcMinutes);
+    writer.write(m_latchedRtcHours);
+    writer.write(m_latchedRtcLowerDayCounter);
+    writer.write(m_latchedRtcUpperDayCounter);
+
+    writer.write(m_currentVramBank);
+    writer.writeBytes(m_vramBanks, sizeof(m_vramBanks));
+    writer.write(m_hblankDMAInProgress);
+    writer.write(m_hblankDMASourceAddress);
+    writer.write(m_hblankDMADestAddress);
+    writer.write(m_numBytesToCopyForDMATransfer);
+    writer.write(m_currentWramBank);
+    writer.writeBytes(m_wramBanks, sizeof(m_wramBanks));
+    writer.writeBytes(m_BGColorPaletteRam, sizeof(m_BGColorPaletteRam));
+    writer.writeBytes(m_OBJColorPaletteRam, sizeof(m_OBJColorPaletteRam));
+}
+
+void Memory::loadState(SaveStateReader& reader)
+{
+    reader.readBytes(&m_memory[0xA000], 0xD000 - 0xA000);
+    reader.readBytes(&m_memory[0xFE00], 0x10000 - 0xFE00);
+    reader.read(m_currentRomBank);
+
+    reader.read(m_rtcSyncedCycle);
+    reader.read(m_rtcSubsecondCycles);
+    reader.read(m_rtcSeconds);
+    reader.read(m_rtcMinutes);
+    reader.read(m_rtcHours);
+    reader.read(m_rtcLowerDayCounter);
+    reader.read(m_rtcUpperDayCounter);
+    reader.read(m_latch);
+    reader.read(m_latchedRtcSeconds);
+    reader.read(m_latchedRtcMinutes);
+    reader.read(m_latchedRtcHours);
+    reader.read(m_latchedRtcLowerDayCounter);
+    reader.read(m_latchedRtcUpperDayCounter);
+
+    reader.read(m_currentVramBank);
+    uint8_t previousVramBanks[sizeof(m_vramBanks)];
+    std::memcpy(previousVramBanks, m_vramBanks, sizeof(m_vramBanks));
+    reader.readBytes(m_vramBanks, sizeof(m_vramBanks));
+    markChangedVramDirty(previousVramBanks);
+    reader.read(m_hblankDMAInProgress);
+    reader.read(m_hblankDMASourceAddress);
+    reader.read(m_hblankDMADestAddress);
+    reader.read(m_numBytesToCopyForDMATransfer);
+    reader.read(m_currentWramBank);
+    reader.readBytes(m_wramBanks, sizeof(m_wramBanks));
+    reader.readBytes(m_BGColorPaletteRam, sizeof(m_BGColorPaletteRam));
+    reader.readBytes(m_OBJColorPaletteRam, sizeof(m_OBJColorPaletteRam));
+
+    // A corrupt or crafted state mustn't index past the banks. ROM banks wrap in readRomBank() anyway, the DMA
+    // addresses stay 16-byte aligned like the transfers keep them, so a block never runs past 0xFFFF.
+    m_currentVramBank &= 1;
+    m_currentWramBank = std::max<uint8_t>(m_currentWramBank & 0x7, 1);
+    m_hblankDMASourceAddress &= 0xFFF0;
+    m_hblankDMADestAddress &= 0xFFF0;
+}
+
+void Memory::markChangedVramDirty(uint8_t const* previousVramBanks)
+{
+    // The same as writing every byte that differs, so the LCD's layer cache only redraws what the load changed
+    for (uint32_t bank = 0; bank < 2; bank++)
     {
-        updateRTC(static_cast<double>(timestamp - savedTimestamp));
+        uint8_t const* previous = previousVramBanks + bank * 0x2000;
+        uint8_t const* current = m_vramBanks + bank * 0x2000;
+        for (uint32_t tile = 0; tile < 384; tile++)
+        {
+            if (std::memcmp(previous + tile * 16, current + tile * 16, 16) != 0)
+            {
+                m_tileDataDirty[bank][tile] = true;
+                m_anyTileDataDirty = true;
+            }
+        }
+        for (uint32_t i = 0; i < 0x800; i++)
+        {
+            if (previous[0x1800 + i] != current[0x1800 + i])
+            {
+                m_tileMapDirty[i] = true;
+                m_anyTileMapDirty = true;
+            }
+        }
     }
 }
 
@@ -138,7 +266,7 @@ uint8_t Memory::readFromVramBank(size_t address, uint8_t bank)
 
 void Memory::performHBlankDMATransfer()
 {
-    if (Emulator::isCGBMode() && m_hblankDMAInProgress && m_numBytesToCopyForDMATransfer > 0)
+    if (m_emulator->isCGBMode() && m_hblankDMAInProgress && m_numBytesToCopyForDMATransfer > 0)
     {
         uint16_t numBytes = std::min((int)m_numBytesToCopyForDMATransfer, 0x10);
         for (uint16_t i = 0; i < numBytes; ++i)
@@ -148,6 +276,7 @@ void Memory::performHBlankDMATransfer()
         m_hblankDMASourceAddress += numBytes;
         m_hblankDMADestAddress += numBytes;
         m_numBytesToCopyForDMATransfer -= numBytes;
+        m_hblankDMAInProgress = m_numBytesToCopyForDMATransfer > 0;
     }
 }
 
@@ -175,14 +304,14 @@ uint8_t Memory::handleCommonMemoryRead(size_t address)
         address -= 0x2000;
     }
 
-    if (address >= 0xFF4C && address <= 0xFF7F && !Emulator::isCGBMode())
+    if (address >= 0xFF4C && address <= 0xFF7F && !m_emulator->isCGBMode())
     {
         return 0xFF;
     }
 
     if (address == 0xFF4D)
     {
-        uint8_t currentSpeed = CPU::isDoubleSpeedMode() ? 0x80 : 0;
+        uint8_t currentSpeed = m_emulator->isDoubleSpeedMode() ? 0x80 : 0;
         return (m_memory[0xFF4D] & 0x7F) | currentSpeed;
     }
 
@@ -226,7 +355,22 @@ void Memory::handleCommonMemoryWrite(size_t address, uint8_t value)
     // Writing to VRAM
     if (address >= 0x8000 && address <= 0x9FFF)
     {
-        m_vramBanks[(m_currentVramBank * 0x2000) + (address - 0x8000)] = value;
+        uint8_t& vramByte = m_vramBanks[(m_currentVramBank * 0x2000) + (address - 0x8000)];
+        if (vramByte != value)
+        {
+            uint16_t vramOffset = static_cast<uint16_t>(address - 0x8000);
+            if (vramOffset < 0x1800)
+            {
+                m_tileDataDirty[m_currentVramBank][vramOffset >> 4] = true;
+                m_anyTileDataDirty = true;
+            }
+            else
+            {
+                m_tileMapDirty[vramOffset - 0x1800] = true;
+                m_anyTileMapDirty = true;
+            }
+        }
+        vramByte = value;
     }
 
     // Writing to WRAM bank
@@ -289,7 +433,11 @@ void Memory::handleCommonMemoryWrite(size_t address, uint8_t value)
 
 void Memory::handleCGBRegisterWrite(size_t address, uint8_t value)
 {
-    if (!Emulator::isCGBMode())
+    // Every write lands here, so reject anything outside the CGB register range before looking at the mode
+    if (address < 0xFF4D || address > 0xFF70)
+        return;
+
+    if (!m_emulator->isCGBMode())
         return;
 
     if (address == 0xFF4D)
@@ -370,8 +518,8 @@ void Memory::handleCGBRegisterWrite(size_t address, uint8_t value)
 
 }
 
-MBC1::MBC1(uint8_t* cartridge, size_t cartridgeSize)
-    : Memory(cartridge, cartridgeSize)
+MBC1::MBC1(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize)
+    : Memory(emulator, cartridge, cartridgeSize)
 {
 }
 
@@ -386,7 +534,7 @@ uint8_t MBC1::read(size_t address)
     {
         if (m_currentBankingMode == 1)
         {
-            return m_cartridge[(m_currentRomBank * 0x4000) + address];
+            return readRomBank(m_currentRomBank, address);
         }
     }
 
@@ -395,10 +543,10 @@ uint8_t MBC1::read(size_t address)
     {
         if (m_currentBankingMode == 0 && (m_currentRomBank & 0x1F) == 0)
         {
-            return m_cartridge[((m_currentRomBank + 1) * 0x4000) + (address - 0x4000)];
+            return readRomBank(m_currentRomBank + 1, address - 0x4000);
         }
 
-        return m_cartridge[(m_currentRomBank * 0x4000) + (address - 0x4000)];
+        return readRomBank(m_currentRomBank, address - 0x4000);
     }
 
     // Reading from RAM bank
@@ -436,6 +584,7 @@ void MBC1::write(size_t address, uint8_t value)
     {
         uint8_t selectedRomBank = (value & 0x1F);
         m_currentRomBank = (m_currentRomBank & 0xE0) | selectedRomBank;
+        m_bankSwitchCount++;
         return;
     }
 
@@ -444,6 +593,7 @@ void MBC1::write(size_t address, uint8_t value)
     {
         m_currentRamBank = (value & 0x03);
         m_currentRomBank = (m_currentRomBank & 0x1F) | uint16_t(value & 0x03) << 5;
+        m_bankSwitchCount++;
         return;
     }
 
@@ -470,6 +620,15 @@ void MBC1::write(size_t address, uint8_t value)
     m_memory[address] = value;
 }
 
+uint16_t MBC1::getCurrentRomBank() const
+{
+    if (m_currentBankingMode == 0 && (m_currentRomBank & 0x1F) == 0)
+    {
+        return m_currentRomBank + 1;
+    }
+    return m_currentRomBank;
+}
+
 void MBC1::saveRamBanksToFile(std::ofstream& file)
 {
     file.write(reinterpret_cast<char*>(m_ramBanks), 0x8000);
@@ -484,8 +643,31 @@ void MBC1::loadRamBanksFromFile(std::ifstream& file)
     m_ramBanksDirty = false;
 }
 
-MBC2::MBC2(uint8_t* cartridge, size_t cartridgeSize)
-    : Memory(cartridge, cartridgeSize)
+void MBC1::saveState(SaveStateWriter& writer) const
+{
+    Memory::saveState(writer);
+    writer.write(m_ramEnabled);
+    writer.write(m_currentBankingMode);
+    writer.write(m_currentRomBank);
+    writer.write(m_currentRamBank);
+    writer.writeBytes(m_ramBanks, sizeof(m_ramBanks));
+}
+
+void MBC1::loadState(SaveStateReader& reader)
+{
+    Memory::loadState(reader);
+    reader.read(m_ramEnabled);
+    reader.read(m_currentBankingMode);
+    reader.read(m_currentRomBank);
+    reader.read(m_currentRamBank);
+    reader.readBytes(m_ramBanks, sizeof(m_ramBanks));
+
+    m_currentBankingMode &= 1;
+    m_currentRamBank &= 0x03;
+}
+
+MBC2::MBC2(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize)
+    : Memory(emulator, cartridge, cartridgeSize)
 {
 }
 
@@ -498,7 +680,7 @@ uint8_t MBC2::read(size_t address)
     // Reading from ROM bank #
     if (address >= 0x4000 && address <= 0x7FFF)
     {
-        return m_cartridge[(m_currentRomBank * 0x4000) + (address - 0x4000)];
+        return readRomBank(m_currentRomBank, address - 0x4000);
     }
 
     // Reading from RAM bank
@@ -536,6 +718,7 @@ void MBC2::write(size_t address, uint8_t value)
             selectedRomBank++;
         }
         m_currentRomBank = (m_currentRomBank & 0xF0) | selectedRomBank;
+        m_bankSwitchCount++;
         return;
     }
 
@@ -552,7 +735,7 @@ void MBC2::write(size_t address, uint8_t value)
     handleCGBRegisterWrite(address, value);
     handleCommonMemoryWrite(address, value);
 
-    m_memory[address] = (value & 0x0F);
+    m_memory[address] = value;
 }
 
 void MBC2::saveRamBanksToFile(std::ofstream& file)
@@ -569,8 +752,22 @@ void MBC2::loadRamBanksFromFile(std::ifstream& file)
     m_ramBanksDirty = false;
 }
 
-MBC3::MBC3(uint8_t* cartridge, size_t cartridgeSize)
-    : Memory(cartridge, cartridgeSize)
+void MBC2::saveState(SaveStateWriter& writer) const
+{
+    Memory::saveState(writer);
+    writer.write(m_currentRomBank);
+    writer.write(m_enableRam);
+}
+
+void MBC2::loadState(SaveStateReader& reader)
+{
+    Memory::loadState(reader);
+    reader.read(m_currentRomBank);
+    reader.read(m_enableRam);
+}
+
+MBC3::MBC3(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize)
+    : Memory(emulator, cartridge, cartridgeSize)
 {
 }
 
@@ -583,7 +780,7 @@ uint8_t MBC3::read(size_t address)
     // Reading from ROM bank
     if (address >= 0x4000 && address <= 0x7FFF)
     {
-        return m_cartridge[(m_currentRomBank * 0x4000) + (address - 0x4000)];
+        return readRomBank(m_currentRomBank, address - 0x4000);
     }
 
     // Reading from RAM bank or RTC registers
@@ -678,6 +875,7 @@ void MBC3::write(size_t address, uint8_t value)
             selectedRomBank++;
         }
         m_currentRomBank = selectedRomBank;
+        m_bankSwitchCount++;
         return;
     }
 
@@ -685,6 +883,7 @@ void MBC3::write(size_t address, uint8_t value)
     if (address >= 0x4000 && address <= 0x5FFF)
     {
         m_currentRamBank = (value & 0x0F);
+        m_bankSwitchCount++;
         return;
     }
 
@@ -693,6 +892,7 @@ void MBC3::write(size_t address, uint8_t value)
     {
         if (value == 1 && m_latch == 0)
         {
+            syncRTC();
             m_latchedRtcSeconds = m_rtcSeconds;
             m_latchedRtcMinutes = m_rtcMinutes;
             m_latchedRtcHours = m_rtcHours;
@@ -706,6 +906,12 @@ void MBC3::write(size_t address, uint8_t value)
     // Writing to RAM bank
     if (address >= 0xA000 && address <= 0xBFFF && m_enableRam)
     {
+        // Time up to the write counts with the old values
+        if (m_currentRamBank >= 0x08 && m_currentRamBank <= 0x0C)
+        {
+            syncRTC();
+        }
+
         switch (m_currentRamBank)
         {
         case 0:
@@ -722,6 +928,7 @@ void MBC3::write(size_t address, uint8_t value)
             break;
         case 0x08:
             m_rtcSeconds = value & 0x3F;
+            m_rtcSubsecondCycles = 0; // Writing the seconds restarts the current second
             break;
         case 0x09:
             m_rtcMinutes = value & 0x3F;
@@ -771,8 +978,32 @@ void MBC3::loadRamBanksFromFile(std::ifstream& file)
     m_ramBanksDirty = false;
 }
 
-MBC5::MBC5(uint8_t* cartridge, size_t cartridgeSize)
-    : Memory(cartridge, cartridgeSize)
+void MBC3::saveState(SaveStateWriter& writer) const
+{
+    Memory::saveState(writer);
+    writer.write(m_currentRomBank);
+    writer.write(m_currentRamBank);
+    writer.writeBytes(m_ramBank0, sizeof(m_ramBank0));
+    writer.writeBytes(m_ramBank1, sizeof(m_ramBank1));
+    writer.writeBytes(m_ramBank2, sizeof(m_ramBank2));
+    writer.writeBytes(m_ramBank3, sizeof(m_ramBank3));
+    writer.write(m_enableRam);
+}
+
+void MBC3::loadState(SaveStateReader& reader)
+{
+    Memory::loadState(reader);
+    reader.read(m_currentRomBank);
+    reader.read(m_currentRamBank);
+    reader.readBytes(m_ramBank0, sizeof(m_ramBank0));
+    reader.readBytes(m_ramBank1, sizeof(m_ramBank1));
+    reader.readBytes(m_ramBank2, sizeof(m_ramBank2));
+    reader.readBytes(m_ramBank3, sizeof(m_ramBank3));
+    reader.read(m_enableRam);
+}
+
+MBC5::MBC5(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize)
+    : Memory(emulator, cartridge, cartridgeSize)
 {
 }
 
@@ -785,7 +1016,7 @@ uint8_t MBC5::read(size_t address)
     // Reading from ROM bank
     if (address >= 0x4000 && address <= 0x7FFF)
     {
-        return m_cartridge[(m_currentRomBank * 0x4000) + (address - 0x4000)];
+        return readRomBank(m_currentRomBank, address - 0x4000);
     }
 
     // Reading from RAM bank
@@ -823,6 +1054,7 @@ void MBC5::write(size_t address, uint8_t value)
     {
         uint8_t selectedRomBank = (value & 0xFF);
         m_currentRomBank = (m_currentRomBank & 0xFF00) | selectedRomBank;
+        m_bankSwitchCount++;
         return;
     }
 
@@ -831,6 +1063,7 @@ void MBC5::write(size_t address, uint8_t value)
     {
         uint16_t selectedRomBank = (value & 1) << 8;
         m_currentRomBank = (m_currentRomBank & 0x00FF) | selectedRomBank;
+        m_bankSwitchCount++;
         return;
     }
 
@@ -838,6 +1071,7 @@ void MBC5::write(size_t address, uint8_t value)
     if (address >= 0x4000 && address <= 0x5FFF)
     {
         m_currentRamBank = (value & 0x0F);
+        m_bankSwitchCount++;
         return;
     }
 
@@ -869,4 +1103,24 @@ void MBC5::loadRamBanksFromFile(std::ifstream& file)
     file.read(reinterpret_cast<char*>(m_ramBanks), 0x20000);
 
     m_ramBanksDirty = false;
+}
+
+void MBC5::saveState(SaveStateWriter& writer) const
+{
+    Memory::saveState(writer);
+    writer.write(m_currentRomBank);
+    writer.write(m_currentRamBank);
+    writer.writeBytes(m_ramBanks, sizeof(m_ramBanks));
+    writer.write(m_enableRam);
+}
+
+void MBC5::loadState(SaveStateReader& reader)
+{
+    Memory::loadState(reader);
+    reader.read(m_currentRomBank);
+    reader.read(m_currentRamBank);
+    reader.readBytes(m_ramBanks, sizeof(m_ramBanks));
+    reader.read(m_enableRam);
+
+    m_currentRamBank &= 0x0F;
 }
\ No newline at end of file
@@ -20,23 +20,40 @@
  FFFFh          IE      Interrupt enable flags
 */
 
+class Emulator;
+class SaveStateWriter;
+class SaveStateReader;
+
 class Memory
 {
 public:
-    Memory(uint8_t* cartridge, size_t cartridgeSize);
-    ~Memory();
+    // cartridgeSize is a power of two of at least two banks, see Emulator::allocateCartridge()
+    Memory(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize);
+    virtual ~Memory();
 
-    void updateRTC(double deltaTimeSeconds);
+    // The RTC is derived from emulated cycles and only brought up to date when the game latches or writes it and
+    // before it's saved, so it runs at emulated speed (also in turbo) and replays exactly
+    void syncRTC();
 
     virtual uint8_t read(size_t address);
     virtual void write(size_t address, uint8_t value);
 
     bool areRamBanksDirty() const { return m_ramBanksDirty; }
+    // Writes to ROM or RAM bank registers since the memory was created, not part of save states
+    uint64_t getBankSwitchCount() const { return m_bankSwitchCount; }
+    void setBankSwitchCount(uint64_t count) { m_bankSwitchCount = count; }
+    // The ROM bank mapped to 0x4000-0x7FFF
+    virtual uint16_t getCurrentRomBank() const { return m_currentRomBank; }
     virtual void saveRamBanksToFile(std::ofstream& file) {};
     virtual void loadRamBanksFromFile(std::ifstream& file) {};
 
     void saveRTCRegistersToFile(std::ofstream& file);
-    void loadRTCRegistersFromFile(std::ifstream& file);
+    // Advances the clock by the wall-clock time since the file was saved when asked to, like a real cartridge's
+    // battery-powered clock keeps running while the game is off
+    void loadRTCRegistersFromFile(std::ifstream& file, bool syncWithWallClock);
+
+    virtual void saveState(SaveStateWriter& writer) const;
+    virtual void loadState(SaveStateReader& reader);
 
     uint8_t readFromVramBank(size_t address, uint8_t bank);
     void performHBlankDMATransfer();
@@ -47,18 +64,27 @@ protected:
     uint8_t handleCommonMemoryRead(size_t address);
     void handleCommonMemoryWrite(size_t address, uint8_t value);
     void handleCGBRegisterWrite(size_t address, uint8_t value);
+    void markChangedVramDirty(uint8_t const* previousVramBanks);
+    // Bank numbers past the end of the ROM wrap around, like the cartridge only decodes the bank bits it has
+    uint8_t readRomBank(size_t bank, size_t offset) const { return m_cartridge[(bank & m_romBankMask) * 0x4000 + offset]; }
+
+    Emulator* m_emulator;
 
     uint8_t* m_cartridge;
     size_t m_cartridgeSize;
+    size_t m_romBankMask;
 
     uint8_t m_memory[0x10000] = {};
 
     uint16_t m_currentRomBank = 1;
 
     bool m_ramBanksDirty = false;
+    uint64_t m_bankSwitchCount = 0;
 
-    static const uint64_t RTCFrequencyHz = 32768 * 1024;
-    double m_rtcCounter = 0;
+    void advanceRTC(uint64_t seconds);
+
+    uint64_t m_rtcSyncedCycle = 0;          // Emulator::getElapsedCycles() the registers are up to date with
+    uint64_t m_rtcSubsecondCycles = 0;
     uint8_t m_rtcSeconds = 0;
     uint8_t m_rtcMinutes = 0;
     uint8_t m_rtcHours = 0;
@@ -86,20 +112,30 @@ protected:
 
     uint16_t m_BGColorPaletteRam[32] = {};
     uint16_t m_OBJColorPaletteRam[32] = {};
+
+    // VRAM dirty tracking for the LCD layer cache, cleared by the LCD when it consumes it
+    bool m_tileDataDirty[2][384] = {};
+    bool m_tileMapDirty[0x800] = {};
+    bool m_anyTileDataDirty = false;
+    bool m_anyTileMapDirty = false;
 };
 
 class MBC1 : public Memory
 {
 public:
-    MBC1(uint8_t* cartridge, size_t cartridgeSize);
+    MBC1(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize);
     ~MBC1();
 
     virtual uint8_t read(size_t address) override;
     virtual void write(size_t address, uint8_t value) override;
+    virtual uint16_t getCurrentRomBank() const override;
 
     virtual void saveRamBanksToFile(std::ofstream& file) override;
     virtual void loadRamBanksFromFile(std::ifstream& file) override;
 
+    virtual void saveState(SaveStateWriter& writer) const override;
+    virtual void loadState(SaveStateReader& reader) override;
+
 private:
     bool m_ramEnabled = false;
 
@@ -114,15 +150,19 @@ private:
 class MBC2 : public Memory
 {
 public:
-    MBC2(uint8_t* cartridge, size_t cartridgeSize);
+    MBC2(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize);
     ~MBC2();
 
     virtual uint8_t read(size_t address) override;
     virtual void write(size_t address, uint8_t value) override;
+    virtual uint16_t getCurrentRomBank() const override { return m_currentRomBank; }
 
     virtual void saveRamBanksToFile(std::ofstream& file) override;
     virtual void loadRamBanksFromFile(std::ifstream& file) override;
 
+    virtual void saveState(SaveStateWriter& writer) const override;
+    virtual void loadState(SaveStateReader& reader) override;
+
 private:
     uint16_t m_currentRomBank = 1;
     bool m_enableRam = true;
@@ -131,15 +171,19 @@ private:
 class MBC3 : public Memory
 {
 public:
-    MBC3(uint8_t* cartridge, size_t cartridgeSize);
+    MBC3(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize);
     ~MBC3();
 
     virtual uint8_t read(size_t address) override;
     virtual void write(size_t address, uint8_t value) override;
+    virtual uint16_t getCurrentRomBank() const override { return m_currentRomBank; }
 
     virtual void saveRamBanksToFile(std::ofstream& file) override;
     virtual void loadRamBanksFromFile(std::ifstream& file) override;
 
+    virtual void saveState(SaveStateWriter& writer) const override;
+    virtual void loadState(SaveStateReader& reader) override;
+
 private:
     uint8_t m_currentRomBank = 0;
 
@@ -155,15 +199,19 @@ private:
 class MBC5 : public Memory
 {
 public:
-    MBC5(uint8_t* cartridge, size_t cartridgeSize);
+    MBC5(Emulator* emulator, uint8_t* cartridge, size_t cartridgeSize);
     ~MBC5();
 
     virtual uint8_t read(size_t address) override;
     virtual void write(size_t address, uint8_t value) override;
+    virtual uint16_t getCurrentRomBank() const override { return m_currentRomBank; }
 
     virtual void saveRamBanksToFile(std::ofstream& file) override;
     virtual void loadRamBanksFromFile(std::ifstream& file) override;
 
+    virtual void saveState(SaveStateWriter& writer) const override;
+    virtual void loadState(SaveStateReader& reader) override;
+
 private:
     uint16_t m_currentRomBank = 0;
 
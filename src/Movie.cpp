@@ -0,0 +1,206 @@
+#include "Movie.h"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+
+#include "Emulator.h"
+#include "SaveState.h"
+
+bool Movie::saveToFile(char const* filename) const
+{
+    auto writeMovie = [this](SaveStateWriter& writer)
+    {
+        writer.write(sc_movieMagic);
+        writer.write(sc_movieVersion);
+        writer.write(m_numFrames);
+        writer.write(m_endCycle);
+        writer.write(static_cast<uint64_t>(m_initialState.size()));
+        writer.writeBytes(m_initialState.data(), m_initialState.size());
+        writer.write(static_cast<uint32_t>(m_inputEvents.size()));
+        for (InputEvent const& inputEvent : m_inputEvents)
+        {
+            writer.write(inputEvent.m_cycle);
+            writer.write(inputEvent.m_buttonMask);
+        }
+        writer.write(static_cast<uint32_t>(m_stateHashes.size()));
+        for (StateHash const& stateHash : m_stateHashes)
+        {
+            writer.write(stateHash.m_cycle);
+            writer.write(stateHash.m_hash);
+        }
+    };
+
+    SaveStateWriter sizeWriter(nullptr, 0);
+    writeMovie(sizeWriter);
+    std::vector<uint8_t> data(sizeWriter.getSize());
+    SaveStateWriter writer(data.data(), data.size());
+    writeMovie(writer);
+
+    std::ofstream file(filename, std::fstream::out | std::fstream::binary | std::fstream::trunc);
+    file.write(reinterpret_cast<char const*>(data.data()), data.size());
+    return file.good();
+}
+
+bool Movie::loadFromFile(char const* filename)
+{
+    if (!std::filesystem::exists(filename)) return false;
+
+    std::vector<uint8_t> data(std::filesystem::file_size(filename));
+    std::ifstream file(filename, std::fstream::in | std::fstream::binary);
+    file.read(reinterpret_cast<char*>(data.data()), data.size());
+    if (!file.good())
+    {
+        return false;
+    }
+
+    SaveStateReader reader(data.data(), data.size());
+    if (reader.read<uint32_t>() != sc_movieMagic || reader.read<uint32_t>() != sc_movieVersion)
+    {
+        return false;
+    }
+
+    Movie movie;
+    reader.read(movie.m_numFrames);
+    reader.read(movie.m_endCycle);
+
+    // Sizes are checked against what's left so a broken file can't ask for a huge allocation
+    uint64_t stateSize = reader.read<uint64_t>();
+    if (reader.hasFailed() || stateSize > data.size() - reader.getPosition()) return false;
+    movie.m_initialState.resize(stateSize);
+    reader.readBytes(movie.m_initialState.data(), stateSize);
+
+    uint32_t numInputEvents = reader.read<uint32_t>();
+    if (reader.hasFailed() || numInputEvents > (data.size() - reader.getPosition()) / 9) return false;
+    movie.m_inputEvents.resize(numInputEvents);
+    for (InputEvent& inputEvent : movie.m_inputEvents)
+    {
+        reader.read(inputEvent.m_cycle);
+        reader.read(inputEvent.m_buttonMask);
+    }
+
+    uint32_t numStateHashes = reader.read<uint32_t>();
+    if (reader.hasFailed() || numStateHashes > (data.size() - reader.getPosition()) / 16) return false;
+    movie.m_stateHashes.resize(numStateHashes);
+    for (StateHash& stateHash : movie.m_stateHashes)
+    {
+        reader.read(stateHash.m_cycle);
+        reader.read(stateHash.m_hash);
+    }
+
+    if (reader.hasFailed())
+    {
+        return false;
+    }
+    *this = std::move(movie);
+    return true;
+}
+
+MovieRecorder::MovieRecorder(uint32_t framesPerStateHash)
+    : m_framesPerStateHash(std::max(framesPerStateHash, 1u))
+{
+}
+
+bool MovieRecorder::start(Emulator& emulator)
+{
+    m_movie = Movie();
+
+    size_t stateSize = emulator.getStateSize();
+    if (stateSize == 0) return false;
+    m_movie.m_initialState.resize(stateSize);
+    emulator.saveState(m_movie.m_initialState.data(), stateSize);
+
+    uint64_t cycle = emulator.getElapsedCycles();
+    m_buttonMask = emulator.getPressedButtons();
+    m_movie.m_stateHashes.push_back({ cycle, emulator.computeStateHash() });
+    m_movie.m_endCycle = cycle;
+    return true;
+}
+
+void MovieRecorder::onFrameBoundary(Emulator& emulator, uint8_t buttonMask)
+{
+    uint64_t cycle = emulator.getElapsedCycles();
+    m_movie.m_numFrames++;
+    m_movie.m_endCycle = cycle;
+
+    if (buttonMask != m_buttonMask)
+    {
+        m_movie.m_inputEvents.push_back({ cycle, buttonMask });
+        m_buttonMask = buttonMask;
+    }
+    if (m_movie.m_numFrames % m_framesPerStateHash == 0)
+    {
+        m_movie.m_stateHashes.push_back({ cycle, emulator.computeStateHash() });
+    }
+}
+
+bool MoviePlayer::start(Emulator& emulator, Movie const* movie)
+{
+    m_movie = movie;
+    m_nextInputEvent = 0;
+    m_nextStateHash = 0;
+    m_desyncCycle = 0;
+    m_status = Status::Finished;
+
+    if (!emulator.loadState(movie->m_initialState.data(), movie->m_initialState.size()))
+    {
+        return false;
+    }
+    m_status = Status::Playing;
+    return true;
+}
+
+MoviePlayer::Status MoviePlayer::runFrame(Emulator& emulator)
+{
+    // Input changes and hashes fall on instruction boundaries the recording went through, a replay that's still
+    // in sync lands on exactly the same cycles when it stops right before them
+    auto catchUp = [this, &emulator]()
+    {
+        uint64_t cycle = emulator.getElapsedCycles();
+        while (m_nextInputEvent < m_movie->m_inputEvents.size() && m_movie->m_inputEvents[m_nextInputEvent].m_cycle <= cycle)
+        {
+            Movie::InputEvent const& inputEvent = m_movie->m_inputEvents[m_nextInputEvent++];
+            if (inputEvent.m_cycle < cycle)
+            {
+                m_status = Status::Desynced;
+                m_desyncCycle = inputEvent.m_cycle;
+                return;
+            }
+            emulator.setPressedButtons(inputEvent.m_buttonMask);
+        }
+        while (m_nextStateHash < m_movie->m_stateHashes.size() && m_movie->m_stateHashes[m_nextStateHash].m_cycle <= cycle)
+        {
+            Movie::StateHash const& stateHash = m_movie->m_stateHashes[m_nextStateHash++];
+            if (stateHash.m_cycle < cycle || stateHash.m_hash != emulator.computeStateHash())
+            {
+                m_status = Status::Desynced;
+                m_desyncCycle = stateHash.m_cycle;
+                return;
+            }
+        }
+        if (cycle >= m_movie->m_endCycle)
+        {
+            m_status = Status::Finished;
+        }
+    };
+
+    if (m_status != Status::Playing) return m_status;
+    catchUp();
+    if (m_status != Status::Playing) return m_status;
+
+    uint64_t cycle = emulator.getElapsedCycles();
+    uint64_t maxCycles = Emulator::sc_cyclesPerFrame;
+    maxCycles = std::min(maxCycles, m_movie->m_endCycle - cycle);
+    if (m_nextInputEvent < m_movie->m_inputEvents.size())
+    {
+        maxCycles = std::min(maxCycles, m_movie->m_inputEvents[m_nextInputEvent].m_cycle - cycle);
+    }
+    if (m_nextStateHash < m_movie->m_stateHashes.size())
+    {
+        maxCycles = std::min(maxCycles, m_movie->m_stateHashes[m_nextStateHash].m_cycle - cycle);
+    }
+    emulator.runFrame(maxCycles);
+
+    catchUp();
+    return m_status;
+}
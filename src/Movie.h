@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class Emulator;
+
+// Input recording that replays bit-exactly. A movie starts from a save state and lists every change of the
+// pressed buttons with the emulated cycle it happened at, plus a hash of the machine state every few frames
+// so a replay notices the moment it stops doing what the recording did.
+struct Movie
+{
+    struct InputEvent
+    {
+        uint64_t m_cycle;       // Emulator::getElapsedCycles() when the buttons changed
+        uint8_t m_buttonMask;   // Bit i set when Joypad::Button i is held
+    };
+
+    struct StateHash
+    {
+        uint64_t m_cycle;
+        uint64_t m_hash;        // Emulator::computeStateHash()
+    };
+
+    std::vector<uint8_t> m_initialState;
+    std::vector<InputEvent> m_inputEvents;  // Sorted by cycle
+    std::vector<StateHash> m_stateHashes;   // Sorted by cycle
+    uint64_t m_endCycle = 0;
+    uint32_t m_numFrames = 0;
+
+    bool saveToFile(char const* filename) const;
+    bool loadFromFile(char const* filename);
+
+private:
+    static constexpr uint32_t sc_movieMagic = 'G' | ('B' << 8) | ('M' << 16) | ('V' << 24);
+    static constexpr uint32_t sc_movieVersion = 1;
+};
+
+class MovieRecorder
+{
+public:
+    MovieRecorder(uint32_t framesPerStateHash = 60);
+
+    // Call at a frame boundary, recording begins from the emulator's current state
+    bool start(Emulator& emulator);
+    // Call at every frame boundary with the buttons the game sees from there on
+    void onFrameBoundary(Emulator& emulator, uint8_t buttonMask);
+    Movie const& getMovie() const { return m_movie; }
+
+private:
+    Movie m_movie;
+    uint32_t m_framesPerStateHash;
+    uint8_t m_buttonMask = 0;
+};
+
+class MoviePlayer
+{
+public:
+    enum class Status
+    {
+        Playing,
+        Finished,
+        Desynced,   // The state doesn't hash like it did when recording, see getDesyncCycle()
+    };
+
+    // Loads the movie's initial state, which fails if the emulator has another ROM opened
+    bool start(Emulator& emulator, Movie const* movie);
+    // Emulates one frame like Emulator::runFrame(), applying the movie's input and checking its hashes on the way
+    Status runFrame(Emulator& emulator);
+    Status getStatus() const { return m_status; }
+    uint64_t getDesyncCycle() const { return m_desyncCycle; }
+
+private:
+    Movie const* m_movie = nullptr;
+    size_t m_nextInputEvent = 0;
+    size_t m_nextStateHash = 0;
+    Status m_status = Status::Finished;
+    uint64_t m_desyncCycle = 0;
+};
\ No newline at end of file
@@ -0,0 +1,211 @@
+#include "RewindBuffer.h"
+
+#include <chrono>
+#include <cstring>
+
+#include "Emulator.h"
+
+static uint8_t* writeVarint(uint8_t* destination, size_t value)
+{
+    while (value >= 0x80)
+    {
+        *destination++ = static_cast<uint8_t>(value) | 0x80;
+        value >>= 7;
+    }
+    *destination++ = static_cast<uint8_t>(value);
+    return destination;
+}
+
+static uint8_t const* readVarint(uint8_t const* source, size_t& value)
+{
+    value = 0;
+    for (uint32_t shift = 0; ; shift += 7)
+    {
+        uint8_t byte = *source++;
+        value |= static_cast<size_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return source;
+    }
+}
+
+RewindBuffer::RewindBuffer(size_t budgetBytes, uint32_t captureInterval)
+    : m_captureInterval(captureInterval > 0 ? captureInterval : 1)
+    , m_ring(budgetBytes)
+{
+}
+
+void RewindBuffer::onFrameCompleted(Emulator& emulator)
+{
+    if (m_framesUntilCapture > 0)
+    {
+        m_framesUntilCapture--;
+        return;
+    }
+
+    auto captureStart = std::chrono::steady_clock::now();
+
+    size_t stateSize = emulator.getStateSize();
+    if (stateSize == 0) return;
+    if (stateSize != m_newestState.size())
+    {
+        clear();
+        m_newestState.resize(stateSize);
+        m_capturedState.resize(stateSize);
+        // Generous bound for the worst case of short runs alternating all over the state
+        m_compressedDelta.resize(stateSize * 2 + 64);
+    }
+    m_framesUntilCapture = m_captureInterval - 1;
+
+    emulator.saveState(m_capturedState.data(), stateSize);
+    if (m_hasNewestState)
+    {
+        size_t deltaSize = compressDelta(m_capturedState.data(), m_newestState.data(), stateSize, m_compressedDelta.data());
+        pushDelta(m_compressedDelta.data(), deltaSize);
+    }
+    m_newestState.swap(m_capturedState);
+    m_hasNewestState = true;
+
+    double captureMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - captureStart).count();
+    m_averageCaptureMicroseconds += (captureMicroseconds - m_averageCaptureMicroseconds) * 0.05;
+}
+
+bool RewindBuffer::stepBack(Emulator& emulator)
+{
+    if (!m_hasNewestState) return false;
+
+    if (!emulator.loadState(m_newestState.data(), m_newestState.size()))
+    {
+        // Snapshots of another ROM
+        clear();
+        return false;
+    }
+
+    if (!m_deltas.empty())
+    {
+        Delta const& delta = m_deltas.back();
+        applyDelta(&m_ring[delta.m_offset], delta.m_size, m_newestState.data());
+        m_deltaBytes -= delta.m_size;
+        m_writeOffset = delta.m_offset;
+        m_deltas.pop_back();
+    }
+    m_framesUntilCapture = 0;
+    return true;
+}
+
+void RewindBuffer::clear()
+{
+    m_deltas.clear();
+    m_writeOffset = 0;
+    m_deltaBytes = 0;
+    m_hasNewestState = false;
+    m_framesUntilCapture = 0;
+}
+
+RewindBuffer::Stats RewindBuffer::getStats() const
+{
+    Stats stats;
+    stats.m_budgetBytes = m_ring.size();
+    if (m_hasNewestState)
+    {
+        stats.m_numSnapshots = static_cast<uint32_t>(m_deltas.size()) + 1;
+        stats.m_usedBytes = m_deltaBytes + m_newestState.size();
+        stats.m_compressionRatio = static_cast<double>(stats.m_numSnapshots) * m_newestState.size() / stats.m_usedBytes;
+    }
+    stats.m_averageCaptureMicroseconds = m_averageCaptureMicroseconds;
+    return stats;
+}
+
+void RewindBuffer::pushDelta(uint8_t const* delta, size_t deltaSize)
+{
+    if (deltaSize > m_ring.size())
+    {
+        // Doesn't fit at all, older history can't be reached past this snapshot anymore
+        m_deltas.clear();
+        m_writeOffset = 0;
+        m_deltaBytes = 0;
+        return;
+    }
+
+    // Deltas ahead of the write offset are the oldest ones, they go first
+    if (m_writeOffset + deltaSize > m_ring.size())
+    {
+        while (!m_deltas.empty() && m_deltas.front().m_offset >= m_writeOffset)
+        {
+            m_deltaBytes -= m_deltas.front().m_size;
+            m_deltas.pop_front();
+        }
+        m_writeOffset = 0;
+    }
+    while (!m_deltas.empty() && m_deltas.front().m_offset >= m_writeOffset && m_deltas.front().m_offset < m_writeOffset + deltaSize)
+    {
+        m_deltaBytes -= m_deltas.front().m_size;
+        m_deltas.pop_front();
+    }
+
+    std::memcpy(&m_ring[m_writeOffset], delta, deltaSize);
+    m_deltas.push_back({ m_writeOffset, deltaSize });
+    m_writeOffset += deltaSize;
+    m_deltaBytes += deltaSize;
+}
+
+size_t RewindBuffer::compressDelta(uint8_t const* current, uint8_t const* previous, size_t size, uint8_t* destination)
+{
+    // Shorter unchanged stretches stay inside the changed run, a new run costs at least two bytes
+    static const size_t sc_minUnchangedRun = 4;
+
+    uint8_t* output = destination;
+    size_t position = 0;
+    while (position < size)
+    {
+        size_t unchangedStart = position;
+        while (position + 8 <= size)
+        {
+            uint64_t a, b;
+            std::memcpy(&a, current + position, 8);
+            std::memcpy(&b, previous + position, 8);
+            if (a != b) break;
+            position += 8;
+        }
+        while (position < size && current[position] == previous[position])
+        {
+            position++;
+        }
+
+        size_t changedStart = position;
+        size_t unchangedInARow = 0;
+        while (position < size && unchangedInARow < sc_minUnchangedRun)
+        {
+            unchangedInARow = current[position] == previous[position] ? unchangedInARow + 1 : 0;
+            position++;
+        }
+        if (unchangedInARow == sc_minUnchangedRun)
+        {
+            position -= unchangedInARow;
+        }
+
+        output = writeVarint(output, changedStart - unchangedStart);
+        output = writeVarint(output, position - changedStart);
+        for (size_t i = changedStart; i < position; i++)
+        {
+            *output++ = current[i] ^ previous[i];
+        }
+    }
+    return output - destination;
+}
+
+void RewindBuffer::applyDelta(uint8_t const* delta, size_t deltaSize, uint8_t* state)
+{
+    uint8_t const* input = delta;
+    uint8_t const* end = delta + deltaSize;
+    size_t position = 0;
+    while (input < end)
+    {
+        size_t unchangedCount, changedCount;
+        input = readVarint(input, unchangedCount);
+        input = readVarint(input, changedCount);
+        position += unchangedCount;
+        for (size_t i = 0; i < changedCount; i++)
+        {
+            state[position++] ^= *input++;
+        }
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <deque>
+
+class Emulator;
+
+// Rewind history in a fixed memory budget. Only the newest snapshot is kept whole; every older one is stored as the
+// XOR against the snapshot after it, run-length encoded. Most of memory doesn't change from one frame to the next,
+// so the XOR is mostly zeroes and a delta is a few KB. When the budget runs out the oldest deltas are dropped.
+class RewindBuffer
+{
+public:
+    RewindBuffer(size_t budgetBytes, uint32_t captureInterval = 1);
+
+    // Call at frame boundaries, takes a snapshot every captureInterval frames
+    void onFrameCompleted(Emulator& emulator);
+    // Restores the newest snapshot and drops it, so repeated calls walk back in time. The oldest snapshot is kept and
+    // restored again on further calls. Returns false if there's nothing to restore.
+    bool stepBack(Emulator& emulator);
+    void clear();
+
+    struct Stats
+    {
+        size_t m_budgetBytes = 0;
+        size_t m_usedBytes = 0;                 // Deltas plus the newest snapshot
+        uint32_t m_numSnapshots = 0;
+        double m_compressionRatio = 0.0;        // Size of the snapshots uncompressed over m_usedBytes
+        double m_averageCaptureMicroseconds = 0.0;
+    };
+    Stats getStats() const;
+
+private:
+    void pushDelta(uint8_t const* delta, size_t deltaSize);
+
+    // Encodes current ^ previous as (unchanged byte count, changed byte count, changed bytes ^ previous) runs
+    static size_t compressDelta(uint8_t const* current, uint8_t const* previous, size_t size, uint8_t* destination);
+    static void applyDelta(uint8_t const* delta, size_t deltaSize, uint8_t* state);
+
+    struct Delta
+    {
+        size_t m_offset;
+        size_t m_size;
+    };
+
+    uint32_t m_captureInterval;
+    uint32_t m_framesUntilCapture = 0;
+
+    std::vector<uint8_t> m_ring;
+    std::deque<Delta> m_deltas; // Oldest first, each one turns the snapshot after it into its own
+    size_t m_writeOffset = 0;
+    size_t m_deltaBytes = 0;
+
+    std::vector<uint8_t> m_newestState;
+    bool m_hasNewestState = false;
+    std::vector<uint8_t> m_capturedState;
+    std::vector<uint8_t> m_compressedDelta;
+
+    double m_averageCaptureMicroseconds = 0.0;
+};
\ No newline at end of file
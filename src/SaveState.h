@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Flat binary writer for save states in the host's byte order, states only load on hosts with the same one. Writing past the end of the buffer only counts the
+// bytes, so a writer without a buffer measures how large a state is.
+class SaveStateWriter
+{
+public:
+    SaveStateWriter(uint8_t* buffer, size_t capacity)
+        : m_buffer(buffer)
+        , m_capacity(buffer ? capacity : 0)
+    {
+    }
+
+    template<typename T>
+    void write(T const& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        writeBytes(&value, sizeof(T));
+    }
+
+    void writeBytes(void const* data, size_t size)
+    {
+        if (m_size + size <= m_capacity)
+        {
+            std::memcpy(m_buffer + m_size, data, size);
+        }
+        m_size += size;
+    }
+
+    size_t getSize() const { return m_size; }
+    bool hasOverflowed() const { return m_size > m_capacity; }
+
+private:
+    uint8_t* m_buffer;
+    size_t m_capacity;
+    size_t m_size = 0;
+};
+
+class SaveStateReader
+{
+public:
+    SaveStateReader(uint8_t const* data, size_t size)
+        : m_data(data)
+        , m_size(data ? size : 0)
+    {
+    }
+
+    template<typename T>
+    void read(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        readBytes(&value, sizeof(T));
+    }
+
+    template<typename T>
+    T read()
+    {
+        T value = {};
+        read(value);
+        return value;
+    }
+
+    // Reading past the end yields zeroes and marks the reader as failed
+    void readBytes(void* data, size_t size)
+    {
+        if (m_position + size > m_size)
+        {
+            std::memset(data, 0, size);
+            m_hasFailed = true;
+            return;
+        }
+        std::memcpy(data, m_data + m_position, size);
+        m_position += size;
+    }
+
+    size_t getPosition() const { return m_position; }
+    bool hasFailed() const { return m_hasFailed; }
+
+private:
+    uint8_t const* m_data;
+    size_t m_size;
+    size_t m_position = 0;
+    bool m_hasFailed = false;
+};
\ No newline at end of file
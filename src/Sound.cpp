@@ -9,10 +9,16 @@
 #include "Emulator.h"
 #include "Memory.h"
 #include "CPU.h"
+#include "SaveState.h"
+#include "Instrumentation.h"
 
-Sound::Sound(Memory* memory)
-    : m_memory(memory)
+Sound::Sound(Emulator* emulator, Memory* memory, bool enableAudioOutput)
+    : m_emulator(emulator)
+    , m_memory(memory)
+    , m_audioOutputEnabled(enableAudioOutput)
 {
+    if (!m_audioOutputEnabled) return;
+
     SDL_InitSubSystem(SDL_INIT_AUDIO);
     SDL_AudioSpec wantSpec =
     {
@@ -28,6 +34,8 @@ Sound::Sound(Memory* memory)
 
 Sound::~Sound()
 {
+    if (!m_audioOutputEnabled) return;
+
     SDL_PauseAudioDevice(m_audioDevice, 1);
     SDL_CloseAudioDevice(m_audioDevice);
     SDL_QuitSubSystem(SDL_INIT_AUDIO);
@@ -35,6 +43,7 @@ Sound::~Sound()
 
 void Sound::update(uint64_t cyclesToEmulate)
 {
+    INSTRUMENT_ZONE_DETAIL("APU channel update");
     uint8_t NR50 = m_memory->read(0xFF24);
     uint8_t NR51 = m_memory->read(0xFF25);
     uint8_t NR52 = m_memory->read(0xFF26);
@@ -90,7 +99,7 @@ void Sound::update(uint64_t cyclesToEmulate)
         updateFrequencyTimerChannel3();
         updateFrequencyTimerChannel4();
 
-        if (m_sampleClock % ((CPU::s_normalSpeedFrequencyHz / Sound::sc_SampleRate) * Emulator::s_turboModeMultiplier) == 0)
+        if (!m_isOutputMuted && m_sampleClock % ((CPU::s_normalSpeedFrequencyHz / Sound::sc_SampleRate) * m_emulator->getTurboModeMultiplier()) == 0)
         {
             if (soundEnable)
             {
@@ -125,13 +134,29 @@ void Sound::update(uint64_t cyclesToEmulate)
                 m_audioDataBuffer[m_audioDataBufferSampleCount++] = 0.0f;
                 m_audioDataBuffer[m_audioDataBufferSampleCount++] = 0.0f;
             }
+            m_sampleCount++;
+            if (m_sampleCaptureEnabled)
+            {
+                m_capturedSamples.push_back(m_audioDataBuffer[m_audioDataBufferSampleCount - 2]);
+                m_capturedSamples.push_back(m_audioDataBuffer[m_audioDataBufferSampleCount - 1]);
+            }
             if (m_audioDataBufferSampleCount >= sc_AudioDataBufferSize)
             {
-                while (SDL_GetQueuedAudioSize(m_audioDevice) > (2 * sc_AudioDataBufferSize * sizeof(float)))
+                INSTRUMENT_ZONE("Audio sample output");
+                if (m_audioOutputEnabled)
                 {
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    // An empty queue means the device played everything before this buffer was ready
+                    if (m_hasQueuedAudio && SDL_GetQueuedAudioSize(m_audioDevice) == 0)
+                    {
+                        m_underrunCount++;
+                    }
+                    m_hasQueuedAudio = true;
+                    while (SDL_GetQueuedAudioSize(m_audioDevice) > (2 * sc_AudioDataBufferSize * sizeof(float)))
+                    {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    SDL_QueueAudio(m_audioDevice, m_audioDataBuffer, (sc_AudioDataBufferSize * sizeof(float)));
                 }
-                SDL_QueueAudio(m_audioDevice, m_audioDataBuffer, (sc_AudioDataBufferSize * sizeof(float)));
                 m_audioDataBufferSampleCount = 0;
             }
         }
@@ -141,6 +166,147 @@ void Sound::update(uint64_t cyclesToEmulate)
     m_memory->write(0xFF26, (NR52 & 0x80) | (m_ch4Enabled<<3) | (m_ch3Enabled<<2) | (m_ch2Enabled<<1) | (m_ch1Enabled));
 }
 
+void Sound::collectStats(EmulatorStats& stats) const
+{
+    stats.m_audioSamples = m_sampleCount;
+    stats.m_audioUnderruns = m_underrunCount;
+}
+
+void Sound::restoreStats(EmulatorStats const& stats)
+{
+    m_sampleCount = stats.m_audioSamples;
+    m_underrunCount = stats.m_audioUnderruns;
+}
+
+void Sound::saveState(SaveStateWriter& writer) const
+{
+    writer.write(m_frameSequencer);
+    writer.write(m_sampleClock);
+    writer.write(m_ch1Enabled);
+    writer.write(m_ch1DACEnabled);
+    writer.write(m_ch1SweepEnabled);
+    writer.write(m_ch1SweepTimer);
+    writer.write(m_ch1SweepTime);
+    writer.write(m_ch1SweepDecrease);
+    writer.write(m_ch1SweepShift);
+    writer.write(m_ch1ShadowFrequency);
+    writer.write(m_ch1LengthTimer);
+    writer.write(m_ch1LengthEnabled);
+    writer.write(m_ch1WavePatternDuty);
+    writer.write(m_ch1DutyPosition);
+    writer.write(m_ch1Frequency);
+    writer.write(m_ch1FrequencyTimer);
+    writer.write(m_ch1EnvelopeInitial);
+    writer.write(m_ch1EnvelopeDirection);
+    writer.write(m_ch1EnvelopePeriod);
+    writer.write(m_ch1PeriodTimer);
+    writer.write(m_ch1CurrentVolume);
+    writer.write(m_ch2Enabled);
+    writer.write(m_ch2DACEnabled);
+    writer.write(m_ch2LengthTimer);
+    writer.write(m_ch2LengthEnabled);
+    writer.write(m_ch2WavePatternDuty);
+    writer.write(m_ch2DutyPosition);
+    writer.write(m_ch2Frequency);
+    writer.write(m_ch2FrequencyTimer);
+    writer.write(m_ch2EnvelopeInitial);
+    writer.write(m_ch2EnvelopeDirection);
+    writer.write(m_ch2EnvelopeSweep);
+    writer.write(m_ch2PeriodTimer);
+    writer.write(m_ch2CurrentVolume);
+    writer.write(m_ch3Enabled);
+    writer.write(m_ch3DACEnabled);
+    writer.write(m_ch3LengthTimer);
+    writer.write(m_ch3LengthEnabled);
+    writer.write(m_ch3WavePosition);
+    writer.write(m_ch3Frequency);
+    writer.write(m_ch3FrequencyTimer);
+    writer.write(m_ch3OutputLevel);
+    writer.write(m_ch4Enabled);
+    writer.write(m_ch4DACEnabled);
+    writer.write(m_ch4Frequency);
+    writer.write(m_ch4FrequencyTimer);
+    writer.write(m_ch4LengthTimer);
+    writer.write(m_ch4LengthEnabled);
+    writer.write(m_ch4EnvelopeInitial);
+    writer.write(m_ch4EnvelopeDirection);
+    writer.write(m_ch4EnvelopeSweep);
+    writer.write(m_ch4PeriodTimer);
+    writer.write(m_ch4CurrentVolume);
+    writer.write(m_ch4shiftClockFrequency);
+    writer.write(m_ch4counterStep);
+    writer.write(m_ch4divRatioFrequencies);
+    writer.write(m_LFSR);
+}
+
+void Sound::loadState(SaveStateReader& reader)
+{
+    reader.read(m_frameSequencer);
+    reader.read(m_sampleClock);
+    reader.read(m_ch1Enabled);
+    reader.read(m_ch1DACEnabled);
+    reader.read(m_ch1SweepEnabled);
+    reader.read(m_ch1SweepTimer);
+    reader.read(m_ch1SweepTime);
+    reader.read(m_ch1SweepDecrease);
+    reader.read(m_ch1SweepShift);
+    reader.read(m_ch1ShadowFrequency);
+    reader.read(m_ch1LengthTimer);
+    reader.read(m_ch1LengthEnabled);
+    reader.read(m_ch1WavePatternDuty);
+    reader.read(m_ch1DutyPosition);
+    reader.read(m_ch1Frequency);
+    reader.read(m_ch1FrequencyTimer);
+    reader.read(m_ch1EnvelopeInitial);
+    reader.read(m_ch1EnvelopeDirection);
+    reader.read(m_ch1EnvelopePeriod);
+    reader.read(m_ch1PeriodTimer);
+    reader.read(m_ch1CurrentVolume);
+    reader.read(m_ch2Enabled);
+    reader.read(m_ch2DACEnabled);
+    reader.read(m_ch2LengthTimer);
+    reader.read(m_ch2LengthEnabled);
+    reader.read(m_ch2WavePatternDuty);
+    reader.read(m_ch2DutyPosition);
+    reader.read(m_ch2Frequency);
+    reader.read(m_ch2FrequencyTimer);
+    reader.read(m_ch2EnvelopeInitial);
+    reader.read(m_ch2EnvelopeDirection);
+    reader.read(m_ch2EnvelopeSweep);
+    reader.read(m_ch2PeriodTimer);
+    reader.read(m_ch2CurrentVolume);
+    reader.read(m_ch3Enabled);
+    reader.read(m_ch3DACEnabled);
+    reader.read(m_ch3LengthTimer);
+    reader.read(m_ch3LengthEnabled);
+    reader.read(m_ch3WavePosition);
+    reader.read(m_ch3Frequency);
+    reader.read(m_ch3FrequencyTimer);
+    reader.read(m_ch3OutputLevel);
+    reader.read(m_ch4Enabled);
+    reader.read(m_ch4DACEnabled);
+    reader.read(m_ch4Frequency);
+    reader.read(m_ch4FrequencyTimer);
+    reader.read(m_ch4LengthTimer);
+    reader.read(m_ch4LengthEnabled);
+    reader.read(m_ch4EnvelopeInitial);
+    reader.read(m_ch4EnvelopeDirection);
+    reader.read(m_ch4EnvelopeSweep);
+    reader.read(m_ch4PeriodTimer);
+    reader.read(m_ch4CurrentVolume);
+    reader.read(m_ch4shiftClockFrequency);
+    reader.read(m_ch4counterStep);
+    reader.read(m_ch4divRatioFrequencies);
+    reader.read(m_LFSR);
+
+    // Table indices, kept in range whatever the state holds
+    m_ch1WavePatternDuty &= 3;
+    m_ch1DutyPosition &= 7;
+    m_ch2WavePatternDuty &= 3;
+    m_ch2DutyPosition &= 7;
+    m_ch3WavePosition &= 31;
+}
+
 void Sound::updateChannel1Data()
 {
     uint8_t NR10 = m_memory->read(0xFF10);
@@ -4,19 +4,41 @@
 #include <SDL_audio.h>
 
 #include <cstdint>
+#include <vector>
 
+#include "EmulatorStats.h"
+
+class Emulator;
 class Memory;
+class SaveStateWriter;
+class SaveStateReader;
 
 class Sound
 {
 public:
-    Sound(Memory* memory);
+    Sound(Emulator* emulator, Memory* memory, bool enableAudioOutput);
     ~Sound();
 
     void update(uint64_t cyclesToEmulate);
 
+    // Channel and sequencer state only, samples not yet handed to the audio device aren't part of it
+    void saveState(SaveStateWriter& writer) const;
+    void loadState(SaveStateReader& reader);
+
     static const uint64_t sc_SampleRate = 48000;
 
+    // Keeps every interleaved stereo sample produced until cleared, for embedders that want the audio themselves
+    void setSampleCaptureEnabled(bool enabled) { m_sampleCaptureEnabled = enabled; }
+    std::vector<float> const& getCapturedSamples() const { return m_capturedSamples; }
+    void clearCapturedSamples() { m_capturedSamples.clear(); }
+
+    // Muted sound keeps running its channels but produces no samples, neither for the device nor for capture
+    void setOutputMuted(bool muted) { m_isOutputMuted = muted; }
+
+    // Samples mixed and audio device underruns, see EmulatorStats
+    void collectStats(EmulatorStats& stats) const;
+    void restoreStats(EmulatorStats const& stats);
+
 private:
     void updateChannel1Data();
     void updateChannel2Data();
@@ -31,15 +53,25 @@ private:
     void handleLengthClock(uint8_t& channelEnabled, uint8_t& lengthEnabled, uint16_t& lengthCounter);
     uint64_t calculateCh1NewFrequencyAndOverflowCheck();
 
+    Emulator* m_emulator;
     Memory* m_memory;
 
-    SDL_AudioDeviceID m_audioDevice;
+    bool m_audioOutputEnabled;
+    bool m_isOutputMuted = false;
+    SDL_AudioDeviceID m_audioDevice = 0;
     SDL_AudioSpec m_audioSpec;
 
     static const uint64_t sc_AudioDataBufferSize = 4096;
     float m_audioDataBuffer[sc_AudioDataBufferSize] = { 0 };
     uint32_t m_audioDataBufferSampleCount = 0;
 
+    bool m_hasQueuedAudio = false;
+    uint64_t m_sampleCount = 0;
+    uint64_t m_underrunCount = 0;
+
+    bool m_sampleCaptureEnabled = false;
+    std::vector<float> m_capturedSamples;
+
     uint64_t m_frameSequencer = 0;
     uint64_t m_sampleClock = 0;
     uint8_t m_waveDutyTable[4][8] = {
@@ -0,0 +1,177 @@
+#include "ThreadPool.h"
+#include "Instrumentation.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+
+ThreadPool::ThreadPool(uint32_t numThreads, bool pinThreads)
+{
+    std::vector<LogicalProcessor> processors = enumerateLogicalProcessors();
+    if (numThreads == 0)
+    {
+        numThreads = static_cast<uint32_t>(processors.size());
+    }
+
+    for (uint32_t i = 0; i < numThreads; i++)
+    {
+        m_workers.push_back(std::make_unique<Worker>());
+        m_workers[i]->m_numaNode = processors[i % processors.size()].m_numaNode;
+    }
+
+    // Steal from the closest workers on the same node first, then from everyone else
+    for (uint32_t i = 0; i < numThreads; i++)
+    {
+        std::vector<uint32_t>& stealOrder = m_workers[i]->m_stealOrder;
+        for (uint32_t distance = 1; distance < numThreads; distance++)
+        {
+            stealOrder.push_back((i + distance) % numThreads);
+        }
+        std::stable_partition(stealOrder.begin(), stealOrder.end(), [this, i](uint32_t victim)
+            {
+                return m_workers[victim]->m_numaNode == m_workers[i]->m_numaNode;
+            });
+    }
+
+    for (uint32_t i = 0; i < numThreads; i++)
+    {
+        m_workers[i]->m_thread = std::thread(&ThreadPool::workerLoop, this, i);
+        if (pinThreads)
+        {
+            LogicalProcessor const& processor = processors[i % processors.size()];
+            GROUP_AFFINITY affinity = {};
+            affinity.Group = processor.m_group;
+            affinity.Mask = KAFFINITY(1) << processor.m_number;
+            SetThreadGroupAffinity(m_workers[i]->m_thread.native_handle(), &affinity, nullptr);
+        }
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_jobAvailable.notify_all();
+
+    for (auto& worker : m_workers)
+    {
+        worker->m_thread.join();
+    }
+}
+
+std::vector<ThreadPool::LogicalProcessor> ThreadPool::enumerateLogicalProcessors()
+{
+    std::vector<LogicalProcessor> processors;
+
+    ULONG highestNumaNode = 0;
+    if (GetNumaHighestNodeNumber(&highestNumaNode))
+    {
+        for (ULONG node = 0; node <= highestNumaNode; node++)
+        {
+            GROUP_AFFINITY affinity = {};
+            if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)) continue;
+
+            for (uint8_t number = 0; number < sizeof(KAFFINITY) * 8; number++)
+            {
+                if (affinity.Mask & (KAFFINITY(1) << number))
+                {
+                    processors.push_back({ affinity.Group, number, node });
+                }
+            }
+        }
+    }
+
+    if (processors.empty())
+    {
+        uint32_t numProcessors = std::clamp(std::thread::hardware_concurrency(), 1u, 64u);
+        for (uint32_t i = 0; i < numProcessors; i++)
+        {
+            processors.push_back({ 0, static_cast<uint8_t>(i), 0 });
+        }
+    }
+
+    return processors;
+}
+
+void ThreadPool::submit(Job job)
+{
+    m_unfinishedJobs++;
+
+    // Counted before it's pushed, since a worker may steal it and count it down right away. A worker woken by the
+    // count meanwhile only finds nothing and looks again.
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_queuedJobs++;
+    }
+
+    Worker& worker = *m_workers[m_nextSubmitWorker++ % m_workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(worker.m_mutex);
+        worker.m_jobs.push_back(std::move(job));
+    }
+    m_jobAvailable.notify_one();
+}
+
+void ThreadPool::waitForIdle()
+{
+    std::unique_lock<std::mutex> lock(m_sleepMutex);
+    m_allJobsFinished.wait(lock, [this]() { return m_unfinishedJobs == 0; });
+}
+
+bool ThreadPool::popOrStealJob(uint32_t workerIndex, Job& job)
+{
+    Worker& worker = *m_workers[workerIndex];
+    {
+        std::lock_guard<std::mutex> lock(worker.m_mutex);
+        if (!worker.m_jobs.empty())
+        {
+            job = std::move(worker.m_jobs.back());
+            worker.m_jobs.pop_back();
+            return true;
+        }
+    }
+
+    for (uint32_t victimIndex : worker.m_stealOrder)
+    {
+        Worker& victim = *m_workers[victimIndex];
+        std::lock_guard<std::mutex> lock(victim.m_mutex);
+        if (!victim.m_jobs.empty())
+        {
+            job = std::move(victim.m_jobs.front());
+            victim.m_jobs.pop_front();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(uint32_t workerIndex)
+{
+    INSTRUMENT_THREAD_NAME("Worker");
+    while (true)
+    {
+        Job job;
+        if (popOrStealJob(workerIndex, job))
+        {
+            m_queuedJobs--;
+            job(workerIndex);
+
+            if (--m_unfinishedJobs == 0)
+            {
+                std::lock_guard<std::mutex> lock(m_sleepMutex);
+                m_allJobsFinished.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_jobAvailable.wait(lock, [this]() { return m_queuedJobs > 0 || m_stop; });
+        if (m_stop && m_queuedJobs == 0)
+        {
+            return;
+        }
+    }
+}
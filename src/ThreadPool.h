@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+// Work-stealing thread pool. Every worker owns a deque, runs its newest job first and, once it runs dry,
+// steals the oldest job of another worker, trying the workers on its own NUMA node before the others.
+// Workers can be pinned to one logical processor each, filling NUMA nodes one after the other.
+class ThreadPool
+{
+public:
+    // Jobs get the index of the worker running them, for callers that keep per-worker state
+    using Job = std::function<void(uint32_t workerIndex)>;
+
+    // 0 threads means one per logical processor, across all processor groups
+    ThreadPool(uint32_t numThreads = 0, bool pinThreads = true);
+    ~ThreadPool();
+
+    uint32_t getNumThreads() const { return static_cast<uint32_t>(m_workers.size()); }
+    uint32_t getWorkerNumaNode(uint32_t workerIndex) const { return m_workers[workerIndex]->m_numaNode; }
+
+    void submit(Job job);
+    void waitForIdle();
+
+    static const uint32_t sc_cacheLineSize = 64;
+
+private:
+    struct LogicalProcessor
+    {
+        uint16_t m_group;
+        uint8_t m_number;
+        uint32_t m_numaNode;
+    };
+    static std::vector<LogicalProcessor> enumerateLogicalProcessors();
+
+    // Each worker on its own cache lines so queue locks of neighbouring workers don't false-share
+    struct alignas(sc_cacheLineSize) Worker
+    {
+        std::mutex m_mutex;
+        std::deque<Job> m_jobs;
+        uint32_t m_numaNode = 0;
+        std::vector<uint32_t> m_stealOrder;
+        std::thread m_thread;
+    };
+
+    void workerLoop(uint32_t workerIndex);
+    bool popOrStealJob(uint32_t workerIndex, Job& job);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<uint32_t> m_nextSubmitWorker = 0;
+
+    std::atomic<uint64_t> m_queuedJobs = 0;
+    std::atomic<uint64_t> m_unfinishedJobs = 0;
+    bool m_stop = false;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_jobAvailable;
+    std::condition_variable m_allJobsFinished;
+};
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "CPU.h"
 #include "Memory.h"
+#include "SaveState.h"
 
 Timer::Timer(CPU* cpu, Memory* memory)
     : m_cpu(cpu)
@@ -60,7 +61,7 @@ void Timer::update(uint64_t cyclesToEmulate)
         {
             m_div = 0;
         }
-        else if ((m_timerClock % (CPU::s_frequencyHz / 16384)) == 0)
+        else if ((m_timerClock % (m_cpu->getFrequencyHz() / 16384)) == 0)
         {
             m_div++;
         }
@@ -71,7 +72,7 @@ void Timer::update(uint64_t cyclesToEmulate)
             // TIMA
             uint8_t inputClockSelect = (m_tac & 0x3);
             uint64_t clockFrequency = clockFrequenciesHz[inputClockSelect];
-            if (m_timerClock % static_cast<uint16_t>(CPU::s_frequencyHz / clockFrequency) == 0)
+            if (m_timerClock % static_cast<uint16_t>(m_cpu->getFrequencyHz() / clockFrequency) == 0)
             {
                 m_tima++;
             }
@@ -108,6 +109,26 @@ void Timer::update(uint64_t cyclesToEmulate)
     }
 }
 
+void Timer::saveState(SaveStateWriter& writer) const
+{
+    writer.write(m_tac);
+    writer.write(m_timerClock);
+    writer.write(m_div);
+    writer.write(m_tima);
+    writer.write(m_timaOverflowed);
+    writer.write(m_lastFallingEdgeCheckAndResult);
+}
+
+void Timer::loadState(SaveStateReader& reader)
+{
+    reader.read(m_tac);
+    reader.read(m_timerClock);
+    reader.read(m_div);
+    reader.read(m_tima);
+    reader.read(m_timaOverflowed);
+    reader.read(m_lastFallingEdgeCheckAndResult);
+}
+
 void Timer::checkFallingEdge()
 {
     uint8_t bit = 0;
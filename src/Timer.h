@@ -4,6 +4,8 @@
 
 class CPU;
 class Memory;
+class SaveStateWriter;
+class SaveStateReader;
 
 class Timer
 {
@@ -13,6 +15,9 @@ public:
 
     void update(uint64_t cyclesToEmulate);
 
+    void saveState(SaveStateWriter& writer) const;
+    void loadState(SaveStateReader& reader);
+
 private:
     void checkFallingEdge();
 
@@ -0,0 +1,228 @@
+#include "VectorEnvironment.h"
+
+#include <Windows.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Emulator.h"
+
+static uint32_t getNumThreads(VectorEnvironment::Config const& config)
+{
+    uint32_t numThreads = config.m_numThreads != 0 ? config.m_numThreads : std::max(std::thread::hardware_concurrency(), 1u);
+    return std::clamp(numThreads, 1u, std::max(config.m_numEnvironments, 1u));
+}
+
+VectorEnvironment::VectorEnvironment(Config const& config)
+    : m_config(config)
+    , m_numThreads(getNumThreads(config))
+    , m_emulators(config.m_numEnvironments)
+    , m_taskStart(getNumThreads(config))
+    , m_taskEnd(getNumThreads(config))
+{
+    assert(m_config.m_frameDownscaleFactor == 0 || m_config.m_frameDownscaleFactor == 1 || m_config.m_frameDownscaleFactor == 2 || m_config.m_frameDownscaleFactor == 4);
+    m_config.m_framesPerStep = std::max(m_config.m_framesPerStep, 1u);
+    m_observationSize = getObservationWidth() * getObservationHeight() + static_cast<uint32_t>(m_config.m_ramAddresses.size());
+
+    for (uint32_t i = 0; i < m_numThreads; i++)
+    {
+        m_scratchFrames.push_back(std::make_unique<uint8_t[]>(Framebuffer::sc_width * Framebuffer::sc_height));
+    }
+
+    // Thread 0 is whichever thread calls reset() and step()
+    for (uint32_t i = 1; i < m_numThreads; i++)
+    {
+        m_threads.emplace_back(&VectorEnvironment::workerLoop, this, i);
+        if (m_config.m_pinThreads)
+        {
+            SetThreadAffinityMask(m_threads.back().native_handle(), DWORD_PTR(1) << (i % (sizeof(DWORD_PTR) * 8)));
+        }
+    }
+
+    Emulator::Config emulatorConfig;
+    emulatorConfig.m_enableAudioOutput = false;
+    emulatorConfig.m_enableControllerInput = false;
+    emulatorConfig.m_persistBatteryBackedRam = false;
+
+    m_resetSource = std::make_unique<Emulator>(emulatorConfig);
+    m_resetSource->setFrameSkip(Emulator::FrameSkipMode::OnRequest);
+    if (m_resetSource->openRomFile(m_config.m_romFilename.c_str()))
+    {
+        for (uint32_t frame = 0; frame < m_config.m_warmUpFrames; frame++)
+        {
+            // The last warm-up frame is the one every reset observes
+            if (m_config.m_frameDownscaleFactor != 0 && frame + 1 == m_config.m_warmUpFrames)
+            {
+                m_resetSource->requestNextFrame();
+            }
+            m_resetSource->runFrame();
+        }
+        m_resetObservation = std::make_unique<uint8_t[]>(m_observationSize);
+        writeObservation(*m_resetSource, m_resetObservation.get(), m_scratchFrames[0].get());
+    }
+
+    reset(nullptr);
+}
+
+VectorEnvironment::~VectorEnvironment()
+{
+    m_task = Task::Exit;
+    m_taskStart.arrive_and_wait();
+    for (std::thread& thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+uint32_t VectorEnvironment::getObservationWidth() const
+{
+    return m_config.m_frameDownscaleFactor != 0 ? Framebuffer::sc_width / m_config.m_frameDownscaleFactor : 0;
+}
+
+uint32_t VectorEnvironment::getObservationHeight() const
+{
+    return m_config.m_frameDownscaleFactor != 0 ? Framebuffer::sc_height / m_config.m_frameDownscaleFactor : 0;
+}
+
+void VectorEnvironment::reset(uint8_t* observations)
+{
+    m_task = Task::Reset;
+    m_actions = nullptr;
+    m_observations = observations;
+
+    m_taskStart.arrive_and_wait();
+    runTask(0);
+    m_taskEnd.arrive_and_wait();
+
+    m_hasOpenedRomFile = std::all_of(m_emulators.begin(), m_emulators.end(), [](auto const& emulator) { return emulator->hasOpenedRomFile(); });
+}
+
+void VectorEnvironment::step(Action const* actions, uint8_t* observations)
+{
+    m_task = Task::Step;
+    m_actions = actions;
+    m_observations = observations;
+
+    m_taskStart.arrive_and_wait();
+    runTask(0);
+    m_taskEnd.arrive_and_wait();
+}
+
+void VectorEnvironment::workerLoop(uint32_t threadIndex)
+{
+    while (true)
+    {
+        m_taskStart.arrive_and_wait();
+        if (m_task == Task::Exit)
+        {
+            return;
+        }
+        runTask(threadIndex);
+        m_taskEnd.arrive_and_wait();
+    }
+}
+
+void VectorEnvironment::runTask(uint32_t threadIndex)
+{
+    // Contiguous slices, so neighbouring environments stay on the same core
+    uint32_t numEnvironments = m_config.m_numEnvironments;
+    uint32_t begin = static_cast<uint32_t>(uint64_t(numEnvironments) * threadIndex / m_numThreads);
+    uint32_t end = static_cast<uint32_t>(uint64_t(numEnvironments) * (threadIndex + 1) / m_numThreads);
+
+    uint8_t* scratchFrame = m_scratchFrames[threadIndex].get();
+    for (uint32_t i = begin; i < end; i++)
+    {
+        uint8_t* observation = m_observations ? m_observations + size_t(i) * m_observationSize : nullptr;
+        if (m_task == Task::Reset)
+        {
+            resetEnvironment(i, observation);
+        }
+        else
+        {
+            stepEnvironment(i, m_actions[i], observation, scratchFrame);
+        }
+    }
+}
+
+void VectorEnvironment::resetEnvironment(uint32_t environmentIndex, uint8_t* observation)
+{
+    // Created by the thread that will step it, so its memory is first touched there
+    std::unique_ptr<Emulator>& emulator = m_emulators[environmentIndex];
+    if (!emulator)
+    {
+        Emulator::Config config;
+        config.m_enableAudioOutput = false;
+        config.m_enableControllerInput = false;
+        config.m_persistBatteryBackedRam = false;
+
+        emulator = std::make_unique<Emulator>(config);
+        emulator->setFrameSkip(Emulator::FrameSkipMode::OnRequest);
+    }
+    // Every thread reads the source at once, which is fine since saving a state doesn't change it
+    if (!emulator->cloneFrom(*m_resetSource)) return;
+
+    // Every instance is now in the reset source's state, so it sees what the source saw after warming up
+    if (observation)
+    {
+        std::memcpy(observation, m_resetObservation.get(), m_observationSize);
+    }
+}
+
+void VectorEnvironment::stepEnvironment(uint32_t environmentIndex, Action action, uint8_t* observation, uint8_t* scratchFrame)
+{
+    Emulator& emulator = *m_emulators[environmentIndex];
+    if (!emulator.hasOpenedRomFile()) return;
+
+    emulator.setPressedButtons(action);
+
+    for (uint32_t frame = 0; frame < m_config.m_framesPerStep; frame++)
+    {
+        // Only the frame that ends up in the observation gets rendered
+        if (observation && m_config.m_frameDownscaleFactor != 0 && frame + 1 == m_config.m_framesPerStep)
+        {
+            emulator.requestNextFrame();
+        }
+        emulator.runFrame();
+    }
+
+    if (observation)
+    {
+        writeObservation(emulator, observation, scratchFrame);
+    }
+}
+
+void VectorEnvironment::writeObservation(Emulator& emulator, uint8_t* observation, uint8_t* scratchFrame)
+{
+    uint32_t factor = m_config.m_frameDownscaleFactor;
+    if (factor != 0)
+    {
+        emulator.getFrameQueue()->acquireLatestFrame().convertTo(Framebuffer::PixelFormat::Grayscale8, scratchFrame);
+
+        // Box filter, every observation pixel is the average of a factor x factor block
+        uint32_t width = getObservationWidth();
+        uint32_t height = getObservationHeight();
+        for (uint32_t y = 0; y < height; y++)
+        {
+            for (uint32_t x = 0; x < width; x++)
+            {
+                uint32_t sum = 0;
+                for (uint32_t j = 0; j < factor; j++)
+                {
+                    uint8_t const* row = scratchFrame + (y * factor + j) * Framebuffer::sc_width + x * factor;
+                    for (uint32_t i = 0; i < factor; i++)
+                    {
+                        sum += row[i];
+                    }
+                }
+                observation[y * width + x] = static_cast<uint8_t>(sum / (factor * factor));
+            }
+        }
+        observation += width * height;
+    }
+
+    for (uint16_t address : m_config.m_ramAddresses)
+    {
+        *observation++ = emulator.readMemory(address);
+    }
+}
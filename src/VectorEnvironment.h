@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <barrier>
+#include <atomic>
+
+class Emulator;
+
+// N copies of the same ROM stepped in lockstep, one frame batch per step(), for reinforcement learning.
+// A fixed set of threads each owns a contiguous slice of the environments for their whole lifetime, the
+// caller's thread being one of them, and they only meet at a barrier at the start and end of a step.
+// Actions and observations are flat caller-owned arrays, so a step never allocates.
+class VectorEnvironment
+{
+public:
+    struct Config
+    {
+        std::string m_romFilename;
+        uint32_t m_numEnvironments = 1;
+        uint32_t m_numThreads = 0;          // 0 for one per hardware thread, never more than the number of environments
+        bool m_pinThreads = false;
+        uint32_t m_framesPerStep = 1;       // Every action is held for this many frames
+        uint32_t m_warmUpFrames = 0;        // Emulated once after opening the ROM, every reset starts from the state after them
+
+        // Observation layout per environment: a downscaled grayscale frame followed by the selected RAM bytes
+        uint32_t m_frameDownscaleFactor = 2; // 1, 2 or 4, 0 to leave the frame out of the observation
+        std::vector<uint16_t> m_ramAddresses;
+    };
+
+    // One byte per environment, bit i set when Joypad::Button i is held
+    using Action = uint8_t;
+
+    VectorEnvironment(Config const& config);
+    ~VectorEnvironment();
+
+    bool hasOpenedRomFile() const { return m_hasOpenedRomFile; }
+    uint32_t getNumEnvironments() const { return m_config.m_numEnvironments; }
+    uint32_t getObservationWidth() const;
+    uint32_t getObservationHeight() const;
+    // Bytes per environment in the observation buffer
+    uint32_t getObservationSize() const { return m_observationSize; }
+
+    // Puts every environment back to the state after the warm-up frames, observations may be null and show the last
+    // warm-up frame. The ROM is only read and booted once; a reset copies that snapshot into the existing instances,
+    // which takes microseconds.
+    void reset(uint8_t* observations);
+    // actions holds getNumEnvironments() entries, observations getNumEnvironments() * getObservationSize() bytes
+    void step(Action const* actions, uint8_t* observations);
+
+private:
+    enum class Task
+    {
+        Reset,
+        Step,
+        Exit,
+    };
+
+    void workerLoop(uint32_t threadIndex);
+    void runTask(uint32_t threadIndex);
+    void resetEnvironment(uint32_t environmentIndex, uint8_t* observation);
+    void stepEnvironment(uint32_t environmentIndex, Action action, uint8_t* observation, uint8_t* scratchFrame);
+    void writeObservation(Emulator& emulator, uint8_t* observation, uint8_t* scratchFrame);
+
+    Config m_config;
+    uint32_t m_numThreads = 1;
+    uint32_t m_observationSize = 0;
+    bool m_hasOpenedRomFile = false;
+
+    std::unique_ptr<Emulator> m_resetSource;
+    std::unique_ptr<uint8_t[]> m_resetObservation;  // Of the last warm-up frame, what every reset observes
+    std::vector<std::unique_ptr<Emulator>> m_emulators;
+
+    // Per thread full-size grayscale frame for downscaling
+    std::vector<std::unique_ptr<uint8_t[]>> m_scratchFrames;
+
+    // Current task, written by the caller's thread before the start barrier
+    Task m_task = Task::Reset;
+    Action const* m_actions = nullptr;
+    uint8_t* m_observations = nullptr;
+
+    std::barrier<> m_taskStart;
+    std::barrier<> m_taskEnd;
+    std::vector<std::thread> m_threads;
+};
\ No newline at end of file
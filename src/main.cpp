@@ -31,7 +31,9 @@ using namespace Microsoft::WRL;
 
 // Emulator
 #include "Emulator.h"
+#include "EmulationThread.h"
 #include "Memory.h"
+#include "Instrumentation.h"
 
 struct Vertex
 {
@@ -117,16 +119,43 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
     fstMesh->setVertexBuffer(vertexBuffer.data(), sizeof(Vertex), static_cast<UINT>(vertexBuffer.size()));
     scene->addMesh(fstMesh);
 
-    Emulator emulator(frameTexture, frameTextureData);
+    // Wakes the UI thread up when the emulation thread has published a frame
+    HANDLE frameReadyEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+
+    Emulator emulator;
+    emulator.setFrameReadyCallback([frameReadyEvent](uint64_t sequenceNumber) { SetEvent(frameReadyEvent); });
+
+    // From here on the emulator belongs to the emulation thread, the UI only reads frames and snapshots
+    EmulationThread emulationThread(&emulator);
     if (lstrcmpW(pCmdLine, L"") != 0)
     {
-        emulator.openRomFile(WideStrToStr(pCmdLine).c_str());
+        emulationThread.openRomFile(WideStrToStr(pCmdLine));
     }
 
     bool showInfoWindow = false;
+    bool showRewindStatsWindow = false;
+    bool showFramePacingStatsWindow = false;
     bool showMenuBar = false;
-    renderer->registerImguiCallback([&showInfoWindow, &showMenuBar, &renderer, &mainPass, &emulator]()
+    uint32_t numReportedMovieSaveFailures = 0;
+    renderer->registerImguiCallback([&showInfoWindow, &showRewindStatsWindow, &showFramePacingStatsWindow, &showMenuBar, &numReportedMovieSaveFailures, &renderer, &mainPass, &emulationThread]()
         {
+            EmulationThread::Snapshot snapshot = emulationThread.getSnapshot();
+
+            if (snapshot.m_numFailedMovieSaves != numReportedMovieSaveFailures)
+            {
+                numReportedMovieSaveFailures = snapshot.m_numFailedMovieSaves;
+                ImGui::OpenPopup("Movie Not Saved");
+            }
+            if (ImGui::BeginPopupModal("Movie Not Saved", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+            {
+                ImGui::Text("The movie couldn't be written to %s, the recording is lost.", snapshot.m_failedMovieFilename.c_str());
+                if (ImGui::Button("OK"))
+                {
+                    ImGui::CloseCurrentPopup();
+                }
+                ImGui::EndPopup();
+            }
+
             if (showMenuBar)
             {
                 if (ImGui::BeginMainMenuBar())
@@ -139,14 +168,84 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
                             config.path = ".";
                             ImGuiFileDialog::Instance()->OpenDialog("OpenROMFileDialogKey", "Choose ROM File", ".gb, .gbc", config);
                         }
+                        if (!snapshot.m_isRecordingMovie && ImGui::MenuItem("Record Movie...", nullptr, false, snapshot.m_hasOpenedRomFile))
+                        {
+                            IGFD::FileDialogConfig config;
+                            config.path = ".";
+                            ImGuiFileDialog::Instance()->OpenDialog("RecordMovieFileDialogKey", "Record Movie", ".gbm", config);
+                        }
+                        if (snapshot.m_isRecordingMovie && ImGui::MenuItem("Stop Recording Movie"))
+                        {
+                            emulationThread.stopMovieRecording();
+                        }
+                        ImGui::EndMenu();
+                    }
+                    if (ImGui::BeginMenu("Emulation"))
+                    {
+                        if (ImGui::MenuItem("Pause", nullptr, snapshot.m_isPaused, snapshot.m_hasOpenedRomFile))
+                        {
+                            emulationThread.setPaused(!snapshot.m_isPaused);
+                        }
+                        if (ImGui::BeginMenu("Run-Ahead"))
+                        {
+                            if (ImGui::MenuItem("Off", nullptr, snapshot.m_runAheadFrames == 0))
+                            {
+                                emulationThread.setRunAheadFrames(0);
+                            }
+                            for (uint32_t frames = 1; frames <= 3; frames++)
+                            {
+                                std::string label = std::to_string(frames) + (frames == 1 ? " frame" : " frames");
+                                if (ImGui::MenuItem(label.c_str(), nullptr, snapshot.m_runAheadFrames == frames))
+                                {
+                                    emulationThread.setRunAheadFrames(frames);
+                                }
+                            }
+                            ImGui::EndMenu();
+                        }
+                        if (ImGui::BeginMenu("Frame Pacing"))
+                        {
+                            static std::pair<char const*, FramePacer::Mode> const sc_pacingModes[] =
+                            {
+                                { "Game Boy Rate", FramePacer::Mode::Timer },
+                                { "Display VSync", FramePacer::Mode::VSync },
+                                { "Unpaced", FramePacer::Mode::Unpaced },
+                            };
+                            for (auto const& pacingMode : sc_pacingModes)
+                            {
+                                if (ImGui::MenuItem(pacingMode.first, nullptr, snapshot.m_framePacingMode == pacingMode.second))
+                                {
+                                    emulationThread.setFramePacingMode(pacingMode.second);
+                                }
+                            }
+                            ImGui::EndMenu();
+                        }
+                        if (ImGui::MenuItem("Trace Instructions", nullptr, snapshot.m_isTracingInstructions))
+                        {
+                            if (snapshot.m_isTracingInstructions) emulationThread.stopInstructionTrace();
+                            else emulationThread.startInstructionTrace("instruction_trace.gbtrace");
+                        }
+                        if (ImGui::MenuItem("Dump Instruction Trace...", nullptr, false, snapshot.m_isTracingInstructions))
+                        {
+                            IGFD::FileDialogConfig config;
+                            config.path = ".";
+                            ImGuiFileDialog::Instance()->OpenDialog("DumpInstructionTraceFileDialogKey", "Dump Instruction Trace", ".gbtrace", config);
+                        }
                         ImGui::EndMenu();
                     }
                     if (ImGui::BeginMenu("View"))
                     {
-                        if (ImGui::MenuItem("View ROM Info...") && emulator.hasOpenedRomFile())
+                        if (ImGui::MenuItem("View ROM Info...") && snapshot.m_hasOpenedRomFile)
                         {
                             showInfoWindow = true;
                         }
+                        if (ImGui::MenuItem("View Rewind Stats..."))
+                        {
+                            showRewindStatsWindow = true;
+                        }
+                        if (ImGui::MenuItem("View Frame Pacing Stats..."))
+                        {
+                            showFramePacingStatsWindow = true;
+                        }
                         ImGui::EndMenu();
                     }
                     ImGui::EndMainMenuBar();
@@ -159,14 +258,32 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
                 {
                     std::string filePathName = ImGuiFileDialog::Instance()->GetFilePathName();
                     std::string filePath = ImGuiFileDialog::Instance()->GetCurrentPath();
-                    emulator.openRomFile(filePathName.c_str());
+                    emulationThread.openRomFile(filePathName);
+                }
+                ImGuiFileDialog::Instance()->Close();
+            }
+
+            if (ImGuiFileDialog::Instance()->Display("RecordMovieFileDialogKey"))
+            {
+                if (ImGuiFileDialog::Instance()->IsOk())
+                {
+                    emulationThread.startMovieRecording(ImGuiFileDialog::Instance()->GetFilePathName());
+                }
+                ImGuiFileDialog::Instance()->Close();
+            }
+
+            if (ImGuiFileDialog::Instance()->Display("DumpInstructionTraceFileDialogKey"))
+            {
+                if (ImGuiFileDialog::Instance()->IsOk())
+                {
+                    emulationThread.dumpInstructionTrace(ImGuiFileDialog::Instance()->GetFilePathName());
                 }
                 ImGuiFileDialog::Instance()->Close();
             }
 
             if (showInfoWindow)
             {
-                Emulator::CartridgeInfo cartInfo = emulator.getCartridgeInfo();
+                Emulator::CartridgeInfo const& cartInfo = snapshot.m_cartridgeInfo;
                 ImGui::Begin("Cartridge Info", &showInfoWindow);
                 ImGui::Text("Name: %s", cartInfo.m_name.c_str());
                 ImGui::Text("Is CGB: %s", cartInfo.m_isColorGB ? "yes" : "no");
@@ -193,44 +310,87 @@ int WINAPI wWinMain(_In_ HINSTANCE hInstance, _In_opt_ HINSTANCE hPrevInstance,
                 ImGui::Text("Num. RAM Banks: %d", cartInfo.m_numRamBanks);
                 ImGui::End();
             }
+
+            if (showRewindStatsWindow)
+            {
+                RewindBuffer::Stats const& stats = snapshot.m_rewindStats;
+                ImGui::Begin("Rewind Stats", &showRewindStatsWindow);
+                ImGui::Text("Snapshots: %u (%.1fs)", stats.m_numSnapshots, stats.m_numSnapshots / 59.73);
+                ImGui::Text("Used: %.2fMB of %.2fMB", stats.m_usedBytes / (1024.0 * 1024.0), stats.m_budgetBytes / (1024.0 * 1024.0));
+                ImGui::Text("Compression ratio: %.1f:1", stats.m_compressionRatio);
+                ImGui::Text("Capture time: %.1fus", stats.m_averageCaptureMicroseconds);
+                ImGui::End();
+            }
+
+            if (showFramePacingStatsWindow)
+            {
+                FramePacer::Stats const& stats = snapshot.m_framePacerStats;
+                ImGui::Begin("Frame Pacing Stats", &showFramePacingStatsWindow);
+                ImGui::Text("Frame time: %.2fms (%.2f FPS)", stats.m_averageFrameMilliseconds, stats.m_averageFrameMilliseconds > 0.0 ? 1000.0 / stats.m_averageFrameMilliseconds : 0.0);
+                ImGui::Text("Jitter: %.3fms", stats.m_frameJitterMilliseconds);
+                ImGui::Text("Longest frame: %.2fms", stats.m_maxFrameMilliseconds);
+                ImGui::Text("Emulation thread CPU: %.1f%%", stats.m_cpuUtilization * 100.0);
+                ImGui::End();
+            }
         });
 
-    window.onKeyboardButtonDown([&emulator, &showMenuBar](WPARAM wParam, LPARAM lParam)
+    window.onKeyboardButtonDown([&emulationThread, &showMenuBar](WPARAM wParam, LPARAM lParam)
         {
-            emulator.processKeyboardInput(wParam, lParam);
+            emulationThread.processKeyboardInput(wParam, lParam);
             if (wParam == VK_ESCAPE)
             {
                 showMenuBar = !showMenuBar;
             }
             if (wParam == VK_F1)
             {
-                emulator.setTurboModeMultiplier(2);
+                emulationThread.setTurboModeMultiplier(2);
+            }
+            if (wParam == VK_BACK)
+            {
+                emulationThread.setRewinding(true);
             }
         });
-    window.onKeyboardButtonUp([&emulator](WPARAM wParam, LPARAM lParam)
+    window.onKeyboardButtonUp([&emulationThread](WPARAM wParam, LPARAM lParam)
         {
-            emulator.processKeyboardInput(wParam, lParam);
+            emulationThread.processKeyboardInput(wParam, lParam);
             if (wParam == VK_F1)
             {
-                emulator.setTurboModeMultiplier(1);
+                emulationThread.setTurboModeMultiplier(1);
+            }
+            if (wParam == VK_BACK)
+            {
+                emulationThread.setRewinding(false);
             }
         });
 
+    INSTRUMENT_THREAD_NAME("Main");
     while (!window.shouldCloseWindow())
     {
-        if(emulator.hasOpenedRomFile())
-            emulator.emulate();
+        EmulationThread::Snapshot snapshot = emulationThread.getSnapshot();
+
+        if (emulator.isFrameReady())
+        {
+            emulator.convertFrame(Framebuffer::PixelFormat::RGBA8888, frameTextureData);
+            frameTexture.setNeedsCopyToGPU();
+        }
 
-        if (!emulator.hasOpenedRomFile() || ResourceManager::it().getResourceNeedsCopyToGPU(frameTexture))
+        if (!snapshot.m_hasOpenedRomFile || snapshot.m_isPaused || ResourceManager::it().getResourceNeedsCopyToGPU(frameTexture))
         {
+            INSTRUMENT_ZONE("Frame present");
             renderer->beginFrame();
             renderer->submitRenderPass(mainPass, *scene, { &scene->getCamera() });
             renderer->submitImGui();
             renderer->endFrame();
         }
+        else
+        {
+            // Nothing new to show, wait for the next frame or for window messages
+            MsgWaitForMultipleObjects(1, &frameReadyEvent, FALSE, 100, QS_ALLINPUT);
+        }
     }
 
     renderer->waitForIdleGPU();
+    INSTRUMENT_WRITE_TRACE("gb_emulator_trace.json");
 
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,175 @@
+// Runs many emulator instances across all cores and reports per-instance frame hashes and throughput.
+//
+// > gb_batch.exe [options] rom1.gb [rom2.gbc ...]
+//   --instances N      Number of instances, ROMs are assigned round-robin (default: one per ROM)
+//   --frames K         Frames to run per instance (default: 600)
+//   --threads T        Worker threads, 0 for one per logical processor (default: 0)
+//   --hash-interval H  Hash every Hth frame, 0 to only hash the last one (default: 0)
+//   --inputs FILE      Input script applied to every instance, one "<frame> <button> <down|up>" per line
+//   --movie FILE       Movie every instance replays from its start state instead, until it ends (ignores --frames)
+//   --all-hashes       Print every recorded hash instead of only the last one
+//   --no-pin           Don't pin worker threads to logical processors
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "BatchRunner.h"
+#include "ThreadPool.h"
+#include "Movie.h"
+
+static bool parseButton(std::string const& name, Joypad::Button& button)
+{
+    static const char* sc_buttonNames[] = { "right", "left", "up", "down", "a", "b", "select", "start" };
+    for (uint32_t i = 0; i < sizeof(sc_buttonNames) / sizeof(sc_buttonNames[0]); i++)
+    {
+        if (name == sc_buttonNames[i])
+        {
+            button = static_cast<Joypad::Button>(i);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool loadInputScript(char const* filename, std::vector<BatchRunner::InputEvent>& inputs)
+{
+    std::ifstream file(filename);
+    if (!file)
+    {
+        fprintf(stderr, "Couldn't open input script %s\n", filename);
+        return false;
+    }
+
+    std::string line;
+    uint32_t lineNumber = 0;
+    while (std::getline(file, line))
+    {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') continue;
+
+        std::istringstream stream(line);
+        BatchRunner::InputEvent input;
+        std::string buttonName, state;
+        if (!(stream >> input.m_frame >> buttonName >> state) || !parseButton(buttonName, input.m_button) || (state != "down" && state != "up"))
+        {
+            fprintf(stderr, "%s:%u: expected \"<frame> <button> <down|up>\"\n", filename, lineNumber);
+            return false;
+        }
+        input.m_isPressed = state == "down";
+        inputs.push_back(input);
+    }
+
+    std::stable_sort(inputs.begin(), inputs.end(), [](auto const& a, auto const& b) { return a.m_frame < b.m_frame; });
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t numInstances = 0;
+    uint32_t numFrames = 600;
+    uint32_t numThreads = 0;
+    uint32_t hashInterval = 0;
+    bool printAllHashes = false;
+    bool pinThreads = true;
+    std::vector<BatchRunner::InputEvent> inputs;
+    std::shared_ptr<Movie> movie;
+    std::vector<std::string> romFilenames;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--instances") == 0 && hasValue) numInstances = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames") == 0 && hasValue) numFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) numThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hash-interval") == 0 && hasValue) hashInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--inputs") == 0 && hasValue)
+        {
+            if (!loadInputScript(argv[++i], inputs)) return 1;
+        }
+        else if (strcmp(argv[i], "--movie") == 0 && hasValue)
+        {
+            movie = std::make_shared<Movie>();
+            if (!movie->loadFromFile(argv[++i]))
+            {
+                fprintf(stderr, "Couldn't load movie %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--all-hashes") == 0) printAllHashes = true;
+        else if (strcmp(argv[i], "--no-pin") == 0) pinThreads = false;
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else romFilenames.push_back(argv[i]);
+    }
+
+    if (romFilenames.empty())
+    {
+        fprintf(stderr, "Usage: gb_batch [--instances N] [--frames K] [--threads T] [--hash-interval H] [--inputs FILE] [--movie FILE] [--all-hashes] [--no-pin] rom...\n");
+        return 1;
+    }
+    if (numInstances == 0)
+    {
+        numInstances = static_cast<uint32_t>(romFilenames.size());
+    }
+
+    std::vector<BatchRunner::Job> jobs(numInstances);
+    for (uint32_t i = 0; i < numInstances; i++)
+    {
+        jobs[i].m_romFilename = romFilenames[i % romFilenames.size()];
+        jobs[i].m_numFrames = numFrames;
+        jobs[i].m_inputs = inputs;
+        jobs[i].m_hashInterval = hashInterval;
+        jobs[i].m_movie = movie;
+    }
+
+    ThreadPool threadPool(numThreads, pinThreads);
+    BatchRunner batchRunner(&threadPool);
+    BatchRunner::Summary summary;
+    std::vector<BatchRunner::Result> results = batchRunner.run(jobs, &summary);
+
+    bool allRomsOpened = true;
+    bool anyDesynced = false;
+    printf("instance,rom,worker,frames,seconds,fps,hash\n");
+    for (uint32_t i = 0; i < numInstances; i++)
+    {
+        BatchRunner::Result const& result = results[i];
+        allRomsOpened = allRomsOpened && result.m_hasOpenedRomFile;
+        anyDesynced = anyDesynced || result.m_isDesynced;
+
+        printf("%u,%s,%u,%u,%.3f,%.1f,", i, jobs[i].m_romFilename.c_str(), result.m_workerIndex, result.m_numFramesRun, result.m_seconds, result.getFramesPerSecond());
+        if (!result.m_hasOpenedRomFile)
+        {
+            printf("error\n");
+        }
+        else if (result.m_isDesynced)
+        {
+            printf("desync@%llu\n", static_cast<unsigned long long>(result.m_desyncCycle));
+        }
+        else if (printAllHashes)
+        {
+            for (size_t j = 0; j < result.m_frameHashes.size(); j++)
+            {
+                printf("%s%016llx", j == 0 ? "" : " ", static_cast<unsigned long long>(result.m_frameHashes[j]));
+            }
+            printf("\n");
+        }
+        else
+        {
+            printf("%016llx\n", static_cast<unsigned long long>(result.m_finalFrameHash));
+        }
+    }
+
+    fprintf(stderr, "%u instances, %llu frames in %.3fs on %u threads: %.1f frames/s aggregate\n",
+        numInstances, static_cast<unsigned long long>(summary.m_numFramesRun), summary.m_wallSeconds, threadPool.getNumThreads(), summary.getFramesPerSecond());
+
+    return allRomsOpened && !anyDesynced ? 0 : 1;
+}
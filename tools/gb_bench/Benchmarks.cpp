@@ -0,0 +1,461 @@
+#include "Benchmarks.h"
+
+#include <memory>
+
+#include "Emulator.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "Timer.h"
+#include "LCD.h"
+#include "Sound.h"
+#include "InstructionTrace.h"
+#include "Assembler.h"
+#include "WorkloadRoms.h"
+
+// Keeps results alive so the compiler can't drop the work that produced them
+static volatile uint64_t s_sink = 0;
+
+using Reg8 = Assembler::Reg8;
+using Reg16 = Assembler::Reg16;
+using Condition = Assembler::Condition;
+using AluOp = Assembler::AluOp;
+using ShiftOp = Assembler::ShiftOp;
+
+static std::shared_ptr<Emulator> openRom(std::vector<uint8_t> const& rom)
+{
+    Emulator::Config config;
+    config.m_enableAudioOutput = false;
+    config.m_enableControllerInput = false;
+    config.m_persistBatteryBackedRam = false;
+
+    std::shared_ptr<Emulator> emulator = std::make_shared<Emulator>(config);
+    emulator->openRomFromMemory(rom.data(), rom.size());
+    return emulator;
+}
+
+// For benchmarks that drive a component directly and never run the CPU
+static std::shared_ptr<Emulator> openIdleRom(uint8_t cartridgeType = 0x00, bool isCGB = false)
+{
+    Assembler assembler(WorkloadRoms::sc_programAddress);
+    assembler.jp(assembler.here());
+    return openRom(WorkloadRoms::buildRom(cartridgeType, isCGB, assembler.finish()));
+}
+
+// The program jumps over a RET right at its start, which the call benchmark calls
+static const uint16_t sc_returnAddress = WorkloadRoms::sc_programAddress + 3;
+
+// Sets up the stack, HL and BC pointing somewhere harmless in WRAM, then runs the body over and over. The body is
+// repeated back to back for as long as it fits, so the jump back to its start is a rounding error.
+static std::vector<uint8_t> assembleOpcodeLoop(void (*emitBody)(Assembler&))
+{
+    Assembler assembler(WorkloadRoms::sc_programAddress);
+    Assembler::Label start = assembler.createLabel();
+    assembler.jp(start);
+    assembler.ret();
+    assembler.bind(start);
+    assembler.ld(Reg16::SP, uint16_t(0xFFFE));
+    assembler.ld(Reg16::HL, uint16_t(0xC000));
+    assembler.ld(Reg16::BC, uint16_t(0xC100));
+
+    Assembler::Label loop = assembler.here();
+    do
+    {
+        emitBody(assembler);
+    } while (assembler.getAddress() < WorkloadRoms::sc_programEnd - 0x40);
+    assembler.jp(loop);
+    return WorkloadRoms::buildRom(0x00, false, assembler.finish());
+}
+
+enum VideoFeatures : uint32_t
+{
+    Video_Background = 0x1,
+    Video_Window = 0x2,
+    Video_Sprites = 0x4,
+};
+
+// Fills VRAM, OAM and the palettes through the memory map and turns the LCD on
+static void configureVideo(Emulator& emulator, uint32_t features)
+{
+    uint32_t random = 0x12345678;
+    for (uint16_t address = 0x8000; address < 0x9800; address++)
+    {
+        random = random * 1664525u + 1013904223u;
+        emulator.writeMemory(address, static_cast<uint8_t>(random >> 24));
+    }
+    for (uint16_t address = 0x9800; address < 0xA000; address++)
+    {
+        emulator.writeMemory(address, static_cast<uint8_t>(address * 7));
+    }
+
+    // 8x16 sprites spread evenly over the screen, about four on every line
+    for (uint16_t sprite = 0; sprite < 40; sprite++)
+    {
+        emulator.writeMemory(0xFE00 + sprite * 4, static_cast<uint8_t>(16 + sprite * 144 / 40));
+        emulator.writeMemory(0xFE00 + sprite * 4 + 1, static_cast<uint8_t>(8 + (sprite * 37) % 160));
+        emulator.writeMemory(0xFE00 + sprite * 4 + 2, static_cast<uint8_t>(sprite * 2));
+        emulator.writeMemory(0xFE00 + sprite * 4 + 3, static_cast<uint8_t>((sprite & 1) << 4));
+    }
+
+    emulator.writeMemory(0xFF47, 0xE4);     // BGP
+    emulator.writeMemory(0xFF48, 0xD2);     // OBP0
+    emulator.writeMemory(0xFF49, 0x1B);     // OBP1
+    if (emulator.isCGBMode())
+    {
+        for (uint16_t paletteRegister : { 0xFF68, 0xFF6A })
+        {
+            emulator.writeMemory(paletteRegister, 0x80);
+            for (uint8_t i = 0; i < 64; i++)
+            {
+                emulator.writeMemory(paletteRegister + 1, static_cast<uint8_t>(i * 13));
+            }
+        }
+    }
+
+    emulator.writeMemory(0xFF4A, 0);        // WY
+    emulator.writeMemory(0xFF4B, 7);        // WX
+    uint8_t LCDC = 0x80 | 0x10;             // LCD on, tile data at 0x8000
+    if (features & Video_Background) LCDC |= 0x01;
+    if (features & Video_Sprites) LCDC |= 0x02 | 0x04;
+    if (features & Video_Window) LCDC |= 0x20 | 0x40;
+    emulator.writeMemory(0xFF40, LCDC);
+}
+
+// All four channels playing without length or envelope running out
+static void configureSound(Emulator& emulator)
+{
+    emulator.writeMemory(0xFF26, 0x80);     // NR52
+    emulator.writeMemory(0xFF24, 0x77);     // NR50
+    emulator.writeMemory(0xFF25, 0xFF);     // NR51
+    for (uint16_t address = 0xFF30; address < 0xFF40; address++)
+    {
+        emulator.writeMemory(address, static_cast<uint8_t>(address * 0x37));
+    }
+
+    uint8_t const registers[][2] =
+    {
+        { 0x11, 0x80 }, { 0x12, 0xF0 }, { 0x13, 0x00 }, { 0x14, 0x87 },
+        { 0x16, 0x40 }, { 0x17, 0xF0 }, { 0x18, 0x80 }, { 0x19, 0x86 },
+        { 0x1A, 0x80 }, { 0x1C, 0x20 }, { 0x1D, 0x40 }, { 0x1E, 0x87 },
+        { 0x21, 0xF0 }, { 0x22, 0x55 }, { 0x23, 0x80 },
+    };
+    for (auto const& reg : registers)
+    {
+        emulator.writeMemory(0xFF00 | reg[0], reg[1]);
+    }
+}
+
+static void addCPUBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    struct OpcodeClass
+    {
+        char const* m_name;
+        void (*m_emitBody)(Assembler&);
+    };
+    static const OpcodeClass sc_opcodeClasses[] =
+    {
+        { "nop", [](Assembler& a) { a.nop(); } },
+        { "ld_r_r", [](Assembler& a)
+        {
+            a.ld(Reg8::B, Reg8::C); a.ld(Reg8::C, Reg8::D); a.ld(Reg8::D, Reg8::E); a.ld(Reg8::E, Reg8::H);
+            a.ld(Reg8::H, Reg8::L); a.ld(Reg8::L, Reg8::H); a.ld(Reg8::A, Reg8::B); a.ld(Reg8::B, Reg8::A);
+        } },
+        { "alu", [](Assembler& a)
+        {
+            a.alu(AluOp::Add, Reg8::B); a.alu(AluOp::Sub, Reg8::C); a.alu(AluOp::And, Reg8::D); a.alu(AluOp::Or, Reg8::E);
+            a.alu(AluOp::Xor, Reg8::B); a.alu(AluOp::Adc, Reg8::C); a.alu(AluOp::Sbc, Reg8::D); a.alu(AluOp::Cp, Reg8::E);
+        } },
+        { "alu_imm", [](Assembler& a)
+        {
+            a.alu(AluOp::Add, uint8_t(0x11)); a.alu(AluOp::Sub, uint8_t(0x07)); a.alu(AluOp::And, uint8_t(0xF0));
+            a.alu(AluOp::Or, uint8_t(0x0F)); a.alu(AluOp::Cp, uint8_t(0x33));
+        } },
+        { "load_store", [](Assembler& a)
+        {
+            a.ld(Reg8::A, Reg8::HLIndirect); a.ld(Reg8::HLIndirect, Reg8::A); a.ldAFromIndirect(Reg16::BC); a.ldIndirectFromA(Reg16::BC);
+            a.ldhAFromIO(0x80); a.ldhIOFromA(0x81);
+        } },
+        { "inc_dec_16", [](Assembler& a)
+        {
+            a.inc(Reg16::BC); a.inc(Reg16::DE); a.dec(Reg16::BC); a.dec(Reg16::DE); a.addHL(Reg16::BC); a.addHL(Reg16::DE);
+        } },
+        { "jr", [](Assembler& a)
+        {
+            // Every jump lands on the next instruction, taken or not
+            for (Condition condition : { Condition::NZ, Condition::Z })
+            {
+                Assembler::Label next = a.createLabel();
+                a.jr(condition, next);
+                a.bind(next);
+            }
+            Assembler::Label next = a.createLabel();
+            a.jr(next);
+            a.bind(next);
+        } },
+        { "call_ret", [](Assembler& a) { a.call(sc_returnAddress); } },
+        { "push_pop", [](Assembler& a) { a.push(Reg16::BC); a.pop(Reg16::DE); a.push(Reg16::HL); a.pop(Reg16::BC); } },
+        { "cb", [](Assembler& a)
+        {
+            a.shift(ShiftOp::Swap, Reg8::A); a.bit(0, Reg8::B); a.shift(ShiftOp::Rl, Reg8::C); a.set(0, Reg8::A);
+            a.shift(ShiftOp::Srl, Reg8::A);
+        } },
+    };
+
+    for (OpcodeClass const& opcodeClass : sc_opcodeClasses)
+    {
+        benchmarks.push_back({ std::string("cpu/") + opcodeClass.m_name, "instruction", [&opcodeClass]() -> Benchmark::Run
+        {
+            std::shared_ptr<Emulator> emulator = openRom(assembleOpcodeLoop(opcodeClass.m_emitBody));
+            return [emulator](uint64_t numOperations)
+            {
+                CPU* cpu = emulator->getCPU();
+                uint64_t cycles = 0;
+                for (uint64_t i = 0; i < numOperations; i++)
+                {
+                    cycles += cpu->executeInstruction();
+                }
+                s_sink = s_sink + cycles;
+            };
+        } });
+    }
+}
+
+static void addMemoryBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    struct Controller
+    {
+        char const* m_name;
+        uint8_t m_cartridgeType;
+    };
+    static const Controller sc_controllers[] =
+    {
+        { "rom", 0x00 },
+        { "mbc1", 0x02 },
+        { "mbc2", 0x05 },
+        { "mbc3", 0x12 },
+        { "mbc5", 0x1A },
+    };
+
+    struct Region
+    {
+        char const* m_name;
+        uint16_t m_base;
+        uint16_t m_mask;    // Addresses cycle through base + (i & mask)
+        bool m_isWritten;
+    };
+    static const Region sc_regions[] =
+    {
+        { "rom0", 0x0000, 0x3FFF, false },
+        { "romx", 0x4000, 0x3FFF, false },
+        { "bank_select", 0x2000, 0x00FF, true },
+        { "vram", 0x8000, 0x1FFF, true },
+        { "sram", 0xA000, 0x1FFF, true },
+        { "wram", 0xC000, 0x0FFF, true },
+        { "wramx", 0xD000, 0x0FFF, true },
+        { "oam", 0xFE00, 0x007F, true },
+        { "io", 0xFF40, 0x000F, false },
+        { "hram", 0xFF80, 0x003F, true },
+    };
+
+    for (Controller const& controller : sc_controllers)
+    {
+        for (Region const& region : sc_regions)
+        {
+            for (bool isWrite : { false, true })
+            {
+                if (isWrite && !region.m_isWritten) continue;
+                if (!isWrite && region.m_base == 0x2000) continue;
+
+                std::string name = std::string("memory/") + controller.m_name + (isWrite ? "/write/" : "/read/") + region.m_name;
+                benchmarks.push_back({ name, isWrite ? "write" : "read", [&controller, &region, isWrite]() -> Benchmark::Run
+                {
+                    std::shared_ptr<Emulator> emulator = openIdleRom(controller.m_cartridgeType);
+                    // External RAM enabled, bank 1 mapped at 0x4000
+                    emulator->writeMemory(0x0000, 0x0A);
+                    emulator->writeMemory(0x2100, 0x01);
+
+                    return [emulator, region, isWrite](uint64_t numOperations)
+                    {
+                        Memory* memory = emulator->getMemory();
+                        if (isWrite)
+                        {
+                            for (uint64_t i = 0; i < numOperations; i++)
+                            {
+                                // Bank numbers stay within the ROM, anything else gets the low bits of i
+                                uint8_t value = region.m_base == 0x2000 ? static_cast<uint8_t>((i & 7) | 1) : static_cast<uint8_t>(i);
+                                memory->write(region.m_base + (i & region.m_mask), value);
+                            }
+                        }
+                        else
+                        {
+                            uint64_t sum = 0;
+                            for (uint64_t i = 0; i < numOperations; i++)
+                            {
+                                sum += memory->read(region.m_base + (i & region.m_mask));
+                            }
+                            s_sink = s_sink + sum;
+                        }
+                    };
+                } });
+            }
+        }
+    }
+}
+
+static void addLCDBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    struct Scene
+    {
+        char const* m_name;
+        uint32_t m_features;
+        bool m_isCGB;
+        bool m_useLayerCache;
+    };
+    static const Scene sc_scenes[] =
+    {
+        { "bg", Video_Background, false, true },
+        { "bg_no_layer_cache", Video_Background, false, false },
+        { "window", Video_Background | Video_Window, false, true },
+        { "sprites", Video_Background | Video_Sprites, false, true },
+        { "cgb_bg", Video_Background, true, true },
+        { "cgb_sprites", Video_Background | Video_Sprites, true, true },
+    };
+
+    for (Scene const& scene : sc_scenes)
+    {
+        // A line is 456 cycles, fed to the LCD in the 4 cycle steps it gets from emulate(). VBlank lines are part of
+        // the average like they are part of every frame.
+        benchmarks.push_back({ std::string("lcd/line/") + scene.m_name, "line", [&scene]() -> Benchmark::Run
+        {
+            std::shared_ptr<Emulator> emulator = openIdleRom(0x00, scene.m_isCGB);
+            emulator->setLayerCacheEnabled(scene.m_useLayerCache);
+            configureVideo(*emulator, scene.m_features);
+
+            return [emulator](uint64_t numOperations)
+            {
+                LCD* lcd = emulator->getLCD();
+                for (uint64_t i = 0; i < numOperations; i++)
+                {
+                    for (uint32_t step = 0; step < 456 / 4; step++)
+                    {
+                        lcd->update(4);
+                    }
+                }
+            };
+        } });
+    }
+}
+
+static void addTimerAndSoundBenchmarks(std::vector<Benchmark>& benchmarks)
+{
+    for (uint8_t TAC : { 0x00, 0x05 })
+    {
+        benchmarks.push_back({ TAC != 0 ? "timer/update/enabled" : "timer/update/disabled", "update", [TAC]() -> Benchmark::Run
+        {
+            std::shared_ptr<Emulator> emulator = openIdleRom();
+            emulator->writeMemory(0xFF07, TAC);
+            return [emulator](uint64_t numOperations)
+            {
+                Timer* timer = emulator->getTimer();
+                for (uint64_t i = 0; i < numOperations; i++)
+                {
+                    timer->update(4);
+                }
+            };
+        } });
+    }
+
+    for (bool isPlaying : { false, true })
+    {
+        benchmarks.push_back({ isPlaying ? "sound/update/four_channels" : "sound/update/off", "update", [isPlaying]() -> Benchmark::Run
+        {
+            std::shared_ptr<Emulator> emulator = openIdleRom();
+            if (isPlaying)
+            {
+                configureSound(*emulator);
+            }
+            else
+            {
+                emulator->writeMemory(0xFF26, 0x00);
+            }
+            return [emulator](uint64_t numOperations)
+            {
+                Sound* sound = emulator->getSound();
+                for (uint64_t i = 0; i < numOperations; i++)
+                {
+                    sound->update(4);
+                }
+            };
+        } });
+    }
+}
+
+std::vector<Benchmark> createMicroBenchmarks()
+{
+    std::vector<Benchmark> benchmarks;
+    addCPUBenchmarks(benchmarks);
+    addMemoryBenchmarks(benchmarks);
+    addLCDBenchmarks(benchmarks);
+    addTimerAndSoundBenchmarks(benchmarks);
+    return benchmarks;
+}
+
+// Every workload ROM on its default cartridge type, and bank switching on every controller. Each also runs with the
+// instruction trace recording, to compare against the untraced frames.
+std::vector<Benchmark> createMacroBenchmarks()
+{
+    struct Frame
+    {
+        std::string m_name;
+        WorkloadRoms::Workload m_workload;
+        uint8_t m_cartridgeType;
+        bool m_isTraced;
+    };
+    std::vector<Frame> frames;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(WorkloadRoms::Workload::Count); i++)
+    {
+        WorkloadRoms::Workload workload = static_cast<WorkloadRoms::Workload>(i);
+        if (workload == WorkloadRoms::Workload::BankSwitching)
+        {
+            for (uint8_t cartridgeType : { 0x03, 0x06, 0x13, 0x1B })
+            {
+                frames.push_back({ std::string("frame/") + WorkloadRoms::getWorkloadName(workload) + "/" + WorkloadRoms::getControllerName(cartridgeType), workload, cartridgeType, false });
+            }
+        }
+        else
+        {
+            frames.push_back({ std::string("frame/") + WorkloadRoms::getWorkloadName(workload), workload, WorkloadRoms::getDefaultCartridgeType(workload), false });
+        }
+    }
+    size_t numUntracedFrames = frames.size();
+    for (size_t i = 0; i < numUntracedFrames; i++)
+    {
+        Frame tracedFrame = frames[i];
+        tracedFrame.m_name += "/traced";
+        tracedFrame.m_isTraced = true;
+        frames.push_back(tracedFrame);
+    }
+
+    std::vector<Benchmark> benchmarks;
+    for (Frame const& frame : frames)
+    {
+        benchmarks.push_back({ frame.m_name, "frame", [frame]() -> Benchmark::Run
+        {
+            std::shared_ptr<Emulator> emulator = openRom(WorkloadRoms::generateWorkloadRom(frame.m_workload, frame.m_cartridgeType));
+            std::shared_ptr<InstructionTrace> trace;
+            if (frame.m_isTraced)
+            {
+                // Small enough to stay in cache as much as a trace ever does, the ring wraps either way
+                trace = std::make_shared<InstructionTrace>(4 * 1024 * 1024);
+                emulator->setInstructionTrace(trace.get());
+            }
+            return [emulator, trace](uint64_t numOperations)
+            {
+                for (uint64_t i = 0; i < numOperations; i++)
+                {
+                    emulator->runFrame();
+                }
+            };
+        } });
+    }
+    return benchmarks;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <functional>
+
+// A benchmark times one kind of operation. Creating it builds its emulator and synthetic ROM, and the function it
+// returns performs the given number of operations on them, so benchmarks that are filtered out cost nothing.
+struct Benchmark
+{
+    using Run = std::function<void(uint64_t numOperations)>;
+
+    std::string m_name;         // "<subsystem>/<case>", e.g. "cpu/alu" or "memory/mbc1/read/romx"
+    std::string m_operation;    // What one operation is, e.g. "instruction" or "frame"
+    std::function<Run()> m_create;
+};
+
+std::vector<Benchmark> createMicroBenchmarks();
+// Synthetic workload ROMs run frame by frame
+std::vector<Benchmark> createMacroBenchmarks();
\ No newline at end of file
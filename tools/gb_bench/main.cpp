@@ -0,0 +1,211 @@
+// Times every subsystem on its own (CPU opcode classes, memory regions per bank controller, LCD lines, timer, sound)
+// and synthetic workload ROMs frame by frame, and compares the results against a baseline.
+//
+// > gb_bench.exe [options]
+//   --filter TEXT      Only run benchmarks whose name contains TEXT
+//   --micro            Only run the microbenchmarks
+//   --macro            Only run the frame benchmarks
+//   --repetitions R    Timed repetitions per benchmark, the median is reported (default: 5)
+//   --min-time MS      Minimum duration of one repetition (default: 50)
+//   --json FILE        Write the results as JSON
+//   --baseline FILE    Compare against a JSON file written by --json, exits with 1 on regressions
+//   --threshold PCT    Slowdown that counts as a regression (default: 5)
+//   --list             Print the benchmark names and exit
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+#include "Benchmarks.h"
+
+struct Result
+{
+    std::string m_name;
+    std::string m_operation;
+    double m_nanosecondsPerOperation = 0.0;
+    uint64_t m_numOperations = 0;     // Per repetition
+};
+
+static double timeRun(Benchmark::Run const& run, uint64_t numOperations)
+{
+    auto start = std::chrono::steady_clock::now();
+    run(numOperations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Result measure(Benchmark const& benchmark, uint32_t repetitions, double minSeconds)
+{
+    Benchmark::Run run = benchmark.m_create();
+
+    // Grows the batch until it's long enough for the clock, which doubles as the warm-up
+    uint64_t numOperations = 1;
+    while (true)
+    {
+        double seconds = timeRun(run, numOperations);
+        if (seconds >= minSeconds) break;
+        double factor = seconds > 0.0 ? std::clamp(minSeconds / seconds * 1.2, 2.0, 100.0) : 100.0;
+        numOperations = static_cast<uint64_t>(numOperations * factor);
+    }
+
+    std::vector<double> samples;
+    for (uint32_t i = 0; i < repetitions; i++)
+    {
+        samples.push_back(timeRun(run, numOperations) * 1e9 / numOperations);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Result result;
+    result.m_name = benchmark.m_name;
+    result.m_operation = benchmark.m_operation;
+    result.m_nanosecondsPerOperation = samples[samples.size() / 2];
+    result.m_numOperations = numOperations;
+    return result;
+}
+
+static bool writeJson(char const* filename, std::vector<Result> const& results)
+{
+    std::ofstream file(filename);
+    file << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        char line[512];
+        snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"operation\": \"%s\", \"ns_per_operation\": %.4f, \"operations\": %llu }%s\n",
+            results[i].m_name.c_str(), results[i].m_operation.c_str(), results[i].m_nanosecondsPerOperation,
+            static_cast<unsigned long long>(results[i].m_numOperations), i + 1 < results.size() ? "," : "");
+        file << line;
+    }
+    file << "  ]\n}\n";
+    return file.good();
+}
+
+// Reads back what writeJson() writes, it isn't a general JSON parser
+static bool readBaseline(char const* filename, std::map<std::string, double>& baseline)
+{
+    std::ifstream file(filename);
+    if (!file) return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    std::string json = stream.str();
+
+    static const std::string sc_nameKey = "\"name\": \"";
+    static const std::string sc_valueKey = "\"ns_per_operation\": ";
+    size_t position = 0;
+    while ((position = json.find(sc_nameKey, position)) != std::string::npos)
+    {
+        size_t nameStart = position + sc_nameKey.size();
+        size_t nameEnd = json.find('"', nameStart);
+        size_t valueStart = json.find(sc_valueKey, nameEnd);
+        if (nameEnd == std::string::npos || valueStart == std::string::npos) return false;
+
+        baseline[json.substr(nameStart, nameEnd - nameStart)] = strtod(json.c_str() + valueStart + sc_valueKey.size(), nullptr);
+        position = valueStart;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    bool runMicro = true;
+    bool runMacro = true;
+    uint32_t repetitions = 5;
+    double minSeconds = 0.05;
+    char const* jsonFilename = nullptr;
+    char const* baselineFilename = nullptr;
+    double threshold = 5.0;
+    bool listOnly = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && hasValue) filter = argv[++i];
+        else if (strcmp(argv[i], "--micro") == 0) runMacro = false;
+        else if (strcmp(argv[i], "--macro") == 0) runMicro = false;
+        else if (strcmp(argv[i], "--repetitions") == 0 && hasValue) repetitions = std::max(atoi(argv[++i]), 1);
+        else if (strcmp(argv[i], "--min-time") == 0 && hasValue) minSeconds = atof(argv[++i]) / 1000.0;
+        else if (strcmp(argv[i], "--json") == 0 && hasValue) jsonFilename = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && hasValue) baselineFilename = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && hasValue) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--list") == 0) listOnly = true;
+        else
+        {
+            fprintf(stderr, "Usage: gb_bench [--filter TEXT] [--micro | --macro] [--repetitions R] [--min-time MS] [--json FILE] [--baseline FILE] [--threshold PCT] [--list]\n");
+            return 1;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselineFilename && !readBaseline(baselineFilename, baseline))
+    {
+        fprintf(stderr, "Couldn't read baseline %s\n", baselineFilename);
+        return 1;
+    }
+
+    std::vector<Benchmark> benchmarks;
+    if (runMicro)
+    {
+        benchmarks = createMicroBenchmarks();
+    }
+    if (runMacro)
+    {
+        std::vector<Benchmark> macroBenchmarks = createMacroBenchmarks();
+        benchmarks.insert(benchmarks.end(), macroBenchmarks.begin(), macroBenchmarks.end());
+    }
+    std::erase_if(benchmarks, [&filter](Benchmark const& benchmark) { return benchmark.m_name.find(filter) == std::string::npos; });
+
+    if (listOnly)
+    {
+        for (Benchmark const& benchmark : benchmarks)
+        {
+            printf("%s\n", benchmark.m_name.c_str());
+        }
+        return 0;
+    }
+
+    std::vector<Result> results;
+    uint32_t numRegressions = 0;
+    for (Benchmark const& benchmark : benchmarks)
+    {
+        Result result = measure(benchmark, repetitions, minSeconds);
+        results.push_back(result);
+
+        printf("%-40s %12.2f ns/%s", result.m_name.c_str(), result.m_nanosecondsPerOperation, result.m_operation.c_str());
+        if (result.m_operation == "frame")
+        {
+            printf(" (%.1f frames/s)", 1e9 / result.m_nanosecondsPerOperation);
+        }
+
+        auto baselineResult = baseline.find(result.m_name);
+        if (baselineResult != baseline.end() && baselineResult->second > 0.0)
+        {
+            double change = (result.m_nanosecondsPerOperation / baselineResult->second - 1.0) * 100.0;
+            bool isRegression = change > threshold;
+            numRegressions += isRegression ? 1 : 0;
+            printf("  %+6.1f%% vs %.2f%s", change, baselineResult->second, isRegression ? "  REGRESSION" : change < -threshold ? "  improved" : "");
+        }
+        else if (baselineFilename)
+        {
+            printf("  (not in baseline)");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (jsonFilename && !writeJson(jsonFilename, results))
+    {
+        fprintf(stderr, "Couldn't write %s\n", jsonFilename);
+        return 1;
+    }
+    if (baselineFilename)
+    {
+        printf("%u regressions over %.1f%%\n", numRegressions, threshold);
+    }
+    return numRegressions == 0 ? 0 : 1;
+}
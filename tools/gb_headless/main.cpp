@@ -0,0 +1,294 @@
+// Runs one ROM without a window or audio device as fast as it goes and reports the emulator's raw throughput.
+//
+// > gb_headless.exe [options] rom.gb
+//   --frames N         Frames to run (default: 3600, or until the movie ends with --movie)
+//   --seconds S        Emulated seconds to run instead of a number of frames
+//   --movie FILE       Movie replayed from its start state, stops early when it ends or desyncs
+//   --frame-skip K     Render one frame, then skip K (default: 0, render every frame)
+//   --no-audio         Don't mix audio samples, the channels are still emulated
+//   --stats            Print the emulator's performance counters for the whole run
+//   --frame-stats      Print the performance counters of every frame
+//   --profile PREFIX   Profile the game's code, writes PREFIX.txt (hot spots and opcodes) and PREFIX.folded
+//                      (collapsed call stacks for flamegraph.pl)
+//   --profile-interval CYCLES  Cycles between profile samples (default: 1024)
+//   --symbols FILE     Symbol file (.sym) to name the profiled locations with
+//   --trace FILE       Write the instrumentation zones as a Chrome trace, needs a build with instrumentation
+//   --instruction-trace FILE   Record every executed instruction, writes the latest ones to FILE at the end
+//                      (gb_tracedump turns it into text)
+//   --instruction-trace-size MB  Size of the instruction ring (default: 64)
+//   --instruction-trace-ring FILE  Keep the ring in a mapped file, which stays readable if the emulator crashes
+//   --trace-trigger-pc [BB:]AAAA  Write the instruction trace and stop once the game executes the address
+//   --trace-trigger-opcode XX     The same once the game executes the opcode, e.g. 40 (LD B,B)
+//
+// Video goes nowhere and audio samples are dropped every frame, the final frame hash is of the last rendered frame.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <chrono>
+#include <memory>
+
+#include "Emulator.h"
+#include "CPU.h"
+#include "Movie.h"
+#include "GuestProfiler.h"
+#include "Instrumentation.h"
+#include "InstructionTrace.h"
+
+int main(int argc, char** argv)
+{
+    uint32_t numFrames = 0;
+    double numSeconds = 0.0;
+    uint32_t framesToSkip = 0;
+    bool enableAudio = true;
+    bool printStats = false;
+    bool printFrameStats = false;
+    std::string profilePrefix;
+    uint32_t profileInterval = 1024;
+    std::string symbolFilename;
+    std::string traceFilename;
+    std::string instructionTraceFilename;
+    size_t instructionTraceSize = InstructionTrace::sc_defaultSizeBytes;
+    std::string instructionTraceRingFilename;
+    int32_t triggerBank = -1;
+    int32_t triggerAddress = -1;
+    int32_t triggerOpcode = -1;
+    std::unique_ptr<Movie> movie;
+    std::string romFilename;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--frames") == 0 && hasValue) numFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seconds") == 0 && hasValue) numSeconds = atof(argv[++i]);
+        else if (strcmp(argv[i], "--frame-skip") == 0 && hasValue) framesToSkip = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-audio") == 0) enableAudio = false;
+        else if (strcmp(argv[i], "--stats") == 0) printStats = true;
+        else if (strcmp(argv[i], "--frame-stats") == 0) printFrameStats = true;
+        else if (strcmp(argv[i], "--profile") == 0 && hasValue) profilePrefix = argv[++i];
+        else if (strcmp(argv[i], "--profile-interval") == 0 && hasValue) profileInterval = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--symbols") == 0 && hasValue) symbolFilename = argv[++i];
+        else if (strcmp(argv[i], "--trace") == 0 && hasValue) traceFilename = argv[++i];
+        else if (strcmp(argv[i], "--instruction-trace") == 0 && hasValue) instructionTraceFilename = argv[++i];
+        else if (strcmp(argv[i], "--instruction-trace-size") == 0 && hasValue) instructionTraceSize = size_t(atoi(argv[++i])) * 1024 * 1024;
+        else if (strcmp(argv[i], "--instruction-trace-ring") == 0 && hasValue) instructionTraceRingFilename = argv[++i];
+        else if (strcmp(argv[i], "--trace-trigger-pc") == 0 && hasValue)
+        {
+            char const* value = argv[++i];
+            char const* separator = strchr(value, ':');
+            triggerBank = separator ? static_cast<int32_t>(strtol(value, nullptr, 16)) : -1;
+            triggerAddress = static_cast<int32_t>(strtol(separator ? separator + 1 : value, nullptr, 16));
+        }
+        else if (strcmp(argv[i], "--trace-trigger-opcode") == 0 && hasValue) triggerOpcode = static_cast<int32_t>(strtol(argv[++i], nullptr, 16));
+        else if (strcmp(argv[i], "--movie") == 0 && hasValue)
+        {
+            movie = std::make_unique<Movie>();
+            if (!movie->loadFromFile(argv[++i]))
+            {
+                fprintf(stderr, "Couldn't load movie %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else romFilename = argv[i];
+    }
+
+    if (romFilename.empty())
+    {
+        fprintf(stderr, "Usage: gb_headless [--frames N | --seconds S] [--movie FILE] [--frame-skip K] [--no-audio] [--stats] [--frame-stats]\n"
+            "                   [--profile PREFIX [--profile-interval CYCLES] [--symbols FILE]] [--trace FILE]\n"
+            "                   [--instruction-trace FILE [--instruction-trace-size MB] [--instruction-trace-ring FILE]\n"
+            "                    [--trace-trigger-pc [BB:]AAAA] [--trace-trigger-opcode XX]] rom\n");
+        return 1;
+    }
+#ifndef EMULATOR_INSTRUMENTATION
+    if (!traceFilename.empty())
+    {
+        fprintf(stderr, "--trace needs a build with EMULATOR_INSTRUMENTATION defined (premake5 --instrumentation=zones)\n");
+        return 1;
+    }
+#endif
+    if (numFrames == 0 && numSeconds <= 0.0 && !movie)
+    {
+        numFrames = 3600;
+    }
+
+    Emulator::Config config;
+    config.m_enableAudioOutput = false;
+    config.m_enableControllerInput = false;
+    config.m_persistBatteryBackedRam = false;
+    config.m_captureAudioSamples = enableAudio;
+
+    Emulator emulator(config);
+    emulator.setFrameSkip(framesToSkip > 0 ? Emulator::FrameSkipMode::Fixed : Emulator::FrameSkipMode::Disabled, framesToSkip);
+    emulator.setAudioMuted(!enableAudio);
+    if (!emulator.openRomFile(romFilename.c_str()))
+    {
+        fprintf(stderr, "Couldn't open %s\n", romFilename.c_str());
+        return 1;
+    }
+
+    MoviePlayer moviePlayer;
+    if (movie && !moviePlayer.start(emulator, movie.get()))
+    {
+        fprintf(stderr, "The movie was recorded with another ROM\n");
+        return 1;
+    }
+
+    GuestProfiler profiler(profileInterval);
+    if (!symbolFilename.empty() && !profiler.loadSymbolFile(symbolFilename.c_str()))
+    {
+        fprintf(stderr, "Couldn't load symbols from %s\n", symbolFilename.c_str());
+        return 1;
+    }
+    if (!profilePrefix.empty())
+    {
+        emulator.setGuestProfiler(&profiler);
+    }
+
+    std::unique_ptr<InstructionTrace> instructionTrace;
+    if (!instructionTraceFilename.empty())
+    {
+        instructionTrace = std::make_unique<InstructionTrace>(instructionTraceSize,
+            instructionTraceRingFilename.empty() ? nullptr : instructionTraceRingFilename.c_str());
+        if (!instructionTrace->isValid())
+        {
+            fprintf(stderr, "Couldn't map the instruction trace ring %s\n", instructionTraceRingFilename.c_str());
+            return 1;
+        }
+        if (triggerAddress >= 0) instructionTrace->setAddressTrigger(triggerBank, uint16_t(triggerAddress), instructionTraceFilename);
+        if (triggerOpcode >= 0) instructionTrace->setOpcodeTrigger(uint8_t(triggerOpcode), instructionTraceFilename);
+        emulator.setInstructionTrace(instructionTrace.get());
+    }
+
+    uint64_t startCycle = emulator.getElapsedCycles();
+    uint64_t startFrame = emulator.getFrameCount();
+    uint64_t startInstruction = emulator.getInstructionCount();
+    EmulatorStats startStats = emulator.getStats();
+    EmulatorStats frameStartStats = startStats;
+    uint64_t cycleLimit = numSeconds > 0.0 ? startCycle + static_cast<uint64_t>(numSeconds * CPU::s_normalSpeedFrequencyHz) : 0;
+
+    INSTRUMENT_THREAD_NAME("Main");
+    auto start = std::chrono::steady_clock::now();
+    uint32_t numFramesRun = 0;
+    while (true)
+    {
+        if (cycleLimit != 0 ? emulator.getElapsedCycles() >= cycleLimit : (numFrames != 0 && numFramesRun >= numFrames)) break;
+        if (instructionTrace && instructionTrace->hasTriggered()) break;
+
+        if (movie)
+        {
+            // A movie frame can end early at an input change, only whole frames count
+            if (moviePlayer.runFrame(emulator) != MoviePlayer::Status::Playing) break;
+            numFramesRun = static_cast<uint32_t>(emulator.getFrameCount() - startFrame);
+        }
+        else
+        {
+            emulator.runFrame();
+            numFramesRun++;
+        }
+        emulator.clearCapturedAudioSamples();
+
+        if (printFrameStats)
+        {
+            EmulatorStats stats = emulator.getStats();
+            printf("frame %llu: %s\n", static_cast<unsigned long long>(emulator.getFrameCount()), stats.since(frameStartStats).toString().c_str());
+            frameStartStats = stats;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    double emulatedSeconds = static_cast<double>(emulator.getElapsedCycles() - startCycle) / CPU::s_normalSpeedFrequencyHz;
+    uint64_t numInstructions = emulator.getInstructionCount() - startInstruction;
+    uint64_t frameHash = emulator.getFrameQueue()->acquireLatestFrame().computeHash();
+
+    printf("%s: %u frames, %.2f emulated seconds in %.3fs\n", romFilename.c_str(), numFramesRun, emulatedSeconds, seconds);
+    printf("%.1f frames/s, %.2fx real time, %.2f M instructions/s\n", numFramesRun / seconds, emulatedSeconds / seconds, numInstructions / seconds / 1e6);
+    printf("frame hash %016llx, state hash %016llx\n", static_cast<unsigned long long>(frameHash), static_cast<unsigned long long>(emulator.computeStateHash()));
+
+    if (printStats)
+    {
+        EmulatorStats stats = emulator.getStats().since(startStats);
+        auto perFrame = [numFramesRun](uint64_t count) { return numFramesRun > 0 ? static_cast<double>(count) / numFramesRun : 0.0; };
+        printf("\n%-22s %16s %14s\n", "counter", "total", "per frame");
+        auto printCounter = [&perFrame](char const* name, uint64_t count)
+        {
+            printf("%-22s %16llu %14.1f\n", name, static_cast<unsigned long long>(count), perFrame(count));
+        };
+        printCounter("instructions", stats.m_instructions);
+        printCounter("cycles", stats.m_cycles);
+        printCounter("halted cycles", stats.m_haltCycles);
+        static char const* const sc_interruptNames[EmulatorStats::sc_numInterrupts] = { "VBlank", "STAT", "timer", "serial", "joypad" };
+        for (uint32_t i = 0; i < EmulatorStats::sc_numInterrupts; i++)
+        {
+            printCounter((std::string(sc_interruptNames[i]) + " interrupts").c_str(), stats.m_interrupts[i]);
+        }
+        for (uint32_t region = 0; region < EmulatorStats::NumMemoryRegions; region++)
+        {
+            printCounter((std::string(EmulatorStats::getMemoryRegionName(region)) + " reads").c_str(), stats.m_memoryReads[region]);
+            printCounter((std::string(EmulatorStats::getMemoryRegionName(region)) + " writes").c_str(), stats.m_memoryWrites[region]);
+        }
+        printCounter("bank switches", stats.m_bankSwitches);
+        printCounter("scanlines", stats.m_scanlines);
+        printCounter("frames rendered", stats.m_framesRendered);
+        printCounter("frames skipped", stats.m_framesSkipped);
+        printCounter("audio samples", stats.m_audioSamples);
+        printCounter("audio underruns", stats.m_audioUnderruns);
+    }
+
+    if (!profilePrefix.empty())
+    {
+        emulator.setGuestProfiler(nullptr);
+        std::string reportFilename = profilePrefix + ".txt";
+        std::string stacksFilename = profilePrefix + ".folded";
+        if (!profiler.writeReport(reportFilename.c_str()) || !profiler.writeCollapsedStacks(stacksFilename.c_str()))
+        {
+            fprintf(stderr, "Couldn't write the profile to %s\n", reportFilename.c_str());
+            return 1;
+        }
+        printf("profile: %llu samples in %s and %s\n", static_cast<unsigned long long>(profiler.getSampleCount()), reportFilename.c_str(), stacksFilename.c_str());
+    }
+
+    if (instructionTrace)
+    {
+        emulator.setInstructionTrace(nullptr);
+        if (instructionTrace->hasTriggered())
+        {
+            printf("instruction trace: triggered at frame %llu, %s\n", static_cast<unsigned long long>(emulator.getFrameCount()), instructionTraceFilename.c_str());
+        }
+        else if (!instructionTrace->dumpToFile(instructionTraceFilename.c_str()))
+        {
+            fprintf(stderr, "Couldn't write the instruction trace to %s\n", instructionTraceFilename.c_str());
+            return 1;
+        }
+        else
+        {
+            printf("instruction trace: %llu instructions recorded, the latest in %s\n",
+                static_cast<unsigned long long>(instructionTrace->getRecordCount()), instructionTraceFilename.c_str());
+        }
+    }
+
+#ifdef EMULATOR_INSTRUMENTATION
+    if (!traceFilename.empty())
+    {
+        if (!Instrumentation::writeChromeTrace(traceFilename.c_str()))
+        {
+            fprintf(stderr, "Couldn't write the trace to %s\n", traceFilename.c_str());
+            return 1;
+        }
+        printf("trace: %s\n", traceFilename.c_str());
+    }
+#endif
+
+    if (movie && moviePlayer.getStatus() == MoviePlayer::Status::Desynced)
+    {
+        printf("movie desynced at cycle %llu\n", static_cast<unsigned long long>(moviePlayer.getDesyncCycle()));
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Writes the synthetic workload ROMs to a directory, to run them in the emulator, gb_headless or other emulators.
+//
+// > gb_romgen.exe [options] output_directory
+//   --workload NAME    Only write this workload (default: all of them)
+//   --all-types        One ROM per supported cartridge type instead of only the default type of each workload
+//   --list             Print the workload names and exit
+//
+// Files are named <workload>_<cartridge type in hex>.gb, or .gbc for CGB ROMs.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <filesystem>
+
+#include "WorkloadRoms.h"
+
+using WorkloadRoms::Workload;
+
+static bool writeRom(std::filesystem::path const& directory, Workload workload, uint8_t cartridgeType)
+{
+    std::vector<uint8_t> rom = WorkloadRoms::generateWorkloadRom(workload, cartridgeType);
+    bool isCGB = rom[0x143] & 0x80;
+
+    char filename[64];
+    snprintf(filename, sizeof(filename), "%s_%02x.%s", WorkloadRoms::getWorkloadName(workload), cartridgeType, isCGB ? "gbc" : "gb");
+    std::filesystem::path path = directory / filename;
+
+    std::ofstream file(path, std::ios::binary);
+    file.write(reinterpret_cast<char const*>(rom.data()), rom.size());
+    if (!file.good())
+    {
+        fprintf(stderr, "Couldn't write %s\n", path.string().c_str());
+        return false;
+    }
+    printf("%s (%s, %zu KB)\n", path.string().c_str(), WorkloadRoms::getControllerName(cartridgeType), rom.size() / 1024);
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string workloadName;
+    bool allTypes = false;
+    bool listOnly = false;
+    std::string directory;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--workload") == 0 && hasValue) workloadName = argv[++i];
+        else if (strcmp(argv[i], "--all-types") == 0) allTypes = true;
+        else if (strcmp(argv[i], "--list") == 0) listOnly = true;
+        else if (argv[i][0] != '-' && directory.empty()) directory = argv[i];
+        else
+        {
+            directory.clear();
+            listOnly = false;
+            break;
+        }
+    }
+
+    if (listOnly)
+    {
+        for (uint32_t i = 0; i < static_cast<uint32_t>(Workload::Count); i++)
+        {
+            printf("%s\n", WorkloadRoms::getWorkloadName(static_cast<Workload>(i)));
+        }
+        return 0;
+    }
+    if (directory.empty())
+    {
+        fprintf(stderr, "Usage: gb_romgen [--workload NAME] [--all-types] [--list] output_directory\n");
+        return 1;
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+
+    uint32_t numWritten = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(Workload::Count); i++)
+    {
+        Workload workload = static_cast<Workload>(i);
+        if (!workloadName.empty() && workloadName != WorkloadRoms::getWorkloadName(workload)) continue;
+
+        std::vector<uint8_t> cartridgeTypes = { WorkloadRoms::getDefaultCartridgeType(workload) };
+        if (allTypes) cartridgeTypes = WorkloadRoms::getSupportedCartridgeTypes();
+        for (uint8_t cartridgeType : cartridgeTypes)
+        {
+            if (!WorkloadRoms::isSupported(workload, cartridgeType)) continue;
+            if (!writeRom(directory, workload, cartridgeType)) return 1;
+            numWritten++;
+        }
+    }
+
+    if (numWritten == 0)
+    {
+        fprintf(stderr, "Unknown workload %s\n", workloadName.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Determinism checks on generated ROMs, exits with 1 if any fails.
+//
+// > gb_tests.exe [--filter TEXT]
+//
+// Movies recorded with frame skip or run-ahead have to replay in sync without them, since neither may change what
+// the game does, only what the host gets to see.
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <functional>
+#include <memory>
+
+#include "Emulator.h"
+#include "Movie.h"
+#include "WorkloadRoms.h"
+
+static const uint32_t sc_numFrames = 600;
+
+static std::unique_ptr<Emulator> openRom(std::vector<uint8_t> const& rom)
+{
+    Emulator::Config config;
+    config.m_enableAudioOutput = false;
+    config.m_enableControllerInput = false;
+    config.m_persistBatteryBackedRam = false;
+
+    std::unique_ptr<Emulator> emulator = std::make_unique<Emulator>(config);
+    emulator->openRomFromMemory(rom.data(), rom.size());
+    return emulator;
+}
+
+// Presses a different button every 20 frames, held for 10
+static uint8_t getButtonMask(uint32_t frame)
+{
+    return (frame % 20) < 10 ? uint8_t(1 << ((frame / 20) % 8)) : 0;
+}
+
+// Records like the emulation thread does, runFrame() runs one frame however the emulator is set up
+static Movie recordMovie(Emulator& emulator, std::function<void(Emulator&)> const& runFrame)
+{
+    MovieRecorder recorder(10);
+    recorder.start(emulator);
+    for (uint32_t frame = 0; frame < sc_numFrames; frame++)
+    {
+        runFrame(emulator);
+        uint8_t buttonMask = getButtonMask(frame);
+        emulator.setPressedButtons(buttonMask);
+        recorder.onFrameBoundary(emulator, buttonMask);
+    }
+    return recorder.getMovie();
+}
+
+static bool replaysInSync(std::vector<uint8_t> const& rom, Movie const& movie, std::string& error)
+{
+    std::unique_ptr<Emulator> emulator = openRom(rom);
+    MoviePlayer player;
+    if (!player.start(*emulator, &movie))
+    {
+        error = "the movie's start state didn't load";
+        return false;
+    }
+    while (player.runFrame(*emulator) == MoviePlayer::Status::Playing)
+    {
+    }
+    if (player.getStatus() == MoviePlayer::Status::Desynced)
+    {
+        error = "desynced at cycle " + std::to_string(player.getDesyncCycle());
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    std::string filter;
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--filter") == 0 && hasValue) filter = argv[++i];
+        else
+        {
+            fprintf(stderr, "Usage: gb_tests [--filter TEXT]\n");
+            return 1;
+        }
+    }
+
+    struct Recording
+    {
+        char const* m_name;
+        std::function<void(Emulator&)> m_setUp;
+        std::function<void(Emulator&)> m_runFrame;
+    };
+    std::vector<Recording> recordings =
+    {
+        { "frame_skip", [](Emulator& emulator) { emulator.setFrameSkip(Emulator::FrameSkipMode::Fixed, 2); }, [](Emulator& emulator) { emulator.runFrame(); } },
+        { "run_ahead", [](Emulator&) {}, [](Emulator& emulator) { emulator.runFrameAhead(2); } },
+    };
+
+    uint32_t numFailed = 0;
+    uint32_t numRun = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(WorkloadRoms::Workload::Count); i++)
+    {
+        WorkloadRoms::Workload workload = static_cast<WorkloadRoms::Workload>(i);
+        std::vector<uint8_t> rom = WorkloadRoms::generateWorkloadRom(workload, WorkloadRoms::getDefaultCartridgeType(workload));
+
+        for (Recording const& recording : recordings)
+        {
+            std::string name = std::string("movie/") + recording.m_name + "/" + WorkloadRoms::getWorkloadName(workload);
+            if (!filter.empty() && name.find(filter) == std::string::npos) continue;
+            numRun++;
+
+            std::unique_ptr<Emulator> emulator = openRom(rom);
+            recording.m_setUp(*emulator);
+            Movie movie = recordMovie(*emulator, recording.m_runFrame);
+
+            std::string error;
+            bool isPassed = replaysInSync(rom, movie, error);
+            printf("%-40s %s%s%s\n", name.c_str(), isPassed ? "ok" : "FAILED", isPassed ? "" : ", ", error.c_str());
+            if (!isPassed) numFailed++;
+        }
+    }
+
+    printf("%u of %u passed\n", numRun - numFailed, numRun);
+    return numFailed > 0 ? 1 : 0;
+}
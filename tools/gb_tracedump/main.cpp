@@ -0,0 +1,112 @@
+// Decodes a binary instruction trace, a dump or a ring file left behind by a crash, into text.
+//
+// > gb_tracedump.exe [options] trace.gbtrace
+//   --format F         text (default): cycle, bank:PC, bytes at PC, registers and flags per instruction
+//                      doctor: the Game Boy Doctor log format, to diff against other emulators' logs
+//   --last N           Only the last N instructions
+//   --output FILE      Write to a file instead of stdout
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "InstructionTrace.h"
+
+int main(int argc, char** argv)
+{
+    bool isDoctorFormat = false;
+    uint64_t lastCount = 0;
+    std::string outputFilename;
+    std::string traceFilename;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--format") == 0 && hasValue)
+        {
+            std::string format = argv[++i];
+            if (format != "text" && format != "doctor")
+            {
+                fprintf(stderr, "Unknown format %s\n", format.c_str());
+                return 1;
+            }
+            isDoctorFormat = format == "doctor";
+        }
+        else if (strcmp(argv[i], "--last") == 0 && hasValue) lastCount = strtoull(argv[++i], nullptr, 10);
+        else if (strcmp(argv[i], "--output") == 0 && hasValue) outputFilename = argv[++i];
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else traceFilename = argv[i];
+    }
+
+    if (traceFilename.empty())
+    {
+        fprintf(stderr, "Usage: gb_tracedump [--format text|doctor] [--last N] [--output FILE] trace\n");
+        return 1;
+    }
+
+    InstructionTraceReader reader;
+    if (!reader.open(traceFilename.c_str()))
+    {
+        fprintf(stderr, "Couldn't read the trace %s\n", traceFilename.c_str());
+        return 1;
+    }
+
+    InstructionTraceReader::Record record;
+    uint64_t numToSkip = 0;
+    if (lastCount > 0)
+    {
+        uint64_t numRecords = 0;
+        while (reader.next(record)) numRecords++;
+        numToSkip = numRecords > lastCount ? numRecords - lastCount : 0;
+        reader.open(traceFilename.c_str());
+    }
+
+    FILE* output = stdout;
+    if (!outputFilename.empty())
+    {
+        output = fopen(outputFilename.c_str(), "w");
+        if (!output)
+        {
+            fprintf(stderr, "Couldn't write %s\n", outputFilename.c_str());
+            return 1;
+        }
+    }
+
+    // Cycles count from the first instruction in the trace
+    uint64_t cycle = 0;
+    bool isFirstRecord = true;
+    for (uint64_t index = 0; reader.next(record); index++)
+    {
+        if (!isFirstRecord) cycle += record.m_cycleDelta;
+        isFirstRecord = false;
+        if (index < numToSkip) continue;
+
+        if (isDoctorFormat)
+        {
+            fprintf(output, "A:%02X F:%02X B:%02X C:%02X D:%02X E:%02X H:%02X L:%02X SP:%04X PC:%04X PCMEM:%02X,%02X,%02X,%02X\n",
+                record.m_A, record.m_F, record.m_B, record.m_C, record.m_D, record.m_E, record.m_H, record.m_L, record.m_SP, record.m_pc,
+                record.m_bytes[0], record.m_bytes[1], record.m_bytes[2], record.m_bytes[3]);
+            continue;
+        }
+
+        if (record.m_isAfterInterrupt) fprintf(output, "-- interrupt\n");
+        fprintf(output, "%12llu  %02X:%04X  %02X %02X %02X %02X  A:%02X F:%c%c%c%c BC:%02X%02X DE:%02X%02X HL:%02X%02X SP:%04X\n",
+            static_cast<unsigned long long>(cycle), record.m_bank, record.m_pc,
+            record.m_bytes[0], record.m_bytes[1], record.m_bytes[2], record.m_bytes[3], record.m_A,
+            record.m_F & 0x80 ? 'Z' : '-', record.m_F & 0x40 ? 'N' : '-', record.m_F & 0x20 ? 'H' : '-', record.m_F & 0x10 ? 'C' : '-',
+            record.m_B, record.m_C, record.m_D, record.m_E, record.m_H, record.m_L, record.m_SP);
+    }
+
+    if (output != stdout) fclose(output);
+    if (reader.isCorrupt())
+    {
+        fprintf(stderr, "The trace ends in a corrupt block\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,118 @@
+// Steps a VectorEnvironment with random actions and reports environment steps per second, then times resets.
+//
+// > gb_vecenv_bench.exe [options] rom.gb
+//   --envs N             Number of environments (default: 256)
+//   --threads T          Threads, 0 for one per hardware thread (default: 0)
+//   --steps S            Steps to time after one warm-up step (default: 600)
+//   --frames-per-step F  Frames every action is held for (default: 4)
+//   --warm-up W          Frames emulated before the snapshot resets return to (default: 0)
+//   --resets R           Resets of all environments to time, 0 to skip (default: 20)
+//   --downscale D        Frame downscale factor 1, 2 or 4, 0 for RAM-only observations (default: 2)
+//   --ram A,B,...        Hex RAM addresses added to every observation
+//   --pin                Pin threads to logical processors
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <sstream>
+
+#include "VectorEnvironment.h"
+
+int main(int argc, char** argv)
+{
+    VectorEnvironment::Config config;
+    config.m_numEnvironments = 256;
+    config.m_framesPerStep = 4;
+    uint32_t numSteps = 600;
+    uint32_t numResets = 20;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "--envs") == 0 && hasValue) config.m_numEnvironments = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && hasValue) config.m_numThreads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--steps") == 0 && hasValue) numSteps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--frames-per-step") == 0 && hasValue) config.m_framesPerStep = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--warm-up") == 0 && hasValue) config.m_warmUpFrames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--resets") == 0 && hasValue) numResets = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--downscale") == 0 && hasValue) config.m_frameDownscaleFactor = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--ram") == 0 && hasValue)
+        {
+            std::stringstream addresses(argv[++i]);
+            std::string address;
+            while (std::getline(addresses, address, ','))
+            {
+                config.m_ramAddresses.push_back(static_cast<uint16_t>(strtoul(address.c_str(), nullptr, 16)));
+            }
+        }
+        else if (strcmp(argv[i], "--pin") == 0) config.m_pinThreads = true;
+        else if (strncmp(argv[i], "--", 2) == 0)
+        {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return 1;
+        }
+        else config.m_romFilename = argv[i];
+    }
+
+    if (config.m_romFilename.empty() || config.m_numEnvironments == 0)
+    {
+        fprintf(stderr, "Usage: gb_vecenv_bench [--envs N] [--threads T] [--steps S] [--frames-per-step F] [--warm-up W] [--resets R] [--downscale D] [--ram A,B,...] [--pin] rom\n");
+        return 1;
+    }
+    if (config.m_frameDownscaleFactor != 0 && config.m_frameDownscaleFactor != 1 && config.m_frameDownscaleFactor != 2 && config.m_frameDownscaleFactor != 4)
+    {
+        fprintf(stderr, "The downscale factor has to be 0, 1, 2 or 4\n");
+        return 1;
+    }
+
+    VectorEnvironment environment(config);
+    if (!environment.hasOpenedRomFile())
+    {
+        fprintf(stderr, "Couldn't open %s\n", config.m_romFilename.c_str());
+        return 1;
+    }
+
+    std::vector<VectorEnvironment::Action> actions(config.m_numEnvironments);
+    std::vector<uint8_t> observations(size_t(config.m_numEnvironments) * environment.getObservationSize());
+
+    // Actions are drawn up front so the timed loop only measures the environment
+    std::vector<VectorEnvironment::Action> actionSequence(size_t(config.m_numEnvironments) * (numSteps + 1));
+    uint32_t random = 0x12345678;
+    for (VectorEnvironment::Action& action : actionSequence)
+    {
+        random = random * 1664525u + 1013904223u;
+        action = static_cast<VectorEnvironment::Action>(random >> 24);
+    }
+
+    environment.step(actionSequence.data(), observations.data());
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t step = 1; step <= numSteps; step++)
+    {
+        environment.step(&actionSequence[size_t(step) * config.m_numEnvironments], observations.data());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    uint64_t environmentSteps = uint64_t(numSteps) * config.m_numEnvironments;
+    printf("%u environments, %u steps of %u frames, %u observation bytes each\n", config.m_numEnvironments, numSteps, config.m_framesPerStep, environment.getObservationSize());
+    printf("%.3fs, %.1f environment steps/s, %.1f frames/s\n", seconds, environmentSteps / seconds, environmentSteps * config.m_framesPerStep / seconds);
+
+    // Without observations a reset is only the copy of the snapshot into every instance
+    if (numResets > 0)
+    {
+        start = std::chrono::steady_clock::now();
+        for (uint32_t reset = 0; reset < numResets; reset++)
+        {
+            environment.reset(nullptr);
+        }
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        uint64_t environmentResets = uint64_t(numResets) * config.m_numEnvironments;
+        printf("%u resets, %.3fs, %.1f environment resets/s, %.2fus per environment reset\n", numResets, seconds, environmentResets / seconds, seconds * 1e6 / environmentResets);
+    }
+
+    return 0;
+}
@@ -0,0 +1,259 @@
+#include "Assembler.h"
+
+#include <cassert>
+
+static uint8_t index8(Assembler::Reg8 reg)
+{
+    return static_cast<uint8_t>(reg);
+}
+
+// BC, DE, HL, SP for loads and arithmetic
+static uint8_t index16(Assembler::Reg16 reg)
+{
+    assert(reg != Assembler::Reg16::AF);
+    return static_cast<uint8_t>(reg);
+}
+
+// BC, DE, HL, AF for push and pop
+static uint8_t stackIndex16(Assembler::Reg16 reg)
+{
+    assert(reg != Assembler::Reg16::SP);
+    return reg == Assembler::Reg16::AF ? 3 : static_cast<uint8_t>(reg);
+}
+
+Assembler::Assembler(uint16_t origin)
+    : m_origin(origin)
+{
+}
+
+Assembler::Label Assembler::createLabel()
+{
+    m_labelAddresses.push_back(sc_unbound);
+    return static_cast<Label>(m_labelAddresses.size() - 1);
+}
+
+void Assembler::bind(Label label)
+{
+    assert(m_labelAddresses[label] == sc_unbound);
+    m_labelAddresses[label] = getAddress();
+}
+
+Assembler::Label Assembler::here()
+{
+    Label label = createLabel();
+    bind(label);
+    return label;
+}
+
+void Assembler::db(std::vector<uint8_t> const& bytes)
+{
+    m_code.insert(m_code.end(), bytes.begin(), bytes.end());
+}
+
+void Assembler::db(uint8_t byte)
+{
+    m_code.push_back(byte);
+}
+
+void Assembler::nop() { db(0x00); }
+void Assembler::halt() { db(0x76); }
+void Assembler::stop() { db({ 0x10, 0x00 }); }
+void Assembler::di() { db(0xF3); }
+void Assembler::ei() { db(0xFB); }
+
+void Assembler::ld(Reg8 destination, Reg8 source)
+{
+    // That encoding is HALT
+    assert(destination != Reg8::HLIndirect || source != Reg8::HLIndirect);
+    db(0x40 | (index8(destination) << 3) | index8(source));
+}
+
+void Assembler::ld(Reg8 destination, uint8_t value)
+{
+    db({ static_cast<uint8_t>(0x06 | (index8(destination) << 3)), value });
+}
+
+void Assembler::ldAFromAddress(uint16_t address)
+{
+    db(0xFA);
+    emit16(address);
+}
+
+void Assembler::ldAddressFromA(uint16_t address)
+{
+    db(0xEA);
+    emit16(address);
+}
+
+void Assembler::ldAFromIndirect(Reg16 pointer)
+{
+    assert(pointer == Reg16::BC || pointer == Reg16::DE);
+    db(pointer == Reg16::BC ? 0x0A : 0x1A);
+}
+
+void Assembler::ldIndirectFromA(Reg16 pointer)
+{
+    assert(pointer == Reg16::BC || pointer == Reg16::DE);
+    db(pointer == Reg16::BC ? 0x02 : 0x12);
+}
+
+void Assembler::ldAFromHLIncrement() { db(0x2A); }
+void Assembler::ldHLIncrementFromA() { db(0x22); }
+void Assembler::ldAFromHLDecrement() { db(0x3A); }
+void Assembler::ldHLDecrementFromA() { db(0x32); }
+
+void Assembler::ldhAFromIO(uint8_t offset)
+{
+    db({ 0xF0, offset });
+}
+
+void Assembler::ldhIOFromA(uint8_t offset)
+{
+    db({ 0xE0, offset });
+}
+
+void Assembler::ld(Reg16 destination, uint16_t value)
+{
+    db(0x01 | (index16(destination) << 4));
+    emit16(value);
+}
+
+void Assembler::ld(Reg16 destination, Label label)
+{
+    db(0x01 | (index16(destination) << 4));
+    emitLabel(label, false);
+}
+
+void Assembler::push(Reg16 reg) { db(0xC5 | (stackIndex16(reg) << 4)); }
+void Assembler::pop(Reg16 reg) { db(0xC1 | (stackIndex16(reg) << 4)); }
+void Assembler::inc(Reg16 reg) { db(0x03 | (index16(reg) << 4)); }
+void Assembler::dec(Reg16 reg) { db(0x0B | (index16(reg) << 4)); }
+void Assembler::addHL(Reg16 reg) { db(0x09 | (index16(reg) << 4)); }
+
+void Assembler::alu(AluOp op, Reg8 operand)
+{
+    db(0x80 | (static_cast<uint8_t>(op) << 3) | index8(operand));
+}
+
+void Assembler::alu(AluOp op, uint8_t value)
+{
+    db({ static_cast<uint8_t>(0xC6 | (static_cast<uint8_t>(op) << 3)), value });
+}
+
+void Assembler::inc(Reg8 reg) { db(0x04 | (index8(reg) << 3)); }
+void Assembler::dec(Reg8 reg) { db(0x05 | (index8(reg) << 3)); }
+void Assembler::cpl() { db(0x2F); }
+void Assembler::scf() { db(0x37); }
+void Assembler::ccf() { db(0x3F); }
+void Assembler::daa() { db(0x27); }
+
+void Assembler::shift(ShiftOp op, Reg8 reg)
+{
+    db({ 0xCB, static_cast<uint8_t>((static_cast<uint8_t>(op) << 3) | index8(reg)) });
+}
+
+void Assembler::bit(uint8_t bit, Reg8 reg)
+{
+    assert(bit < 8);
+    db({ 0xCB, static_cast<uint8_t>(0x40 | (bit << 3) | index8(reg)) });
+}
+
+void Assembler::res(uint8_t bit, Reg8 reg)
+{
+    assert(bit < 8);
+    db({ 0xCB, static_cast<uint8_t>(0x80 | (bit << 3) | index8(reg)) });
+}
+
+void Assembler::set(uint8_t bit, Reg8 reg)
+{
+    assert(bit < 8);
+    db({ 0xCB, static_cast<uint8_t>(0xC0 | (bit << 3) | index8(reg)) });
+}
+
+void Assembler::jp(uint16_t address)
+{
+    db(0xC3);
+    emit16(address);
+}
+
+void Assembler::jp(Label label)
+{
+    db(0xC3);
+    emitLabel(label, false);
+}
+
+void Assembler::jp(Condition condition, Label label)
+{
+    db(0xC2 | (static_cast<uint8_t>(condition) << 3));
+    emitLabel(label, false);
+}
+
+void Assembler::jpHL() { db(0xE9); }
+
+void Assembler::jr(Label label)
+{
+    db(0x18);
+    emitLabel(label, true);
+}
+
+void Assembler::jr(Condition condition, Label label)
+{
+    db(0x20 | (static_cast<uint8_t>(condition) << 3));
+    emitLabel(label, true);
+}
+
+void Assembler::call(uint16_t address)
+{
+    db(0xCD);
+    emit16(address);
+}
+
+void Assembler::call(Label label)
+{
+    db(0xCD);
+    emitLabel(label, false);
+}
+
+void Assembler::ret() { db(0xC9); }
+void Assembler::ret(Condition condition) { db(0xC0 | (static_cast<uint8_t>(condition) << 3)); }
+void Assembler::reti() { db(0xD9); }
+
+void Assembler::rst(uint8_t vector)
+{
+    assert((vector & 0xC7) == 0);
+    db(0xC7 | vector);
+}
+
+std::vector<uint8_t> Assembler::finish()
+{
+    for (Fixup const& fixup : m_fixups)
+    {
+        uint32_t target = m_labelAddresses[fixup.m_label];
+        assert(target != sc_unbound);
+        if (fixup.m_isRelative)
+        {
+            // Relative to the address after the operand
+            int32_t displacement = static_cast<int32_t>(target) - static_cast<int32_t>(m_origin + fixup.m_offset + 1);
+            assert(displacement >= -128 && displacement <= 127);
+            m_code[fixup.m_offset] = static_cast<uint8_t>(displacement);
+        }
+        else
+        {
+            m_code[fixup.m_offset] = static_cast<uint8_t>(target);
+            m_code[fixup.m_offset + 1] = static_cast<uint8_t>(target >> 8);
+        }
+    }
+    m_fixups.clear();
+    return m_code;
+}
+
+void Assembler::emit16(uint16_t value)
+{
+    db({ static_cast<uint8_t>(value), static_cast<uint8_t>(value >> 8) });
+}
+
+void Assembler::emitLabel(Label label, bool isRelative)
+{
+    m_fixups.push_back({ m_code.size(), label, isRelative });
+    db(isRelative ? std::vector<uint8_t>{ 0x00 } : std::vector<uint8_t>{ 0x00, 0x00 });
+}
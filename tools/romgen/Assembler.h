@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// SM83 (Game Boy CPU) assembler driven from C++: each call appends one instruction at the current address. Jumps
+// and calls can target labels that are bound later, they're patched in finish(). Code is assembled for a fixed
+// origin, so it has to be placed at that address in the ROM or in memory.
+class Assembler
+{
+public:
+    // In encoding order, HLIndirect is (HL)
+    enum class Reg8 : uint8_t { B, C, D, E, H, L, HLIndirect, A };
+    // AF only works with push() and pop(), SP with everything else
+    enum class Reg16 : uint8_t { BC, DE, HL, SP, AF };
+    enum class Condition : uint8_t { NZ, Z, NC, C };
+    enum class AluOp : uint8_t { Add, Adc, Sub, Sbc, And, Xor, Or, Cp };
+    enum class ShiftOp : uint8_t { Rlc, Rrc, Rl, Rr, Sla, Sra, Swap, Srl };
+
+    using Label = uint32_t;
+
+    explicit Assembler(uint16_t origin);
+
+    uint16_t getAddress() const { return static_cast<uint16_t>(m_origin + m_code.size()); }
+    Label createLabel();
+    void bind(Label label);
+    // Creates a label bound to the current address
+    Label here();
+
+    // Raw bytes, for data and anything not covered below
+    void db(std::vector<uint8_t> const& bytes);
+    void db(uint8_t byte);
+
+    void nop();
+    void halt();
+    void stop();
+    void di();
+    void ei();
+
+    // 8-bit loads
+    void ld(Reg8 destination, Reg8 source);
+    void ld(Reg8 destination, uint8_t value);
+    void ldAFromAddress(uint16_t address);      // LD A,(nn)
+    void ldAddressFromA(uint16_t address);      // LD (nn),A
+    void ldAFromIndirect(Reg16 pointer);        // LD A,(BC) / LD A,(DE)
+    void ldIndirectFromA(Reg16 pointer);        // LD (BC),A / LD (DE),A
+    void ldAFromHLIncrement();                  // LD A,(HL+)
+    void ldHLIncrementFromA();                  // LD (HL+),A
+    void ldAFromHLDecrement();                  // LD A,(HL-)
+    void ldHLDecrementFromA();                  // LD (HL-),A
+    void ldhAFromIO(uint8_t offset);            // LDH A,(0xFF00+n)
+    void ldhIOFromA(uint8_t offset);            // LDH (0xFF00+n),A
+
+    // 16-bit loads and arithmetic
+    void ld(Reg16 destination, uint16_t value);
+    void ld(Reg16 destination, Label label);
+    void push(Reg16 reg);
+    void pop(Reg16 reg);
+    void inc(Reg16 reg);
+    void dec(Reg16 reg);
+    void addHL(Reg16 reg);
+
+    // 8-bit arithmetic
+    void alu(AluOp op, Reg8 operand);
+    void alu(AluOp op, uint8_t value);
+    void inc(Reg8 reg);
+    void dec(Reg8 reg);
+    void cpl();
+    void scf();
+    void ccf();
+    void daa();
+
+    // CB-prefixed
+    void shift(ShiftOp op, Reg8 reg);
+    void bit(uint8_t bit, Reg8 reg);
+    void res(uint8_t bit, Reg8 reg);
+    void set(uint8_t bit, Reg8 reg);
+
+    // Control flow, relative jumps have to land within -128..127 bytes
+    void jp(uint16_t address);
+    void jp(Label label);
+    void jp(Condition condition, Label label);
+    void jpHL();
+    void jr(Label label);
+    void jr(Condition condition, Label label);
+    void call(uint16_t address);
+    void call(Label label);
+    void ret();
+    void ret(Condition condition);
+    void reti();
+    void rst(uint8_t vector);
+
+    // Resolves labels, every label used has to be bound by now
+    std::vector<uint8_t> finish();
+
+private:
+    struct Fixup
+    {
+        size_t m_offset;
+        Label m_label;
+        bool m_isRelative;
+    };
+
+    void emit16(uint16_t value);
+    void emitLabel(Label label, bool isRelative);
+
+    static constexpr uint32_t sc_unbound = 0xFFFFFFFF;
+
+    uint16_t m_origin;
+    std::vector<uint8_t> m_code;
+    std::vector<uint32_t> m_labelAddresses;
+    std::vector<Fixup> m_fixups;
+};
\ No newline at end of file
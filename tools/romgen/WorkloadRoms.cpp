@@ -0,0 +1,605 @@
+#include "WorkloadRoms.h"
+
+#include <cassert>
+#include <cstring>
+
+#include "Assembler.h"
+
+namespace WorkloadRoms
+{
+
+using Reg8 = Assembler::Reg8;
+using Reg16 = Assembler::Reg16;
+using Condition = Assembler::Condition;
+using AluOp = Assembler::AluOp;
+using ShiftOp = Assembler::ShiftOp;
+
+static const uint8_t sc_nintendoLogo[48] =
+{
+    0xCE, 0xED, 0x66, 0x66, 0xCC, 0x0D, 0x00, 0x0B, 0x03, 0x73, 0x00, 0x83, 0x00, 0x0C, 0x00, 0x0D,
+    0x00, 0x08, 0x11, 0x1F, 0x88, 0x89, 0x00, 0x0E, 0xDC, 0xCC, 0x6E, 0xE6, 0xDD, 0xDD, 0xD9, 0x99,
+    0xBB, 0xBB, 0x67, 0x63, 0x6E, 0x0E, 0xEC, 0xCC, 0xDD, 0xDC, 0x99, 0x9F, 0xBB, 0xB9, 0x33, 0x3E,
+};
+
+// The OAM DMA routine has to run from HRAM, the CPU can't fetch from ROM during the transfer
+static const uint16_t sc_oamDMARoutineDestination = 0xFF80;
+static const uint16_t sc_oamShadow = 0xC100;
+
+static bool hasExternalRam(uint8_t cartridgeType)
+{
+    switch (cartridgeType)
+    {
+    case 0x02: case 0x03: case 0x08: case 0x09: case 0x10: case 0x12: case 0x13: case 0x1A: case 0x1B: case 0x1D: case 0x1E:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isMBC1(uint8_t cartridgeType) { return cartridgeType >= 0x01 && cartridgeType <= 0x03; }
+static bool isMBC2(uint8_t cartridgeType) { return cartridgeType == 0x05 || cartridgeType == 0x06; }
+static bool isMBC3(uint8_t cartridgeType) { return cartridgeType >= 0x0F && cartridgeType <= 0x13; }
+static bool isMBC5(uint8_t cartridgeType) { return cartridgeType >= 0x19 && cartridgeType <= 0x1E; }
+
+static bool hasMBC(uint8_t cartridgeType)
+{
+    return isMBC1(cartridgeType) || isMBC2(cartridgeType) || isMBC3(cartridgeType) || isMBC5(cartridgeType);
+}
+
+char const* getWorkloadName(Workload workload)
+{
+    switch (workload)
+    {
+    case Workload::Alu: return "alu";
+    case Workload::Memcpy: return "memcpy";
+    case Workload::Memset: return "memset";
+    case Workload::BankSwitching: return "bank_switching";
+    case Workload::HaltUntilVBlank: return "halt_vblank";
+    case Workload::StatPolling: return "stat_polling";
+    case Workload::Sprites: return "sprites";
+    case Workload::HdmaStreaming: return "hdma_streaming";
+    case Workload::ApuChurn: return "apu_churn";
+    default: return "unknown";
+    }
+}
+
+uint8_t getDefaultCartridgeType(Workload workload)
+{
+    return workload == Workload::BankSwitching ? 0x1B : 0x00;
+}
+
+bool isSupported(Workload workload, uint8_t cartridgeType)
+{
+    return workload != Workload::BankSwitching || hasMBC(cartridgeType);
+}
+
+std::vector<uint8_t> const& getSupportedCartridgeTypes()
+{
+    static const std::vector<uint8_t> sc_types =
+    {
+        0x00, 0x08, 0x09,                           // ROM only
+        0x01, 0x02, 0x03,                           // MBC1
+        0x05, 0x06,                                 // MBC2
+        0x0F, 0x10, 0x11, 0x12, 0x13,               // MBC3
+        0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E,         // MBC5
+    };
+    return sc_types;
+}
+
+char const* getControllerName(uint8_t cartridgeType)
+{
+    return isMBC1(cartridgeType) ? "mbc1"
+         : isMBC2(cartridgeType) ? "mbc2"
+         : isMBC3(cartridgeType) ? "mbc3"
+         : isMBC5(cartridgeType) ? "mbc5"
+         : "rom";
+}
+
+std::vector<uint8_t> buildRom(uint8_t cartridgeType, bool isCGB, std::vector<uint8_t> const& program)
+{
+    assert(sc_programAddress + program.size() <= sc_programEnd);
+
+    std::vector<uint8_t> rom(hasMBC(cartridgeType) ? 0x20000 : 0x8000, 0x00);
+
+    // Switchable banks first, the fixed layout of bank 0 is written over the random bytes
+    uint32_t random = 0x12345678;
+    for (size_t i = 0; i < rom.size(); i++)
+    {
+        random = random * 1664525u + 1013904223u;
+        rom[i] = static_cast<uint8_t>(random >> 24);
+    }
+    for (size_t bank = 1; bank < rom.size() / 0x4000; bank++)
+    {
+        rom[bank * 0x4000] = static_cast<uint8_t>(bank);
+    }
+    std::memset(rom.data(), 0x00, sc_tileDataAddress);
+
+    for (uint16_t vector = 0x40; vector <= 0x60; vector += 8)
+    {
+        rom[vector] = 0xD9;                             // RETI
+    }
+    std::memcpy(&rom[sc_programAddress], program.data(), program.size());
+
+    for (uint16_t i = 0; i < 0x800; i++)
+    {
+        rom[sc_tileMapAddress + i] = static_cast<uint8_t>(i * 7);
+    }
+    for (uint16_t i = 0; i < 0x80; i++)
+    {
+        rom[sc_paletteAddress + i] = static_cast<uint8_t>(i * 13);
+    }
+
+    // 8x16 sprites in four bands of ten, every line a band covers has as many sprites as the hardware draws
+    for (uint16_t sprite = 0; sprite < 40; sprite++)
+    {
+        uint8_t* attributes = &rom[sc_spriteTableAddress + sprite * 4];
+        attributes[0] = static_cast<uint8_t>(16 + (sprite / 10) * 36);
+        attributes[1] = static_cast<uint8_t>(8 + (sprite % 10) * 16);
+        attributes[2] = static_cast<uint8_t>(sprite * 2);
+        attributes[3] = static_cast<uint8_t>(((sprite & 1) << 4) | ((sprite & 2) << 4) | (sprite & 7));
+    }
+
+    Assembler dmaRoutine(sc_oamDMARoutineDestination);
+    dmaRoutine.ldhIOFromA(0x46);
+    dmaRoutine.ld(Reg8::A, uint8_t(40));
+    Assembler::Label wait = dmaRoutine.here();
+    dmaRoutine.dec(Reg8::A);
+    dmaRoutine.jr(Condition::NZ, wait);
+    dmaRoutine.ret();
+    std::vector<uint8_t> dmaCode = dmaRoutine.finish();
+    std::memcpy(&rom[sc_oamDMARoutineAddress], dmaCode.data(), dmaCode.size());
+
+    // Header
+    uint8_t const entryPoint[] = { 0x00, 0xC3, static_cast<uint8_t>(sc_programAddress), static_cast<uint8_t>(sc_programAddress >> 8) };
+    std::memcpy(&rom[0x100], entryPoint, sizeof(entryPoint));
+    std::memcpy(&rom[0x104], sc_nintendoLogo, sizeof(sc_nintendoLogo));
+    std::memset(&rom[0x134], 0x00, 0x150 - 0x134);
+    std::memcpy(&rom[0x134], "GB_WORKLOAD", 11);
+    rom[0x143] = isCGB ? 0x80 : 0x00;
+    rom[0x147] = cartridgeType;
+    rom[0x148] = hasMBC(cartridgeType) ? 0x02 : 0x00;  // 128 KB or 32 KB
+    rom[0x149] = hasExternalRam(cartridgeType) ? 0x03 : 0x00;  // 32 KB
+    rom[0x14A] = 0x01;                                  // Non-Japanese
+
+    uint8_t headerChecksum = 0;
+    for (uint16_t address = 0x134; address <= 0x14C; address++)
+    {
+        headerChecksum = headerChecksum - rom[address] - 1;
+    }
+    rom[0x14D] = headerChecksum;
+
+    uint16_t globalChecksum = 0;
+    for (size_t i = 0; i < rom.size(); i++)
+    {
+        if (i != 0x14E && i != 0x14F) globalChecksum += rom[i];
+    }
+    rom[0x14E] = static_cast<uint8_t>(globalChecksum >> 8);
+    rom[0x14F] = static_cast<uint8_t>(globalChecksum);
+    return rom;
+}
+
+// Program building blocks
+struct Subroutines
+{
+    Assembler::Label m_memcpy;      // HL = destination, DE = source, BC = count (not 0)
+    Assembler::Label m_memset;      // HL = destination, E = value, BC = count (not 0)
+};
+
+static void emitCopy(Assembler& assembler, Subroutines const& subroutines, uint16_t destination, uint16_t source, uint16_t count)
+{
+    assembler.ld(Reg16::HL, destination);
+    assembler.ld(Reg16::DE, source);
+    assembler.ld(Reg16::BC, count);
+    assembler.call(subroutines.m_memcpy);
+}
+
+static void emitFill(Assembler& assembler, Subroutines const& subroutines, uint16_t destination, uint8_t value, uint16_t count)
+{
+    assembler.ld(Reg16::HL, destination);
+    assembler.ld(Reg8::E, value);
+    assembler.ld(Reg16::BC, count);
+    assembler.call(subroutines.m_memset);
+}
+
+static void emitWrite(Assembler& assembler, uint16_t address, uint8_t value)
+{
+    assembler.ld(Reg8::A, value);
+    if (address >= 0xFF00)
+    {
+        assembler.ldhIOFromA(static_cast<uint8_t>(address));
+    }
+    else
+    {
+        assembler.ldAddressFromA(address);
+    }
+}
+
+static void emitSubroutines(Assembler& assembler, Subroutines& subroutines)
+{
+    subroutines.m_memcpy = assembler.here();
+    assembler.ldAFromIndirect(Reg16::DE);
+    assembler.ldHLIncrementFromA();
+    assembler.inc(Reg16::DE);
+    assembler.dec(Reg16::BC);
+    assembler.ld(Reg8::A, Reg8::B);
+    assembler.alu(AluOp::Or, Reg8::C);
+    assembler.jr(Condition::NZ, subroutines.m_memcpy);
+    assembler.ret();
+
+    subroutines.m_memset = assembler.here();
+    assembler.ld(Reg8::A, Reg8::E);
+    assembler.ldHLIncrementFromA();
+    assembler.dec(Reg16::BC);
+    assembler.ld(Reg8::A, Reg8::B);
+    assembler.alu(AluOp::Or, Reg8::C);
+    assembler.jr(Condition::NZ, subroutines.m_memset);
+    assembler.ret();
+}
+
+// Turns the LCD off in VBlank, loads tiles, maps and palettes, clears OAM and disables interrupts
+static void emitInit(Assembler& assembler, Subroutines const& subroutines, uint8_t cartridgeType, bool isCGB)
+{
+    assembler.di();
+    assembler.ld(Reg16::SP, uint16_t(0xFFFE));
+
+    Assembler::Label lcdOff = assembler.createLabel();
+    assembler.ldhAFromIO(0x40);
+    assembler.bit(7, Reg8::A);
+    assembler.jr(Condition::Z, lcdOff);
+    Assembler::Label waitVBlank = assembler.here();
+    assembler.ldhAFromIO(0x44);
+    assembler.alu(AluOp::Cp, uint8_t(144));
+    assembler.jr(Condition::C, waitVBlank);
+    assembler.bind(lcdOff);
+    emitWrite(assembler, 0xFF40, 0x00);
+
+    // ROM only cartridges keep ROM area writes, so they don't get any
+    if (hasMBC(cartridgeType))
+    {
+        emitWrite(assembler, 0x0000, 0x0A);             // External RAM on
+        emitWrite(assembler, 0x2100, 0x01);             // ROM bank 1
+    }
+
+    for (uint8_t vramBank = 0; vramBank < (isCGB ? 2 : 1); vramBank++)
+    {
+        // Bank 1 of the maps holds the CGB attributes
+        if (isCGB) emitWrite(assembler, 0xFF4F, vramBank);
+        emitCopy(assembler, subroutines, 0x8000, sc_tileDataAddress, 0x1800);
+        emitCopy(assembler, subroutines, 0x9800, sc_tileMapAddress, 0x800);
+    }
+    if (isCGB) emitWrite(assembler, 0xFF4F, 0x00);
+
+    emitWrite(assembler, 0xFF47, 0xE4);                 // BGP
+    emitWrite(assembler, 0xFF48, 0xD2);                 // OBP0
+    emitWrite(assembler, 0xFF49, 0x1B);                 // OBP1
+    if (isCGB)
+    {
+        for (uint8_t paletteRegister : { 0x68, 0x6A })
+        {
+            emitWrite(assembler, 0xFF00 | paletteRegister, 0x80);
+            assembler.ld(Reg16::HL, static_cast<uint16_t>(sc_paletteAddress + (paletteRegister == 0x68 ? 0 : 0x40)));
+            assembler.ld(Reg8::B, uint8_t(0x40));
+            Assembler::Label copyPalette = assembler.here();
+            assembler.ldAFromHLIncrement();
+            assembler.ldhIOFromA(paletteRegister + 1);
+            assembler.dec(Reg8::B);
+            assembler.jr(Condition::NZ, copyPalette);
+        }
+    }
+
+    emitFill(assembler, subroutines, 0xFE00, 0x00, 0xA0);
+    emitWrite(assembler, 0xFF42, 0x00);                 // SCY
+    emitWrite(assembler, 0xFF43, 0x00);                 // SCX
+    emitWrite(assembler, 0xFF0F, 0x00);                 // IF
+    emitWrite(assembler, 0xFFFF, 0x00);                 // IE
+}
+
+static void emitLCDOn(Assembler& assembler, uint8_t LCDC)
+{
+    emitWrite(assembler, 0xFF40, LCDC);
+}
+
+static void emitEnableVBlankInterrupt(Assembler& assembler)
+{
+    emitWrite(assembler, 0xFF0F, 0x00);
+    emitWrite(assembler, 0xFFFF, 0x01);
+    assembler.ei();
+}
+
+// Copies of a block back to back until the program area is nearly full, then a jump back to the first one
+static void emitUnrolledLoop(Assembler& assembler, void (*emitBody)(Assembler&))
+{
+    Assembler::Label loop = assembler.here();
+    do
+    {
+        emitBody(assembler);
+    } while (assembler.getAddress() < sc_programEnd - 0x100);
+    assembler.jp(loop);
+}
+
+static void emitAluBody(Assembler& assembler)
+{
+    assembler.alu(AluOp::Add, Reg8::B);
+    assembler.alu(AluOp::Adc, Reg8::C);
+    assembler.alu(AluOp::Sub, Reg8::D);
+    assembler.alu(AluOp::Sbc, Reg8::E);
+    assembler.alu(AluOp::And, Reg8::H);
+    assembler.alu(AluOp::Xor, Reg8::L);
+    assembler.alu(AluOp::Or, Reg8::B);
+    assembler.alu(AluOp::Cp, Reg8::C);
+    assembler.inc(Reg8::B);
+    assembler.dec(Reg8::C);
+    assembler.alu(AluOp::Add, uint8_t(0x35));
+    assembler.shift(ShiftOp::Swap, Reg8::A);
+    assembler.ld(Reg8::D, Reg8::A);
+    assembler.alu(AluOp::Xor, uint8_t(0x5A));
+    assembler.shift(ShiftOp::Rl, Reg8::E);
+}
+
+static void emitBankSwitching(Assembler& assembler, uint8_t cartridgeType)
+{
+    bool switchesRamBanks = hasExternalRam(cartridgeType) && !isMBC1(cartridgeType);
+    bool hasRam = hasExternalRam(cartridgeType) || isMBC2(cartridgeType);
+
+    Assembler::Label loop = assembler.here();
+    for (uint8_t romBank = 1; romBank < 8; romBank++)
+    {
+        emitWrite(assembler, 0x2100, romBank);
+        assembler.ldAFromAddress(0x4000);
+        assembler.alu(AluOp::Add, Reg8::B);
+        assembler.ld(Reg8::B, Reg8::A);
+
+        // MBC1 shares its RAM bank register with the upper ROM bank bits, so it stays on RAM bank 0
+        if (hasRam)
+        {
+            if (switchesRamBanks) emitWrite(assembler, 0x4000, romBank & 3);
+            assembler.ld(Reg8::A, Reg8::B);
+            assembler.ldAddressFromA(0xA000 + romBank * 0x10);
+            assembler.ldAFromAddress(0xA001 + romBank * 0x10);
+            assembler.alu(AluOp::Add, Reg8::B);
+            assembler.ld(Reg8::B, Reg8::A);
+        }
+    }
+    assembler.jp(loop);
+}
+
+static void emitHaltUntilVBlank(Assembler& assembler)
+{
+    // Background with a status bar window over the bottom, like most games
+    emitWrite(assembler, 0xFF4A, 96);                   // WY
+    emitWrite(assembler, 0xFF4B, 7);                    // WX
+    emitWrite(assembler, 0xFE00, 80);                   // One sprite
+    emitWrite(assembler, 0xFE01, 80);
+    emitLCDOn(assembler, 0x80 | 0x40 | 0x20 | 0x10 | 0x02 | 0x01);
+    emitEnableVBlankInterrupt(assembler);
+
+    Assembler::Label loop = assembler.here();
+    assembler.halt();
+    assembler.nop();
+    assembler.ldhAFromIO(0x43);
+    assembler.inc(Reg8::A);
+    assembler.ldhIOFromA(0x43);
+    for (uint8_t select : { 0x20, 0x10 })
+    {
+        assembler.ld(Reg8::A, select);
+        assembler.ldhIOFromA(0x00);
+        assembler.ldhAFromIO(0x00);
+        assembler.ldhAFromIO(0x00);
+    }
+    emitWrite(assembler, 0xFF00, 0x30);
+    assembler.ld(Reg16::HL, uint16_t(0xFE01));
+    assembler.inc(Reg8::HLIndirect);
+    assembler.jr(loop);
+}
+
+static void emitStatPolling(Assembler& assembler)
+{
+    emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+
+    // Waits for every HBlank and sets SCX from LY, a raster effect that needs the CPU on every line
+    Assembler::Label waitHBlank = assembler.here();
+    assembler.ldhAFromIO(0x41);
+    assembler.alu(AluOp::And, uint8_t(0x03));
+    assembler.jr(Condition::NZ, waitHBlank);
+    assembler.ldhAFromIO(0x44);
+    assembler.alu(AluOp::Add, Reg8::A);
+    assembler.ldhIOFromA(0x43);
+    Assembler::Label waitLeaveHBlank = assembler.here();
+    assembler.ldhAFromIO(0x41);
+    assembler.alu(AluOp::And, uint8_t(0x03));
+    assembler.jr(Condition::Z, waitLeaveHBlank);
+    assembler.jr(waitHBlank);
+}
+
+static void emitSprites(Assembler& assembler, Subroutines const& subroutines)
+{
+    emitCopy(assembler, subroutines, sc_oamDMARoutineDestination, sc_oamDMARoutineAddress, 0x10);
+    emitCopy(assembler, subroutines, sc_oamShadow, sc_spriteTableAddress, 0xA0);
+    emitLCDOn(assembler, 0x80 | 0x10 | 0x04 | 0x02 | 0x01);
+    emitEnableVBlankInterrupt(assembler);
+
+    Assembler::Label loop = assembler.here();
+    assembler.halt();
+    assembler.nop();
+    assembler.ld(Reg8::A, static_cast<uint8_t>(sc_oamShadow >> 8));
+    assembler.call(sc_oamDMARoutineDestination);
+
+    // Every sprite moves one pixel down and right
+    assembler.ld(Reg16::HL, sc_oamShadow);
+    assembler.ld(Reg8::B, uint8_t(40));
+    Assembler::Label move = assembler.here();
+    assembler.inc(Reg8::HLIndirect);
+    assembler.inc(Reg16::HL);
+    assembler.inc(Reg8::HLIndirect);
+    assembler.inc(Reg16::HL);
+    assembler.inc(Reg16::HL);
+    assembler.inc(Reg16::HL);
+    assembler.dec(Reg8::B);
+    assembler.jr(Condition::NZ, move);
+    assembler.jr(loop);
+}
+
+static void emitHdmaStreaming(Assembler& assembler)
+{
+    emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+    emitEnableVBlankInterrupt(assembler);
+
+    Assembler::Label loop = assembler.here();
+    assembler.halt();
+    assembler.nop();
+
+    // An HBlank transfer still running is stopped by writing 0 to bit 7
+    Assembler::Label idle = assembler.createLabel();
+    assembler.ldhAFromIO(0x55);
+    assembler.bit(7, Reg8::A);
+    assembler.jr(Condition::NZ, idle);
+    emitWrite(assembler, 0xFF55, 0x00);
+    assembler.bind(idle);
+
+    // 2 KB of ROM bank 1 to the tile data at once in VBlank, from a different offset every frame
+    assembler.inc(Reg8::D);
+    assembler.ld(Reg8::A, Reg8::D);
+    assembler.alu(AluOp::And, uint8_t(0x2F));
+    assembler.alu(AluOp::Or, uint8_t(0x40));
+    assembler.ld(Reg8::E, Reg8::A);
+    assembler.ldhIOFromA(0x51);
+    emitWrite(assembler, 0xFF52, 0x00);
+    emitWrite(assembler, 0xFF53, 0x08);
+    emitWrite(assembler, 0xFF54, 0x00);
+    emitWrite(assembler, 0xFF55, 0x7F);
+
+    // Then 16 bytes per HBlank for the first 128 lines
+    assembler.ld(Reg8::A, Reg8::E);
+    assembler.alu(AluOp::Add, uint8_t(0x08));
+    assembler.ldhIOFromA(0x51);
+    emitWrite(assembler, 0xFF53, 0x10);
+    emitWrite(assembler, 0xFF55, 0x80 | 0x7F);
+
+    // The other VRAM bank next frame
+    assembler.ldhAFromIO(0x4F);
+    assembler.alu(AluOp::Xor, uint8_t(0x01));
+    assembler.ldhIOFromA(0x4F);
+    assembler.jr(loop);
+}
+
+static void emitApuChurn(Assembler& assembler)
+{
+    emitWrite(assembler, 0xFF26, 0x80);                 // NR52
+    emitWrite(assembler, 0xFF24, 0x77);                 // NR50
+    emitWrite(assembler, 0xFF25, 0xFF);                 // NR51
+    emitWrite(assembler, 0xFF11, 0x80);
+    emitWrite(assembler, 0xFF12, 0xF3);
+    emitWrite(assembler, 0xFF16, 0x40);
+    emitWrite(assembler, 0xFF17, 0xF3);
+    emitWrite(assembler, 0xFF1C, 0x20);
+    emitWrite(assembler, 0xFF21, 0xF3);
+    emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+
+    Assembler::Label loop = assembler.here();
+    assembler.inc(Reg8::B);
+
+    // Square channels: new frequency and retrigger
+    assembler.ld(Reg8::A, Reg8::B);
+    assembler.ldhIOFromA(0x13);
+    emitWrite(assembler, 0xFF14, 0x87);
+    assembler.ld(Reg8::A, Reg8::B);
+    assembler.ldhIOFromA(0x18);
+    emitWrite(assembler, 0xFF19, 0x86);
+
+    // Wave channel: off, new wave, on and retrigger
+    emitWrite(assembler, 0xFF1A, 0x00);
+    assembler.ld(Reg16::HL, uint16_t(0xFF30));
+    assembler.ld(Reg8::C, uint8_t(16));
+    assembler.ld(Reg8::A, Reg8::B);
+    Assembler::Label writeWave = assembler.here();
+    assembler.ldHLIncrementFromA();
+    assembler.alu(AluOp::Add, uint8_t(0x11));
+    assembler.dec(Reg8::C);
+    assembler.jr(Condition::NZ, writeWave);
+    emitWrite(assembler, 0xFF1A, 0x80);
+    assembler.ld(Reg8::A, Reg8::B);
+    assembler.ldhIOFromA(0x1D);
+    emitWrite(assembler, 0xFF1E, 0x87);
+
+    // Noise channel: new polynomial counter and retrigger
+    assembler.ld(Reg8::A, Reg8::B);
+    assembler.ldhIOFromA(0x22);
+    emitWrite(assembler, 0xFF23, 0x80);
+
+    assembler.ld(Reg8::C, uint8_t(32));
+    Assembler::Label delay = assembler.here();
+    assembler.dec(Reg8::C);
+    assembler.jr(Condition::NZ, delay);
+    assembler.jr(loop);
+}
+
+std::vector<uint8_t> generateWorkloadRom(Workload workload, uint8_t cartridgeType)
+{
+    assert(isSupported(workload, cartridgeType));
+    bool isCGB = workload == Workload::HdmaStreaming;
+
+    Assembler assembler(sc_programAddress);
+    Subroutines subroutines = {};
+    Assembler::Label main = assembler.createLabel();
+    assembler.jp(main);
+    emitSubroutines(assembler, subroutines);
+
+    assembler.bind(main);
+    emitInit(assembler, subroutines, cartridgeType, isCGB);
+
+    switch (workload)
+    {
+    case Workload::Alu:
+        emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+        emitUnrolledLoop(assembler, emitAluBody);
+        break;
+    case Workload::Memcpy:
+    {
+        emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+        Assembler::Label loop = assembler.here();
+        emitCopy(assembler, subroutines, 0xC000, 0x4000, 0x1000);
+        emitCopy(assembler, subroutines, 0xD000, 0xC000, 0x1000);
+        assembler.jp(loop);
+        break;
+    }
+    case Workload::Memset:
+    {
+        emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+        assembler.ld(Reg8::D, uint8_t(0));
+        Assembler::Label loop = assembler.here();
+        assembler.inc(Reg8::D);
+        assembler.ld(Reg16::HL, uint16_t(0xC000));
+        assembler.ld(Reg8::E, Reg8::D);
+        assembler.ld(Reg16::BC, uint16_t(0x1000));
+        assembler.call(subroutines.m_memset);
+        assembler.jp(loop);
+        break;
+    }
+    case Workload::BankSwitching:
+        emitLCDOn(assembler, 0x80 | 0x10 | 0x01);
+        emitBankSwitching(assembler, cartridgeType);
+        break;
+    case Workload::HaltUntilVBlank:
+        emitHaltUntilVBlank(assembler);
+        break;
+    case Workload::StatPolling:
+        emitStatPolling(assembler);
+        break;
+    case Workload::Sprites:
+        emitSprites(assembler, subroutines);
+        break;
+    case Workload::HdmaStreaming:
+        emitHdmaStreaming(assembler);
+        break;
+    case Workload::ApuChurn:
+        emitApuChurn(assembler);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+
+    return buildRom(cartridgeType, isCGB, assembler.finish());
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// Generated test ROMs, so benchmarks and local runs don't need commercial games. Every ROM has a complete header
+// (logo, size codes, checksums) and the same bank 0 layout:
+//   0x0040-0x0060  Interrupt vectors, each a RETI
+//   0x0150         Program
+//   0x1000         Tile data (0x1800 bytes)
+//   0x2800         BG and window tile maps (0x800 bytes)
+//   0x3000         CGB BG and OBJ palettes (0x40 bytes each)
+//   0x3100         Sprite attribute table for OAM DMA (0xA0 bytes)
+//   0x3200         OAM DMA routine, to be copied to HRAM
+// Switchable banks hold random data starting with their bank number.
+namespace WorkloadRoms
+{
+    static const uint16_t sc_programAddress = 0x150;
+    static const uint16_t sc_programEnd = 0x1000;
+    static const uint16_t sc_tileDataAddress = 0x1000;
+    static const uint16_t sc_tileMapAddress = 0x2800;
+    static const uint16_t sc_paletteAddress = 0x3000;
+    static const uint16_t sc_spriteTableAddress = 0x3100;
+    static const uint16_t sc_oamDMARoutineAddress = 0x3200;
+
+    enum class Workload
+    {
+        Alu,                // Unrolled register arithmetic
+        Memcpy,             // Copying 4 KB from ROM to WRAM over and over
+        Memset,             // Filling 4 KB of WRAM over and over
+        BankSwitching,      // ROM and RAM bank switches with a read or write after each
+        HaltUntilVBlank,    // A game loop that sleeps until VBlank, then scrolls, reads the joypad and moves a sprite
+        StatPolling,        // Busy waits on STAT for every HBlank to change the scroll per line
+        Sprites,            // 40 8x16 sprites in bands of 10 per line, moved and OAM DMA'd every frame
+        HdmaStreaming,      // CGB general purpose DMA in VBlank and HBlank DMA during the frame, always a CGB ROM
+        ApuChurn,           // Retriggers all four channels and rewrites wave RAM continuously
+        Count,
+    };
+
+    char const* getWorkloadName(Workload workload);
+    // The cartridge type a workload is benchmarked with by default
+    uint8_t getDefaultCartridgeType(Workload workload);
+    // Bank switching needs a memory bank controller, everything else runs on any cartridge
+    bool isSupported(Workload workload, uint8_t cartridgeType);
+
+    // Every cartridge type Emulator::CartridgeInfo maps to a memory bank controller, plus the ROM only ones
+    std::vector<uint8_t> const& getSupportedCartridgeTypes();
+    // "rom", "mbc1", "mbc2", "mbc3" or "mbc5"
+    char const* getControllerName(uint8_t cartridgeType);
+
+    // A ROM with the layout above, code goes to sc_programAddress and has to end before sc_programEnd. ROMs with a
+    // memory bank controller have 8 ROM banks and, if the type has RAM, 4 RAM banks.
+    std::vector<uint8_t> buildRom(uint8_t cartridgeType, bool isCGB, std::vector<uint8_t> const& program);
+    std::vector<uint8_t> generateWorkloadRom(Workload workload, uint8_t cartridgeType);
+}
\ No newline at end of file